@@ -1,66 +1,71 @@
 /*
  * Copyright (c) 2024 furzoom.com, All rights reserved.
  * Author: mn, mn@furzoom.com
+ *
+ * The actions of a state are kept in a contiguous array. Once sorted,
+ * the array is ordered by look-ahead symbol index, so actions on
+ * terminals come first, followed by non-terminals and the default.
  */
 
 #include "action.h"
 
-#include "assert.h"
-#include "msort.h"
-
 #include <stdlib.h>
 
-const int kDefaultActionSize = 100;
-
-MlnAction *MlnActionNew() {
-  static MlnAction *free_list = NULL;
-  MlnAction *new;
+#include "assert.h"
 
-  if (free_list == NULL) {
-    int i;
-    free_list = calloc(kDefaultActionSize, sizeof(MlnAction));
-    MlnMemoryCheck(free_list);
-    for (i = 0; i < kDefaultActionSize - 1; i++) {
-      free_list[i].next = &free_list[i + 1];
-    }
-  }
-  new = free_list;
-  free_list = free_list->next;
-  return new;
-}
+static const int kDefaultActionSize = 8;
 
-static int MlnActionCmp(void *a, void *b) {
-  MlnAction *ap1 = a, *ap2 = b;
-  int rc = ap1->sym->index - ap2->sym->index;
+static int MlnActionCmp(const void *a, const void *b) {
+  const MlnAction *ap1 = a, *ap2 = b;
+  int rc = ap1->sym - ap2->sym;
   if (rc == 0) {
     rc = (int)ap1->type - (int)ap2->type;
   }
   if (rc == 0) {
     assert(ap1->type == MLN_REDUCE || ap1->type == MLN_RD_RESOLVED ||
-           ap1->type == MLN_CONFLICT);
-    assert(ap2->type == MLN_REDUCE || ap2->type == MLN_RD_RESOLVED ||
-           ap2->type == MLN_CONFLICT);
-    rc = ap1->x.rule->index - ap2->x.rule->index;
+           ap1->type == MLN_CONFLICT || ap1->type == NOT_USED);
+    rc = ap1->x.rule - ap2->x.rule;
   }
   return rc;
 }
 
-/* Sort parser actions */
-MlnAction *MlnActionSort(MlnAction *ap) {
-  ap = MlnMSort(ap, &ap->next, MlnActionCmp);
-  return ap;
+/* Sort the actions of a state by look-ahead symbol */
+void MlnActionSort(MlnState *state) {
+  qsort(state->ap, state->nap, sizeof(state->ap[0]), MlnActionCmp);
 }
 
-void MlnActionAdd(MlnAction **app, MlnActionState type, MlnSymbol *sym,
-                  void *arg) {
-  MlnAction *new = MlnActionNew();
-  new->next = *app;
-  *app = new;
-  new->type = type;
+/*
+ * Append an action to the state. "arg" is the index of the destination
+ * state for a shift, or the index of the rule for a reduce.
+ */
+void MlnActionAdd(MlnState *state, MlnActionState type, int sym, int arg) {
+  MlnAction *new;
+  if (state->nap >= state->nap_alloc) {
+    state->nap_alloc =
+        state->nap_alloc ? state->nap_alloc * 2 : kDefaultActionSize;
+    state->ap = realloc(state->ap, sizeof(state->ap[0]) * state->nap_alloc);
+    MlnMemoryCheck(state->ap);
+  }
+  new = &state->ap[state->nap++];
   new->sym = sym;
-  if (type == MLN_SHIFT) {
-    new->x.state = arg;
-  } else {
-    new->x.rule = arg;
+  new->type = type;
+  new->x.state = arg;
+}
+
+/*
+ * Return the first action of a sorted state whose look-ahead is the
+ * symbol "sym", or NULL if there is none.
+ */
+MlnAction *MlnActionFind(MlnState *state, int sym) {
+  int lo = 0;
+  int hi = state->nap;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (state->ap[mid].sym < sym) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
   }
+  return lo < state->nap && state->ap[lo].sym == sym ? &state->ap[lo] : NULL;
 }
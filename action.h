@@ -8,9 +8,8 @@
 
 #include "struct.h"
 
-MlnAction *MlnActionNew();
-MlnAction *MlnActionSort(MlnAction *ap);
-void MlnActionAdd(MlnAction **app, MlnActionState type, MlnSymbol *sym,
-                  void *arg);
+void MlnActionAdd(MlnState *state, MlnActionState type, int sym, int arg);
+void MlnActionSort(MlnState *state);
+MlnAction *MlnActionFind(MlnState *state, int sym);
 
 #endif
@@ -9,21 +9,18 @@
 
 #include "acttab.h"
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "assert.h"
+#include "struct.h"
 
 /*
  * Allocate a new MlnAtionTable structure.
  */
 MlnActionTable *MlnActionTableAlloc() {
   MlnActionTable *at = malloc(sizeof(MlnActionTable));
-  if (at == NULL) {
-    fprintf(stderr, "Unable to allocate memory for a new MlnActionTable.\n");
-    exit(1);
-  }
+  MlnMemoryCheck(at);
   memset(at, 0, sizeof(*at));
   return at;
 }
@@ -32,7 +29,8 @@ MlnActionTable *MlnActionTableAlloc() {
  * Free all memory associated with the given MlnActionTable.
  */
 void MlnActionTableFree(MlnActionTable *at) {
-  free(at->actions);
+  free(at->lookahead_tab);
+  free(at->action_tab);
   free(at->lookaheads);
   free(at);
 }
@@ -40,15 +38,12 @@ void MlnActionTableFree(MlnActionTable *at) {
 /*
  * Add a new action to the current transcation set.
  */
-void MlnActionTableAddAction(MlnActionTable *at, int lookahead, int action) {
+void MlnActionTableAddAction(MlnActionTable *at, int lookahead, long action) {
   if (at->nlookahead >= at->nlookahead_alloc) {
     at->nlookahead_alloc += 25;
     at->lookaheads = realloc(at->lookaheads,
                              sizeof(at->lookaheads[0]) * at->nlookahead_alloc);
-    if (at->lookaheads == NULL) {
-      fprintf(stderr, "malloc failed\n");
-      exit(1);
-    }
+    MlnMemoryCheck(at->lookaheads);
   }
   if (at->nlookahead == 0) {
     at->max_lookahead = lookahead;
@@ -77,8 +72,9 @@ void MlnActionTableAddAction(MlnActionTable *at, int lookahead, int action) {
  *
  * Return the offset into the action table of the new transaction.
  */
-int MlnActionTableInsert(MlnActionTable *at) {
-  int i, j, n;
+long MlnActionTableInsert(MlnActionTable *at) {
+  long i, j, lwr, upr;
+  int n;
   assert(at->nlookahead > 0);
 
   /* Make sure we have enough space to hold the expanded action table
@@ -87,17 +83,16 @@ int MlnActionTableInsert(MlnActionTable *at) {
    */
   n = at->max_lookahead + 1;
   if (at->naction + n >= at->naction_alloc) {
-    int old_alloc = at->naction_alloc;
+    long old_alloc = at->naction_alloc;
     at->naction_alloc = at->naction + n + at->naction_alloc + 20;
-    at->actions =
-        realloc(at->actions, sizeof(at->actions[0]) * at->naction_alloc);
-    if (at->actions == NULL) {
-      fprintf(stderr, "malloc failed\n");
-      exit(1);
-    }
+    at->lookahead_tab =
+        realloc(at->lookahead_tab, sizeof(int) * at->naction_alloc);
+    MlnMemoryCheck(at->lookahead_tab);
+    at->action_tab = realloc(at->action_tab, sizeof(long) * at->naction_alloc);
+    MlnMemoryCheck(at->action_tab);
     for (i = old_alloc; i < at->naction_alloc; i++) {
-      at->actions[i].lookahead = -1;
-      at->actions[i].action = -1;
+      at->lookahead_tab[i] = -1;
+      at->action_tab[i] = -1;
     }
   }
 
@@ -107,43 +102,56 @@ int MlnActionTableInsert(MlnActionTable *at) {
    * i reaches at->naction, which means we append the new transaction
    * set.
    *
-   * i is the inde in at->actions[] where at->min_lookahead is inserted.
+   * i is the inde in at->lookahead_tab[] where at->min_lookahead is inserted.
+   *
+   * An entry j of the table matches this set if its lookahead is j
+   * minus the offset. Lookaheads are within [-1, max_entered], with -1
+   * in empty slots, so only the window [lwr, upr) of the table needs
+   * to be checked for that, not the whole table.
    */
   for (i = 0; i < at->naction + at->min_lookahead; i++) {
-    if (at->actions[i].lookahead < 0) {
+    lwr = i - at->min_lookahead - 1;
+    upr = i - at->min_lookahead + at->max_entered + 1;
+    if (lwr < 0) {
+      lwr = 0;
+    }
+    if (upr > at->naction) {
+      upr = at->naction;
+    }
+    if (at->lookahead_tab[i] < 0) {
       for (j = 0; j < at->nlookahead; j++) {
-        int k = at->lookaheads[j].lookahead - at->min_lookahead + i;
+        long k = at->lookaheads[j].lookahead - at->min_lookahead + i;
         if (k < 0) {
           break;
         }
-        if (at->actions[k].lookahead >= 0) {
+        if (at->lookahead_tab[k] >= 0) {
           break;
         }
       }
       if (j < at->nlookahead) {
         continue;
       }
-      for (j = 0; j < at->naction; j++) {
-        if (at->actions[j].lookahead == j + at->min_lookahead - i) {
+      for (j = lwr; j < upr; j++) {
+        if (at->lookahead_tab[j] == j + at->min_lookahead - i) {
           break;
         }
       }
-      if (j == at->naction) {
+      if (j >= upr) {
         break; /* Fits in empty slots */
       }
-    } else if (at->actions[i].lookahead == at->min_lookahead) {
-      if (at->actions[i].action != at->min_action) {
+    } else if (at->lookahead_tab[i] == at->min_lookahead) {
+      if (at->action_tab[i] != at->min_action) {
         continue;
       }
       for (j = 0; j < at->nlookahead; j++) {
-        int k = at->lookaheads[j].lookahead - at->min_lookahead + i;
+        long k = at->lookaheads[j].lookahead - at->min_lookahead + i;
         if (k < 0 || k >= at->naction) {
           break;
         }
-        if (at->lookaheads[j].lookahead != at->actions[k].lookahead) {
+        if (at->lookaheads[j].lookahead != at->lookahead_tab[k]) {
           break;
         }
-        if (at->lookaheads[j].action != at->actions[k].action) {
+        if (at->lookaheads[j].action != at->action_tab[k]) {
           break;
         }
       }
@@ -151,11 +159,11 @@ int MlnActionTableInsert(MlnActionTable *at) {
         continue;
       }
       n = 0;
-      for (j = 0; j < at->naction; j++) {
-        if (at->actions[j].lookahead < 0) {
+      for (j = lwr; j < upr; j++) {
+        if (at->lookahead_tab[j] < 0) {
           continue;
         }
-        if (at->actions[j].lookahead == j + at->min_lookahead - i) {
+        if (at->lookahead_tab[j] == j + at->min_lookahead - i) {
           n++;
         }
       }
@@ -167,12 +175,16 @@ int MlnActionTableInsert(MlnActionTable *at) {
 
   /* Insert transaction set at index i. */
   for (j = 0; j < at->nlookahead; j++) {
-    int k = at->lookaheads[j].lookahead - at->min_lookahead + i;
-    at->actions[k] = at->lookaheads[j];
+    long k = at->lookaheads[j].lookahead - at->min_lookahead + i;
+    at->lookahead_tab[k] = at->lookaheads[j].lookahead;
+    at->action_tab[k] = at->lookaheads[j].action;
     if (k >= at->naction) {
       at->naction = k + 1;
     }
   }
+  if (at->max_lookahead > at->max_entered) {
+    at->max_entered = at->max_lookahead;
+  }
   at->nlookahead = 0;
 
   /* Return the offset that is added to the lookahead in order to get
@@ -11,32 +11,37 @@
  * of the following structure.
  */
 typedef struct MlnActionTable {
-  int naction;          /* Number of used slots in actions */
-  int naction_alloc;    /* Slots allocated for actions */
+  long naction;         /* Number of used slots in actions */
+  long naction_alloc;   /* Slots allocated for actions */
   int nlookahead;       /* Number of used slots in lookaheads */
   int nlookahead_alloc; /* Slots allocated for lookaheads */
   int min_lookahead;    /* Minimum lookaheads[].lookahead */
-  int min_action;       /* Action associated with min_lookahead */
+  long min_action;      /* Action associated with min_lookahead */
   int max_lookahead;    /* Maximum lookaheads[].lookahead */
+  int max_entered;      /* Maximum lookahead entered into actions */
+  /* The yy_action[] table under construction, as the lookahead and
+   * the action of every entry. The lookaheads are apart, since the
+   * search for a place to insert scans them. */
+  int *lookahead_tab;
+  long *action_tab;
   struct {
     int lookahead; /* Value of the lookahead token */
-    int action;    /* Action to take on the given lookahead */
-  } *actions,      /* The yy_action[] table under construction */
-      *lookaheads; /* A single new transaction set */
+    long action;   /* Action to take on the given lookahead */
+  } *lookaheads;   /* A single new transaction set */
 } MlnActionTable;
 
 MlnActionTable *MlnActionTableAlloc();
 void MlnActionTableFree(MlnActionTable *at);
-void MlnActionTableAddAction(MlnActionTable *at, int lookahead, int action);
-int MlnActionTableInsert(MlnActionTable *at);
+void MlnActionTableAddAction(MlnActionTable *at, int lookahead, long action);
+long MlnActionTableInsert(MlnActionTable *at);
 
 /* Return the number of entries in the yy_action table */
 #define MlnActionTableSize(X) ((X)->naction)
 
 /* The value for the N-th entry in yy_action */
-#define MlnActionTableAction(X, N) ((X)->actions[N].action)
+#define MlnActionTableAction(X, N) ((X)->action_tab[N])
 
 /* The value for the N-th entry in yy_lookahead */
-#define MlnActionTableLookahead(X, N) ((X)->actions[N].lookahead)
+#define MlnActionTableLookahead(X, N) ((X)->lookahead_tab[N])
 
 #endif
@@ -6,13 +6,14 @@
 #include "assert.h"
 
 #include <stdio.h>
-#include <stdlib.h>
+
+#include "error.h"
 
 /*
  * A more efficient way of handling assertions.
  */
 void MlnAssert(const char *filename, int line) {
-  fprintf(stderr, "Assertion failed on line %d of file \"%s\"\n", line,
-          filename);
-  exit(1);
+  fprintf(MlnErrorStream(stderr),
+          "Assertion failed on line %d of file \"%s\"\n", line, filename);
+  MlnErrorAbort();
 }
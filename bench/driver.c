@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+/*
+ * Parse speed benchmark for a grammar from gen.sh.
+ *
+ * Usage: driver [TOKENS] [ROUNDS]
+ *
+ * Build with the parser melon generated from the grammar, and its
+ * header as bench.h, with LEVELS and STATEMENTS defined to the
+ * arguments of gen.sh. A random valid program of about TOKENS tokens
+ * is generated with a fixed seed, then parsed ROUNDS times. The best
+ * time is printed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bench.h"
+
+#ifndef LEVELS
+#define LEVELS 20
+#endif
+
+#ifndef STATEMENTS
+#define STATEMENTS 200
+#endif
+
+void *ParseAlloc(void *(*malloc_proc)(size_t));
+void Parse(void *parser, int major, int minor);
+void ParseFree(void *parser, void (*free_proc)(void *));
+
+static int *tokens;
+static int ntoken, ntoken_alloc;
+static unsigned seed = 12345;
+
+/* A pseudo random number in 0..n-1, the same on every run */
+static int Random(int n) {
+  seed = seed * 1103515245u + 12345u;
+  return (int)((seed >> 16) % (unsigned)n);
+}
+
+static void Emit(int token) {
+  if (ntoken >= ntoken_alloc) {
+    ntoken_alloc = ntoken_alloc ? ntoken_alloc * 2 : 1024;
+    tokens = realloc(tokens, sizeof(int) * ntoken_alloc);
+    if (tokens == NULL) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+  }
+  tokens[ntoken++] = token;
+}
+
+static void EmitExpr(int depth);
+
+/* An operand: a name, a number, a parenthesized expression or a call */
+static void EmitAtom(int depth) {
+  int n;
+  switch (depth < 4 ? Random(6) : Random(2)) {
+    case 0:
+    case 2:
+    case 3:
+      Emit(ID);
+      break;
+    case 1:
+      Emit(NUM);
+      break;
+    case 4:
+      Emit(LP);
+      EmitExpr(depth + 1);
+      Emit(RP);
+      break;
+    default:
+      Emit(ID);
+      Emit(LP);
+      for (n = Random(3); n > 0; n--) {
+        EmitExpr(depth + 1);
+        if (n > 1) {
+          Emit(COMMA);
+        }
+      }
+      Emit(RP);
+      break;
+  }
+}
+
+/* Operands joined by any operators, which the levels of the grammar
+ * always accept */
+static void EmitExpr(int depth) {
+  EmitAtom(depth);
+  while (Random(2)) {
+    Emit(OP0 + Random(LEVELS));
+    EmitAtom(depth);
+  }
+}
+
+static void EmitStmt(int depth) {
+  int n;
+  Emit(KW0 + Random(STATEMENTS));
+  switch (depth < 3 ? Random(3) : Random(2)) {
+    case 0:
+      EmitExpr(0);
+      Emit(SEMI);
+      break;
+    case 1:
+      Emit(ID);
+      Emit(ASSIGN);
+      EmitExpr(0);
+      Emit(SEMI);
+      break;
+    default:
+      Emit(ID);
+      Emit(LB);
+      for (n = Random(4); n > 0; n--) {
+        EmitStmt(depth + 1);
+      }
+      Emit(RB);
+      break;
+  }
+}
+
+static double Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  int target = argc > 1 ? atoi(argv[1]) : 5000000;
+  int rounds = argc > 2 ? atoi(argv[2]) : 5;
+  double best = 0;
+  int i, r;
+
+  while (ntoken < target) {
+    EmitStmt(0);
+  }
+  for (r = 0; r < rounds; r++) {
+    void *parser = ParseAlloc(malloc);
+    double start = Now(), elapsed;
+    for (i = 0; i < ntoken; i++) {
+      Parse(parser, tokens[i], i);
+    }
+    Parse(parser, 0, 0);
+    elapsed = Now() - start;
+    ParseFree(parser, free);
+    if (r == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  printf("%d tokens, best of %d: %.1f ms\n", ntoken, rounds, best);
+  free(tokens);
+  return 0;
+}
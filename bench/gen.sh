@@ -0,0 +1,53 @@
+#!/bin/sh
+# Melon benchmark grammar generator
+# Copyright (c) 2024 furzoom.com, All rights reserved.
+# Author: mn, mn@furzoom.com
+#
+# Usage: gen.sh LEVELS STATEMENTS > grammar.y
+#
+# Writes a grammar of STATEMENTS statement kinds, each introduced by
+# its own keyword, over an expression grammar of LEVELS binary operator
+# levels. The terminals are declared first, in an order driver.c relies
+# on: ID NUM LP RP COMMA SEMI LB RB ASSIGN, then OP0.., then KW0...
+# The default benchmark grammar is "gen.sh 20 200", which has 2275
+# states.
+
+if [ $# -ne 2 ]; then
+  echo "usage: $0 LEVELS STATEMENTS" >&2
+  exit 1
+fi
+
+awk -v K="$1" -v N="$2" 'BEGIN {
+  printf "%%token ID NUM LP RP COMMA SEMI LB RB ASSIGN"
+  for (k = 0; k < K; k++) printf " OP%d", k
+  for (i = 0; i < N; i++) printf " KW%d", i
+  print "."
+  print "%token_type {int}"
+  print "%include {"
+  print "#include <stdio.h>"
+  print "#include <stdlib.h>"
+  print "}"
+  print "%syntax_error { fprintf(stderr, \"syntax error\\n\"); exit(1); }"
+  print "program ::= stmts."
+  print "stmts ::= stmts stmt."
+  print "stmts ::= ."
+  for (i = 0; i < N; i++) {
+    printf "stmt ::= s%d.\n", i
+    printf "s%d ::= KW%d e0 SEMI. { }\n", i, i
+    printf "s%d ::= KW%d ID LB stmts RB. { }\n", i, i
+    printf "s%d ::= KW%d ID ASSIGN e0 SEMI. { }\n", i, i
+  }
+  for (k = 0; k < K; k++) {
+    printf "e%d(A) ::= e%d(B) OP%d e%d(C). { A = B + C; }\n", k, k, k, k + 1
+    printf "e%d(A) ::= e%d(B). { A = B; }\n", k, k + 1
+  }
+  printf "e%d ::= ID.\n", K
+  printf "e%d ::= NUM.\n", K
+  printf "e%d ::= LP e0 RP.\n", K
+  printf "e%d ::= ID LP args RP.\n", K
+  print "args ::= ."
+  print "args ::= arglist."
+  print "arglist ::= e0."
+  print "arglist ::= arglist COMMA e0."
+  for (k = 0; k <= K; k++) printf "%%type e%d {int}\n", k
+}'
@@ -0,0 +1,40 @@
+#!/bin/sh
+# Melon parse speed benchmark
+# Copyright (c) 2024 furzoom.com, All rights reserved.
+# Author: mn, mn@furzoom.com
+#
+# Usage: run.sh [LEVELS STATEMENTS [TOKENS [ROUNDS]]]
+#
+# Generates the grammar of gen.sh, then for every table layout below
+# generates its parser with ../melon, builds it with driver.c, and
+# prints the table size and the best parse time. The defaults are the
+# 2275-state grammar of "gen.sh 20 200" and 5M tokens, 5 rounds.
+
+levels=${1:-20}
+statements=${2:-200}
+tokens=${3:-5000000}
+rounds=${4:-5}
+bench=$(cd "$(dirname "$0")" && pwd)
+melon=$bench/../melon
+work=${TMPDIR:-/tmp}/melon-bench.$$
+CC=${CC:-cc}
+
+if [ ! -x "$melon" ]; then
+  echo "$0: build melon first" >&2
+  exit 1
+fi
+mkdir -p "$work" || exit 1
+trap 'rm -rf "$work"' EXIT
+cp "$bench/../mlt_parser.c" "$work/"
+sh "$bench/gen.sh" "$levels" "$statements" > "$work/bench.y" || exit 1
+
+for flags in "" "-i" "--pad" "-i --pad" "-p" "-r"; do
+  rm -f "$work/bench.c" "$work/bench.h"
+  (cd "$work" && "$melon" -q -s $flags bench.y) > "$work/stats.txt"
+  $CC -O2 -DNDEBUG -DLEVELS="$levels" -DSTATEMENTS="$statements" \
+    -I"$work" -o "$work/driver" "$bench/driver.c" "$work/bench.c" || exit 1
+  printf "%-10s %8s entries  " "${flags:-default}" \
+    "$(sed -n 's/.* states, \([0-9]*\) parser table entries.*/\1/p' \
+      "$work/stats.txt")"
+  "$work/driver" "$tokens" "$rounds" || exit 1
+done
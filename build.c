@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "action.h"
 #include "assert.h"
@@ -61,7 +62,7 @@ void MlnFindFirstSets(Melon *melon) {
     melon->symbols[i]->lambda = MLN_FALSE;
   }
   for (i = melon->nterminal; i < melon->nsymbol; i++) {
-    melon->symbols[i]->first_set = MlnSetNew();
+    melon->symbols[i]->first_set = MlnSetNew(melon);
   }
 
   /* First compute all lambdas */
@@ -99,7 +100,7 @@ void MlnFindFirstSets(Melon *melon) {
             break;
           }
         } else {
-          progress += MlnSetUnion(s1->first_set, s2->first_set);
+          progress += MlnSetUnion(melon, s1->first_set, s2->first_set);
           if (s2->lambda == MLN_FALSE) {
             break;
           }
@@ -119,12 +120,20 @@ static MlnState *MlnGetState(Melon *melon);
 void MlnFindStates(Melon *melon) {
   MlnSymbol *sp;
   MlnRule *rp;
+  char *end; /* The follow set of the start rules */
 
-  MlnConfigListInit();
+  MlnConfigListInit(melon);
+  MlnConfigListClosureInit(melon);
+  MlnPLinkInit(melon);
+  melon->shift_mark = calloc(melon->nsymbol + 1, sizeof(int));
+  melon->shift_pos = calloc(melon->nsymbol + 1, sizeof(int));
+  MlnMemoryCheck(melon->shift_mark);
+  MlnMemoryCheck(melon->shift_pos);
+  melon->shift_stamp = 0;
 
   /* Find the start symbol */
   if (melon->start) {
-    sp = MlnSymbolFind(melon->start);
+    sp = MlnSymbolFind(melon, melon->start);
     if (sp == NULL) {
       MlnErrorMsg(melon->filename, 0,
                   "The specified start symbol \"%s\" is not in a non-terminal "
@@ -168,10 +177,13 @@ void MlnFindStates(Melon *melon) {
    * The basis configuration set for the first state is all rules
    * which have the start symbol as their left-hand side.
    */
+  end = MlnSetNew(melon);
+  MlnSetAdd(end, 0); /* The symbol "$" */
+  end = MlnSetIntern(melon, end);
   for (rp = sp->rule; rp != NULL; rp = rp->next_lhs) {
-    MlnConfig *new_cfg = MlnConfigListAddBasis(rp, 0);
-    MlnSetAdd(new_cfg->fws, 0); /* add symbol "$" */
+    MlnConfigFollow(melon, MlnConfigListAddBasis(melon, rp, 0), end);
   }
+  MlnSetRelease(melon, end);
 
   /*
    * Compute the first state. All other states will be computed automatically
@@ -179,53 +191,70 @@ void MlnFindStates(Melon *melon) {
    * first state is not used.
    */
   MlnGetState(melon);
+  free(melon->shift_mark);
+  free(melon->shift_pos);
+  melon->shift_mark = melon->shift_pos = NULL;
 }
 
 static void MlnBuildShifts(Melon *melon, MlnState *state);
 
 /*
  * Return a pointer to a state which is described by the configuration
- * list which has been built from calls to MlnConfigListAdd().
+ * list which has been built from calls to MlnConfigListAdd(melon).
  */
 static MlnState *MlnGetState(Melon *melon) {
   MlnConfig *bp;
   MlnConfig *cfp;
   MlnState *stp;
+  unsigned hash;
 
   /*
-   * Extract the sorted basis of the new state. The basis was constructed
-   * by prior calls to MlnConfigListAddBasis().
+   * Extract the basis of the new state. The basis was constructed by
+   * prior calls to MlnConfigListAddBasis(melon). Its hash doesn't
+   * depend on the order, so a duplicate state is found before any
+   * sorting.
    */
-  MlnConfigListSortBasis();
-  bp = MlnConfigListBasis();
+  bp = MlnConfigListBasis(melon);
 
   /* Get a state with the same basis. */
-  stp = MlnStateFind(bp);
+  hash = MlnStateHash(melon, bp);
+  stp = MlnStateFind(melon, bp, hash);
   if (stp) {
     /* A state with the same basis already exists! Copy all the follow-set
      * propagation links from the state under construction into the
      * preexisting state, then return a pointer to the preexisting state.
+     * The configurations are most often in the same order in both
+     * bases, and only the others are searched for.
      */
     MlnConfig *x, *y;
-    for (x = bp, y = stp->bp; x && y; x = x->bp, y = y->bp) {
-      MlnPLinkCopy(&y->bpl, x->bpl);
-      MlnPLinkDelete(x->fpl);
-      x->fpl = x->bpl = NULL;
+    for (x = bp, y = stp->bp; x != NULL; x = MlnConfigAt(melon, x->bp)) {
+      if (y == NULL || y->rule != x->rule || y->dot != x->dot) {
+        y = MlnBasisFind(melon, stp->bp, x);
+      }
+      assert(y != NULL);
+      MlnPLinkCopy(melon, &y->bpl, x->bpl);
+      MlnPLinkDelete(melon, x->fpl);
+      x->fpl = x->bpl = MLN_NO_INDEX;
+      y = MlnConfigAt(melon, y->bp);
     }
-    cfp = MlnConfigListReturn();
-    MlnConfigListEat(cfp);
+    cfp = MlnConfigListReturn(melon);
+    MlnConfigListEat(melon, cfp);
   } else {
     /* This really is a new state. Construct all the details. */
+    bp = MlnConfigListSortBasis(melon, bp); /* Sort the configuration basis */
     MlnConfigListClosure(melon); /* Compute the configuration closure */
-    MlnConfigListSort();         /* Sort the configuration closure */
-    cfp = MlnConfigListReturn(); /* Get a pointer to the config list */
+    MlnConfigListSort(melon);         /* Sort the configuration closure */
+    cfp = MlnConfigListReturn(melon); /* Get a pointer to the config list */
     stp = MlnStateNew();         /* A new state structure */
     MlnMemoryCheck(stp);
     stp->bp = bp;                 /* Remember the configuration basis */
     stp->cfp = cfp;               /* Remember the configuration closure */
+    stp->cfg_first = stp->ncfg = 0; /* No compact closure, yet */
+    stp->hash = hash;             /* Remember the hash of the basis */
     stp->index = melon->nstate++; /* Every state gets a sequence number */
     stp->ap = NULL;               /* No actions, yet */
-    MlnStateInsert(stp, stp->bp); /* Add to the state table */
+    stp->nap = stp->nap_alloc = 0;
+    MlnStateInsert(melon, stp, stp->bp); /* Add to the state table */
     MlnBuildShifts(melon, stp);   /* Recursively compute successor states */
   }
 
@@ -237,53 +266,70 @@ static MlnState *MlnGetState(Melon *melon) {
  * state is any state which can be reached by a shift action.
  */
 static void MlnBuildShifts(Melon *melon, MlnState *state) {
-  MlnConfig *cfp;   /* For looping thru the config closure of "state" */
-  MlnConfig *bcfp;  /* For the inner loop on config closure of "state" */
-  MlnConfig *new;   /**/
-  MlnSymbol *sp;    /* Symbol following the dot in configuration "cfp" */
-  MlnSymbol *bsp;   /* Symbol followint the dot in configuration "bcfp" */
-  MlnState *newstp; /* A pointer to a successor state */
-
-  /* Each configuration becomes complete aftet it contributes to a successor
-   * state. Initially, all configurations are incomplete. */
-  for (cfp = state->cfp; cfp != NULL; cfp = cfp->next) {
-    cfp->status = MLN_INCOMPLETE;
-  }
-
-  /* Loop through all configurations of the state "state" */
-  for (cfp = state->cfp; cfp != NULL; cfp = cfp->next) {
-    /* Already used by inner loop. */
-    if (cfp->status == MLN_COMPLETE) {
+  MlnConfig *cfp;     /* For looping thru the config closure of "state" */
+  MlnConfig *new;     /**/
+  MlnConfig **group;  /* The shiftable configurations, grouped by symbol */
+  MlnSymbol **syms;   /* The symbols after the dots, in order of appearance */
+  int *start;         /* Start of the group of each symbol in group[] */
+  MlnState *newstp;   /* A pointer to a successor state */
+  int *mark = melon->shift_mark; /* Stamp of the last visit, by symbol */
+  int *pos = melon->shift_pos;   /* Count, then fill position */
+  int i, j, s, n, nsym, stamp;
+
+  /* Count the configurations which can shift each symbol. */
+  stamp = melon->shift_stamp += 2;
+  n = nsym = 0;
+  for (cfp = state->cfp; cfp != NULL; cfp = MlnConfigAt(melon, cfp->next)) {
+    if (cfp->dot >= cfp->rule->nrhs) {
       continue;
     }
+    s = cfp->rule->rhs[cfp->dot]->index;
+    if (mark[s] != stamp) {
+      mark[s] = stamp;
+      pos[s] = 0;
+      nsym++;
+    }
+    pos[s]++;
+    n++;
+  }
+  if (n == 0) {
+    return;
+  }
 
-    /* Can't shift this config. */
+  /* Group them by the symbol after the dot. The symbols keep the order
+   * in which they first appear, and the configurations of a symbol
+   * their order in the state, so the states are numbered as if every
+   * group were collected by a scan of the closure. */
+  group = malloc(sizeof(MlnConfig *) * n);
+  syms = malloc(sizeof(MlnSymbol *) * nsym);
+  start = malloc(sizeof(int) * (nsym + 1));
+  MlnMemoryCheck(group);
+  MlnMemoryCheck(syms);
+  MlnMemoryCheck(start);
+  nsym = j = 0;
+  for (cfp = state->cfp; cfp != NULL; cfp = MlnConfigAt(melon, cfp->next)) {
     if (cfp->dot >= cfp->rule->nrhs) {
       continue;
     }
-    MlnConfigListReset();          /* Reset the new config set. */
-    sp = cfp->rule->rhs[cfp->dot]; /* Symbol after the dot. */
-
-    /* For every configuration in the state "state" which has the symbol "sp"
-     * following its dot, add the same configuration to the basis set under
-     * construction but with the dot shifted one symbol to the right. */
-    for (bcfp = cfp; bcfp != NULL; bcfp = bcfp->next) {
-      /* Already used. */
-      if (bcfp->status == MLN_COMPLETE) {
-        continue;
-      }
-      /* Can't shift this one. */
-      if (bcfp->dot >= bcfp->rule->nrhs) {
-        continue;
-      }
-      bsp = bcfp->rule->rhs[bcfp->dot]; /* Get symbole after dot. */
-      /* Must be same as for "cfp". */
-      if (bsp != sp) {
-        continue;
-      }
-      bcfp->status = MLN_COMPLETE; /* Mark this config as used. */
-      new = MlnConfigListAddBasis(bcfp->rule, bcfp->dot + 1);
-      MlnPLinkAdd(&new->bpl, bcfp);
+    s = cfp->rule->rhs[cfp->dot]->index;
+    if (mark[s] == stamp) {
+      mark[s] = stamp + 1;
+      syms[nsym] = cfp->rule->rhs[cfp->dot];
+      start[nsym++] = j;
+      j += pos[s];
+      pos[s] = start[nsym - 1];
+    }
+    group[pos[s]++] = cfp;
+  }
+  start[nsym] = n;
+
+  for (i = 0; i < nsym; i++) {
+    /* Add every configuration of the group to the basis set under
+     * construction, with the dot shifted one symbol to the right. */
+    MlnConfigListReset(melon);
+    for (j = start[i]; j < start[i + 1]; j++) {
+      new = MlnConfigListAddBasis(melon, group[j]->rule, group[j]->dot + 1);
+      MlnPLinkAdd(melon, &new->bpl, group[j]->index);
     }
 
     /* Get a pointer to the state described by the basis configuration
@@ -291,82 +337,163 @@ static void MlnBuildShifts(Melon *melon, MlnState *state) {
     newstp = MlnGetState(melon);
 
     /* The state "newstp" is reached from the state "state" by a shift
-     * action on the symbol "sp" */
-    MlnActionAdd(&state->ap, MLN_SHIFT, sp, newstp);
+     * action on the symbol syms[i] */
+    MlnActionAdd(state, MLN_SHIFT, syms[i]->index, newstp->index);
   }
+  free(start);
+  free(syms);
+  free(group);
 }
 
 /*
- * Construct the propagation links.
+ * Switch to the compact configuration storage, and construct the
+ * propagation links. The links are stored as a compressed sparse row
+ * array: the configurations to which the follow set of configuration
+ * i propagates are
+ *
+ *    melon->links[melon->link_first[i] .. melon->link_first[i + 1] - 1]
+ *
+ * Forward links are taken as they are, and backward links reversed.
+ * The linked configurations and their link lists are released.
  */
 void MlnFindLinks(Melon *melon) {
-  int i;
-
-  /* Add to every propagate link a pointer back to the state to
-   * which the link is attached. */
+  int i, n, pl;
+  int *fill;
+  MlnConfig *cfp, *bp;
+  MlnPLink *plp;
+
+  /* Number the configurations in the order of the compact array. Their
+   * own index is no longer needed, the links address them by it. */
+  n = 0;
   for (i = 0; i < melon->nstate; i++) {
-    MlnState *state = melon->sorted[i];
-    MlnConfig *cfp;
-    for (cfp = state->cfp; cfp != NULL; cfp = cfp->next) {
-      cfp->st = state;
+    for (cfp = melon->sorted[i]->cfp; cfp != NULL;
+         cfp = MlnConfigAt(melon, cfp->next)) {
+      cfp->index = n++;
+    }
+  }
+  melon->configs = calloc(n > 0 ? n : 1, sizeof(MlnCompactConfig));
+  melon->link_first = calloc(n + 1, sizeof(int));
+  fill = malloc(sizeof(int) * (n + 1));
+  MlnMemoryCheck(melon->configs);
+  MlnMemoryCheck(melon->link_first);
+  MlnMemoryCheck(fill);
+  melon->nconfig = n;
+
+  /* Count the links from every configuration */
+  for (i = 0; i < melon->nstate; i++) {
+    for (cfp = melon->sorted[i]->cfp; cfp != NULL;
+         cfp = MlnConfigAt(melon, cfp->next)) {
+      for (pl = cfp->fpl; pl != MLN_NO_INDEX; pl = plp->next) {
+        plp = MlnPLinkAt(melon, pl);
+        melon->link_first[cfp->index + 1]++;
+      }
+      for (pl = cfp->bpl; pl != MLN_NO_INDEX; pl = plp->next) {
+        plp = MlnPLinkAt(melon, pl);
+        melon->link_first[MlnConfigAt(melon, plp->config)->index + 1]++;
+      }
     }
   }
+  for (i = 0; i < n; i++) {
+    melon->link_first[i + 1] += melon->link_first[i];
+    fill[i] = melon->link_first[i];
+  }
+  melon->links = malloc(sizeof(int) * (melon->link_first[n] + 1));
+  MlnMemoryCheck(melon->links);
+  for (i = 0; i < melon->nstate; i++) {
+    for (cfp = melon->sorted[i]->cfp; cfp != NULL;
+         cfp = MlnConfigAt(melon, cfp->next)) {
+      for (pl = cfp->fpl; pl != MLN_NO_INDEX; pl = plp->next) {
+        plp = MlnPLinkAt(melon, pl);
+        melon->links[fill[cfp->index]++] =
+            MlnConfigAt(melon, plp->config)->index;
+      }
+      for (pl = cfp->bpl; pl != MLN_NO_INDEX; pl = plp->next) {
+        plp = MlnPLinkAt(melon, pl);
+        melon->links[fill[MlnConfigAt(melon, plp->config)->index]++] =
+            cfp->index;
+      }
+    }
+  }
+  free(fill);
 
-  /* Convert all backlinks into forward links. Only the forward
-   * links are used in the follow-set computation. */
+  n = 0;
   for (i = 0; i < melon->nstate; i++) {
     MlnState *state = melon->sorted[i];
-    MlnConfig *cfp;
-    for (cfp = state->cfp; cfp != NULL; cfp = cfp->next) {
-      MlnPLink *pl;
-      for (pl = cfp->bpl; pl != NULL; pl = pl->next) {
-        MlnConfig *other = pl->config;
-        MlnPLinkAdd(&other->fpl, cfp);
+    state->cfg_first = n;
+    /* The basis is sorted the same way as the closure, so it is
+     * a subsequence of it. */
+    bp = state->bp;
+    for (cfp = state->cfp; cfp != NULL; cfp = MlnConfigAt(melon, cfp->next)) {
+      MlnCompactConfig *ccp = &melon->configs[n++];
+      ccp->rule = cfp->rule;
+      ccp->fws = cfp->fws; /* The follow set moves */
+      cfp->fws = NULL;
+      ccp->dot = cfp->dot;
+      ccp->is_basis = (cfp == bp);
+      if (cfp == bp) {
+        bp = MlnConfigAt(melon, bp->bp);
       }
     }
+    assert(bp == NULL);
+    state->ncfg = n - state->cfg_first;
+    state->bp = state->cfp = NULL;
   }
+
+  MlnConfigListFree(melon);
+  MlnPLinkFreeAll(melon);
 }
 
 /* Compute all followsets.
  *
  * A followset is the set of all symbols which can come immediately
- * after a configuration.
+ * after a configuration. The sets are interned, and many configurations
+ * share theirs, so a propagation is a cached union of two shared sets.
+ * The propagation links are released when done.
  */
 void MlnFindFollowSets(Melon *melon) {
-  int i;
+  int i, j;
   int progress;
+  char *incomplete = malloc(melon->nconfig + 1);
 
-  for (i = 0; i < melon->nstate; i++) {
-    MlnConfig *cfp;
-    for (cfp = melon->sorted[i]->cfp; cfp != NULL; cfp = cfp->next) {
-      cfp->status = MLN_INCOMPLETE;
-    }
-  }
+  MlnMemoryCheck(incomplete);
+  memset(incomplete, 1, melon->nconfig);
 
   do {
     progress = 0;
-    for (i = 0; i < melon->nstate; i++) {
-      MlnConfig *cfp;
-      for (cfp = melon->sorted[i]->cfp; cfp != NULL; cfp = cfp->next) {
-        MlnPLink *pl;
-        if (cfp->status == MLN_COMPLETE) {
-          continue;
-        }
-
-        for (pl = cfp->fpl; pl != NULL; pl = pl->next) {
-          int change = MlnSetUnion(pl->config->fws, cfp->fws);
-          if (change != 0) {
-            pl->config->status = MLN_INCOMPLETE;
-            progress = 1;
-          }
+    for (i = 0; i < melon->nconfig; i++) {
+      char *fws = melon->configs[i].fws;
+      if (!incomplete[i]) {
+        continue;
+      }
+      for (j = melon->link_first[i]; j < melon->link_first[i + 1]; j++) {
+        MlnCompactConfig *cfp = &melon->configs[melon->links[j]];
+        char *set = MlnSetInternUnion(melon, cfp->fws, fws);
+        if (set != cfp->fws) {
+          MlnSetRelease(melon, cfp->fws);
+          cfp->fws = set;
+          incomplete[melon->links[j]] = 1;
+          progress = 1;
+        } else {
+          MlnSetRelease(melon, set);
         }
-        cfp->status = MLN_COMPLETE;
       }
+      incomplete[i] = 0;
     }
   } while (progress != 0);
+
+  MlnSetInternFlush(melon);
+  free(incomplete);
+  free(melon->link_first);
+  free(melon->links);
+  melon->link_first = NULL;
+  melon->links = NULL;
 }
 
-static int MlnResolveConflict(MlnAction *apx, MlnAction *apy);
+
+static int MlnResolveConflict(Melon *melon, MlnRule **rules, MlnAction *apx,
+                              MlnAction *apy);
+static void MlnPruneStates(Melon *melon);
+static void MlnPruneRules(Melon *melon, MlnRule **rules);
 
 /*
  * Compute the reduce actions, and resolve conflicts.
@@ -375,6 +502,34 @@ void MlnFindActions(Melon *melon) {
   int i, j;
   MlnSymbol *sym;
   MlnRule *rule;
+  MlnRule **rules;  /* All rules, indexed by rule number */
+  int *list_first;  /* Start of the terminals of each follow set */
+  int *list_end;    /* End of them, both by the serial of the set */
+  int *terms;       /* The terminals of all follow sets listed */
+  int nterm, nterm_alloc;
+  unsigned s, nserial;
+
+  rules = malloc(sizeof(rules[0]) * (melon->nrule > 0 ? melon->nrule : 1));
+  MlnMemoryCheck(rules);
+  for (rule = melon->rule; rule != NULL; rule = rule->next) {
+    rules[rule->index] = rule;
+  }
+
+  /* The follow sets are interned, so many configurations share one.
+   * The terminals of every distinct set are listed once, the first
+   * time it is met, and found again by its serial number. */
+  nserial = melon->set_pool.serial + 1;
+  list_first = malloc(sizeof(int) * nserial);
+  list_end = malloc(sizeof(int) * nserial);
+  nterm_alloc = melon->nterminal > 0 ? melon->nterminal : 1;
+  terms = malloc(sizeof(int) * nterm_alloc);
+  MlnMemoryCheck(list_first);
+  MlnMemoryCheck(list_end);
+  MlnMemoryCheck(terms);
+  for (s = 0; s < nserial; s++) {
+    list_first[s] = -1;
+  }
+  nterm = 0;
 
   /* Add all of the reduce actions.
    *
@@ -383,24 +538,43 @@ void MlnFindActions(Melon *melon) {
    */
   for (i = 0; i < melon->nstate; i++) {
     MlnState *state = melon->sorted[i];
-    MlnConfig *cfp;
-    for (cfp = state->cfp; cfp != NULL; cfp = cfp->next) {
-      if (cfp->rule->nrhs == cfp->dot) { /* Is dot at extreme right? */
+    MlnCompactConfig *cfp = &melon->configs[state->cfg_first];
+    MlnCompactConfig *end = cfp + state->ncfg;
+    for (; cfp < end; cfp++) {
+      if (cfp->rule->nrhs != cfp->dot) { /* Is dot at extreme right? */
+        continue;
+      }
+      s = MlnSetSerial(cfp->fws);
+      if (list_first[s] < 0) {
+        list_first[s] = nterm;
         for (j = 0; j < melon->nterminal; j++) {
-          if (MlnSetFind(cfp->fws, j)) {
-            /* Add a reduce action to the state "state" which will
-             * reduce by the rule "cfp->rule" if the lookahead symbol
-             * is "melon->symbols[j]".*/
-            MlnActionAdd(&state->ap, MLN_REDUCE, melon->symbols[j], cfp->rule);
+          if (!MlnSetFind(cfp->fws, j)) {
+            continue;
+          }
+          if (nterm >= nterm_alloc) {
+            nterm_alloc *= 2;
+            terms = realloc(terms, sizeof(int) * nterm_alloc);
+            MlnMemoryCheck(terms);
           }
+          terms[nterm++] = j;
         }
+        list_end[s] = nterm;
+      }
+      for (j = list_first[s]; j < list_end[s]; j++) {
+        /* Add a reduce action to the state "state" which will reduce
+         * by the rule "cfp->rule" if the lookahead symbol is
+         * "melon->symbols[terms[j]]". */
+        MlnActionAdd(state, MLN_REDUCE, terms[j], cfp->rule->index);
       }
     }
   }
+  free(terms);
+  free(list_end);
+  free(list_first);
 
   /* Add the accepting token */
   if (melon->start != NULL) {
-    sym = MlnSymbolFind(melon->start);
+    sym = MlnSymbolFind(melon, melon->start);
     if (sym == NULL) {
       sym = melon->rule->lhs;
     }
@@ -411,38 +585,47 @@ void MlnFindActions(Melon *melon) {
   /* Add to the first state (which is always the starting state of the
    * finite state machine) an action to MLN_ACCEPT if the lookahead is
    * the start nonterminal. */
-  MlnActionAdd(&melon->sorted[0]->ap, MLN_ACCEPT, sym, NULL);
+  MlnActionAdd(melon->sorted[0], MLN_ACCEPT, sym->index, 0);
 
-  /* Resolve conflicts */
+  /* Resolve conflicts. Once sorted, actions with the same look-ahead
+   * are adjacent in the array of each state. */
   for (i = 0; i < melon->nstate; i++) {
     MlnState *state;
-    MlnAction *ap, *nap;
+    MlnAction *ap, *nap, *end;
 
     state = melon->sorted[i];
-    assert(state->ap);
-    state->ap = MlnActionSort(state->ap);
-    for (ap = state->ap; ap != NULL && ap->next; ap = ap->next) {
-      for (nap = ap->next; nap != NULL && nap->sym == ap->sym;
-           nap = nap->next) {
+    assert(state->nap > 0);
+    MlnActionSort(state);
+    end = &state->ap[state->nap];
+    for (ap = state->ap; ap < end; ap++) {
+      for (nap = ap + 1; nap < end && nap->sym == ap->sym; nap++) {
         /* The two actions "ap" and "nap" have the same lookahead.
          * Figure out which one should be used */
-        melon->nconflict += MlnResolveConflict(ap, nap);
+        melon->nconflict += MlnResolveConflict(melon, rules, ap, nap);
       }
     }
   }
 
+  /* Drop the states that resolved conflicts made unreachable */
+  if (melon->prune) {
+    MlnPruneStates(melon);
+  }
+
   /* Report an error for each rule that can never be reduced. */
   for (rule = melon->rule; rule != NULL; rule = rule->next) {
     rule->can_reduce = MLN_FALSE;
   }
   for (i = 0; i < melon->nstate; i++) {
-    MlnAction *ap;
-    for (ap = melon->sorted[i]->ap; ap != NULL; ap = ap->next) {
-      if (ap->type == MLN_REDUCE) {
-        ap->x.rule->can_reduce = MLN_TRUE;
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap; j++) {
+      if (state->ap[j].type == MLN_REDUCE) {
+        rules[state->ap[j].x.rule]->can_reduce = MLN_TRUE;
       }
     }
   }
+  if (melon->prune) {
+    MlnPruneRules(melon, rules);
+  }
   for (rule = melon->rule; rule != NULL; rule = rule->next) {
     if (rule->can_reduce) {
       continue;
@@ -452,6 +635,7 @@ void MlnFindActions(Melon *melon) {
                 "This rule can not be reduced.\n");
     melon->error_cnt++;
   }
+  free(rules);
 }
 
 /*
@@ -461,12 +645,13 @@ void MlnFindActions(Melon *melon) {
  * If either action is a MLN_SHIFT, the it must be apx. This
  * function won't work if apx->type == MLN_REDUCE, and apy == MLN_SHIFT.
  */
-static int MlnResolveConflict(MlnAction *apx, MlnAction *apy) {
+static int MlnResolveConflict(Melon *melon, MlnRule **rules, MlnAction *apx,
+                              MlnAction *apy) {
   int err_cnt = 0;
   assert(apx->sym == apy->sym); /* Otherwise there would be no conflict */
   if (apx->type == MLN_SHIFT && apy->type == MLN_REDUCE) {
-    MlnSymbol *spx = apx->sym;
-    MlnSymbol *spy = apy->x.rule->prec_sym;
+    MlnSymbol *spx = melon->symbols[apx->sym];
+    MlnSymbol *spy = rules[apy->x.rule]->prec_sym;
     if (spy == NULL || spx->prec < 0 || spy->prec < 0) {
       /* Not enough precedence information */
       apy->type = MLN_CONFLICT;
@@ -485,11 +670,11 @@ static int MlnResolveConflict(MlnAction *apx, MlnAction *apy) {
       err_cnt++;
     }
   } else if (apx->type == MLN_REDUCE && apy->type == MLN_REDUCE) {
-    MlnSymbol *spx = apx->x.rule->prec_sym;
-    MlnSymbol *spy = apy->x.rule->prec_sym;
+    MlnSymbol *spx = rules[apx->x.rule]->prec_sym;
+    MlnSymbol *spy = rules[apy->x.rule]->prec_sym;
     if (spx == NULL || spy == NULL || spx->prec < 0 || spy->prec < 0 ||
         spx->prec == spy->prec) {
-      spy->type = MLN_CONFLICT;
+      apy->type = MLN_CONFLICT;
       err_cnt++;
     } else if (spx->prec > spy->prec) {
       apy->type = MLN_RD_RESOLVED;
@@ -506,3 +691,317 @@ static int MlnResolveConflict(MlnAction *apx, MlnAction *apy) {
   }
   return err_cnt;
 }
+
+/*
+ * Relink the rules of every left-hand side, in order, after some
+ * rules were removed.
+ */
+static void MlnLinkRules(Melon *melon) {
+  MlnRule *rp;
+  for (rp = melon->rule; rp != NULL; rp = rp->next) {
+    rp->lhs->rule = NULL;
+    rp->next_lhs = NULL;
+  }
+  for (rp = melon->rule; rp != NULL; rp = rp->next) {
+    MlnRule **tail = &rp->lhs->rule;
+    while (*tail != NULL) {
+      tail = &(*tail)->next_lhs;
+    }
+    *tail = rp;
+  }
+}
+
+/*
+ * Remove the useless parts of the grammar: the nonterminals which can't
+ * derive a string of terminals, and the rules and nonterminals which
+ * can't be reached from the start symbol. Terminals and the error
+ * symbol are always kept, so the token codes don't change. The rules
+ * and nonterminals left are renumbered. Nothing is removed if the start
+ * symbol itself derives no string.
+ */
+void MlnPruneGrammar(Melon *melon) {
+  MlnSymbol *start;
+  MlnRule *rp, **link;
+  char *useful; /* Per symbol: productive, then productive and reachable */
+  int i, n, progress;
+
+  if (melon->start == NULL ||
+      (start = MlnSymbolFind(melon, melon->start)) == NULL ||
+      start->rule == NULL) {
+    start = melon->rule->lhs;
+  }
+
+  useful = calloc(melon->nsymbol + 1, 1);
+  MlnMemoryCheck(useful);
+  for (i = 0; i < melon->nterminal; i++) {
+    useful[i] = 1;
+  }
+  useful[melon->err_sym->index] = 1;
+
+  /* Find the productive symbols */
+  do {
+    progress = 0;
+    for (rp = melon->rule; rp != NULL; rp = rp->next) {
+      if (useful[rp->lhs->index]) {
+        continue;
+      }
+      for (i = 0; i < rp->nrhs && useful[rp->rhs[i]->index]; i++) {
+      }
+      if (i == rp->nrhs) {
+        useful[rp->lhs->index] = 1;
+        progress = 1;
+      }
+    }
+  } while (progress);
+  if (!useful[start->index]) {
+    free(useful);
+    return;
+  }
+
+  /* Of those, find the ones reachable from the start symbol. A mark of
+   * 2 means reachable. */
+  useful[start->index] = 2;
+  do {
+    progress = 0;
+    for (rp = melon->rule; rp != NULL; rp = rp->next) {
+      if (useful[rp->lhs->index] != 2) {
+        continue;
+      }
+      for (i = 0; i < rp->nrhs && useful[rp->rhs[i]->index]; i++) {
+      }
+      if (i < rp->nrhs) {
+        continue;
+      }
+      for (i = 0; i < rp->nrhs; i++) {
+        if (useful[rp->rhs[i]->index] == 1 &&
+            rp->rhs[i]->index >= melon->nterminal) {
+          useful[rp->rhs[i]->index] = 2;
+          progress = 1;
+        }
+      }
+    }
+  } while (progress);
+
+  /* Keep the rules of reachable symbols whose right-hand side is all
+   * productive */
+  n = 0;
+  link = &melon->rule;
+  while ((rp = *link) != NULL) {
+    for (i = 0; i < rp->nrhs && useful[rp->rhs[i]->index]; i++) {
+    }
+    if (useful[rp->lhs->index] == 2 && i == rp->nrhs) {
+      rp->index = n++;
+      link = &rp->next;
+    } else {
+      *link = rp->next;
+      free(rp);
+    }
+  }
+  melon->nprune_rule = melon->nrule - n;
+  melon->nrule = n;
+
+  /* Keep the reachable nonterminals, and "{default}" last */
+  n = melon->nterminal;
+  for (i = melon->nterminal; i <= melon->nsymbol; i++) {
+    MlnSymbol *sp = melon->symbols[i];
+    if (useful[i] == 2 || sp == melon->err_sym || i == melon->nsymbol) {
+      melon->symbols[n++] = sp;
+    } else {
+      sp->rule = NULL;
+    }
+  }
+  melon->nprune_symbol = melon->nsymbol + 1 - n;
+  melon->nsymbol = n - 1;
+  for (i = 0; i <= melon->nsymbol; i++) {
+    melon->symbols[i]->index = i;
+    melon->symbols[i]->rule = NULL;
+  }
+
+  MlnLinkRules(melon);
+  free(useful);
+}
+
+/*
+ * Remove the states which can't be reached from the first state once
+ * conflicts are resolved, and renumber the states left.
+ */
+static void MlnPruneStates(Melon *melon) {
+  MlnState **stack;
+  MlnCompactConfig *configs;
+  int *map; /* New number of every state, -1 if unreachable */
+  int i, j, n, top;
+
+  map = malloc(sizeof(map[0]) * melon->nstate);
+  stack = malloc(sizeof(stack[0]) * melon->nstate);
+  MlnMemoryCheck(map);
+  MlnMemoryCheck(stack);
+  for (i = 0; i < melon->nstate; i++) {
+    map[i] = -1;
+  }
+  map[0] = 0;
+  stack[0] = melon->sorted[0];
+  top = 1;
+  while (top > 0) {
+    MlnState *state = stack[--top];
+    for (j = 0; j < state->nap; j++) {
+      MlnAction *ap = &state->ap[j];
+      if (ap->type == MLN_SHIFT && map[ap->x.state] < 0) {
+        map[ap->x.state] = 0;
+        stack[top++] = melon->sorted[ap->x.state];
+      }
+    }
+  }
+  free(stack);
+
+  n = 0;
+  for (i = 0; i < melon->nstate; i++) {
+    if (map[i] == 0) {
+      map[i] = n++;
+    }
+  }
+  melon->nprune_state = melon->nstate - n;
+  if (n == melon->nstate) {
+    free(map);
+    return;
+  }
+
+  /* Move the states and their configurations down */
+  configs = malloc(sizeof(configs[0]) * melon->nconfig);
+  MlnMemoryCheck(configs);
+  n = 0;
+  j = 0;
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    MlnCompactConfig *cfp = &melon->configs[state->cfg_first];
+    MlnCompactConfig *end = cfp + state->ncfg;
+    if (map[i] < 0) {
+      for (; cfp < end; cfp++) {
+        if (cfp->fws != NULL) {
+          MlnSetRelease(melon, cfp->fws);
+        }
+      }
+      free(state->ap);
+      free(state);
+      continue;
+    }
+    state->index = map[i];
+    state->cfg_first = j;
+    for (; cfp < end; cfp++) {
+      configs[j++] = *cfp;
+    }
+    melon->sorted[n++] = state;
+  }
+  free(melon->configs);
+  melon->configs = configs;
+  melon->nconfig = j;
+  melon->nstate = n;
+
+  /* Renumber the targets of the shifts. A shift resolved away may lead
+   * to a removed state; it is never used again. */
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap; j++) {
+      MlnAction *ap = &state->ap[j];
+      if (ap->type == MLN_SHIFT || ap->type == MLN_SH_RESOLVED) {
+        if (map[ap->x.state] < 0) {
+          ap->type = NOT_USED;
+          ap->x.state = 0;
+        } else {
+          ap->x.state = map[ap->x.state];
+        }
+      }
+    }
+  }
+  free(map);
+}
+
+/*
+ * Remove the rules which precedence and the removal of states left
+ * without a reduce, with a note for each, and renumber the rules left.
+ * A rule which lost an unresolved conflict is kept, to be reported.
+ * "rules" holds every rule by its number, and can_reduce is set.
+ */
+static void MlnPruneRules(Melon *melon, MlnRule **rules) {
+  MlnRule *rp, **link;
+  MlnCompactConfig *cfp;
+  int *map; /* New number of every rule, -1 if removed */
+  int i, j, n, first;
+
+  map = malloc(sizeof(map[0]) * (melon->nrule > 0 ? melon->nrule : 1));
+  MlnMemoryCheck(map);
+  for (i = 0; i < melon->nrule; i++) {
+    map[i] = rules[i]->can_reduce ? 0 : -1;
+  }
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap; j++) {
+      if (state->ap[j].type == MLN_CONFLICT) {
+        map[state->ap[j].x.rule] = 0;
+      }
+    }
+  }
+  n = 0;
+  for (i = 0; i < melon->nrule; i++) {
+    if (map[i] == 0) {
+      map[i] = n++;
+    }
+  }
+  if (n == melon->nrule) {
+    free(map);
+    return;
+  }
+
+  /* Drop the configurations of the rules removed */
+  j = 0;
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    MlnCompactConfig *end = &melon->configs[state->cfg_first + state->ncfg];
+    first = j;
+    for (cfp = &melon->configs[state->cfg_first]; cfp < end; cfp++) {
+      if (map[cfp->rule->index] >= 0) {
+        melon->configs[j++] = *cfp;
+      } else if (cfp->fws != NULL) {
+        MlnSetRelease(melon, cfp->fws);
+      }
+    }
+    state->cfg_first = first;
+    state->ncfg = j - first;
+  }
+  melon->nconfig = j;
+
+  /* Renumber the reduces. Only resolved ones can be of a rule removed. */
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap; j++) {
+      MlnAction *ap = &state->ap[j];
+      if (ap->type == MLN_REDUCE || ap->type == MLN_RD_RESOLVED ||
+          ap->type == MLN_CONFLICT) {
+        if (map[ap->x.rule] < 0) {
+          ap->type = NOT_USED;
+          ap->x.rule = 0;
+        } else {
+          ap->x.rule = map[ap->x.rule];
+        }
+      }
+    }
+  }
+
+  /* Remove the rules */
+  link = &melon->rule;
+  while ((rp = *link) != NULL) {
+    if (map[rp->index] < 0) {
+      MlnErrorMsg(melon->filename, rp->rule_line,
+                  "Note: this rule is never reduced, and is removed.");
+      *link = rp->next;
+      free(rp);
+    } else {
+      rp->index = map[rp->index];
+      link = &rp->next;
+    }
+  }
+  melon->nunreduced = melon->nrule - n;
+  melon->nprune_rule += melon->nunreduced;
+  melon->nrule = n;
+  MlnLinkRules(melon);
+  free(map);
+}
@@ -8,6 +8,7 @@
 
 #include "struct.h"
 
+void MlnPruneGrammar(Melon *melon);
 void MlnFindRulePrecedences(Melon *melon);
 void MlnFindFirstSets(Melon *melon);
 void MlnFindStates(Melon *melon);
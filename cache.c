@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ *
+ * On-disk cache of the computed automaton. The states, their
+ * configurations and their (compressed) actions are written to a
+ * "*.mlc" file next to the outputs, keyed by a hash of the structural
+ * content of the grammar. Code-only edits of the grammar can then
+ * skip the whole LALR(1) construction.
+ *
+ * The file is a native-endian sequence of ints:
+ *
+ *    magic version key-low key-high nstate nconfig nconflict
+ *    nstate * { ncfg nap }
+ *    nconfig * { rule dot is_basis }
+ *    sum(nap) * { sym type arg }
+ */
+
+#include "cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "report.h"
+#include "table.h"
+
+static const int kCacheMagic = 0x434E4C4D; /* "MLNC" */
+static const int kCacheVersion = 1;
+static const char *kCacheSuffix = ".mlc";
+
+/*
+ * Hash an integer into a running 64-bit FNV-1a hash.
+ */
+static unsigned long long MlnCacheHashInt(unsigned long long h, int x) {
+  int i;
+  for (i = 0; i < 4; i++) {
+    h ^= (unsigned)x & 0xFF;
+    h *= 0x100000001B3ULL;
+    x >>= 8;
+  }
+  return h;
+}
+
+/*
+ * Hash a string (including its terminator) into a running hash.
+ */
+static unsigned long long MlnCacheHashStr(unsigned long long h,
+                                          const char *s) {
+  do {
+    h ^= (unsigned char)*s;
+    h *= 0x100000001B3ULL;
+  } while (*s++ != '\0');
+  return h;
+}
+
+/*
+ * Compute the key of the automaton. Only what affects the states and
+ * the actions is hashed: symbols with their precedence, associativity
+ * and fallback, the rules with their precedence symbol, and the start
+ * symbol. Action code, types and destructors are left out.
+ */
+unsigned long long MlnCacheKey(Melon *melon, int compress) {
+  unsigned long long h = 0xCBF29CE484222325ULL;
+  MlnRule *rp;
+  int i;
+
+  h = MlnCacheHashInt(h, kCacheVersion);
+  h = MlnCacheHashInt(h, compress);
+  h = MlnCacheHashInt(h, melon->prune);
+  h = MlnCacheHashInt(h, melon->nsymbol);
+  h = MlnCacheHashInt(h, melon->nterminal);
+  h = MlnCacheHashInt(h, melon->nrule);
+  for (i = 0; i <= melon->nsymbol; i++) {
+    MlnSymbol *sp = melon->symbols[i];
+    h = MlnCacheHashStr(h, sp->name);
+    h = MlnCacheHashInt(h, sp->prec);
+    h = MlnCacheHashInt(h, sp->assoc);
+    h = MlnCacheHashInt(h, sp->fallback ? sp->fallback->index : -1);
+  }
+  h = MlnCacheHashStr(h, melon->start ? melon->start : "");
+  for (rp = melon->rule; rp != NULL; rp = rp->next) {
+    h = MlnCacheHashInt(h, rp->index);
+    h = MlnCacheHashInt(h, rp->lhs->index);
+    h = MlnCacheHashInt(h, rp->nrhs);
+    for (i = 0; i < rp->nrhs; i++) {
+      h = MlnCacheHashInt(h, rp->rhs[i]->index);
+    }
+    h = MlnCacheHashInt(h, rp->prec_sym ? rp->prec_sym->index : -1);
+  }
+  return h;
+}
+
+static void MlnCacheWrite(FILE *fp, int x) { fwrite(&x, sizeof(x), 1, fp); }
+
+/*
+ * Read one int into "x". Return 0 at end of file, and when the
+ * value is not within [lwr, upr].
+ */
+static int MlnCacheRead(FILE *fp, int *x, int lwr, int upr) {
+  if (fread(x, sizeof(*x), 1, fp) != 1) {
+    return 0;
+  }
+  return *x >= lwr && *x <= upr;
+}
+
+/*
+ * Load the automaton of the grammar from its cache file. Return
+ * non-zero if the cache was valid for the grammar and melon now holds
+ * the states, configurations and actions. Otherwise return 0 and
+ * leave melon unchanged.
+ */
+int MlnCacheLoad(Melon *melon, int compress) {
+  unsigned long long key;
+  char *name;
+  FILE *fp;
+  MlnRule *rp;
+  MlnRule **rules = NULL;
+  MlnState **sorted = NULL;
+  MlnCompactConfig *configs = NULL;
+  int header[7];
+  int nstate, nconfig;
+  int i, j, x, ok;
+
+  name = MlnFileMakeName(melon, kCacheSuffix);
+  fp = fopen(name, "rb");
+  free(name);
+  if (fp == NULL) {
+    return 0;
+  }
+
+  key = MlnCacheKey(melon, compress);
+  ok = fread(header, sizeof(header[0]), 7, fp) == 7 &&
+       header[0] == kCacheMagic && header[1] == kCacheVersion &&
+       (unsigned)header[2] == (unsigned)(key & 0xFFFFFFFF) &&
+       (unsigned)header[3] == (unsigned)(key >> 32) && header[4] > 0 &&
+       header[5] >= 0 && header[6] >= 0;
+  if (!ok) {
+    fclose(fp);
+    return 0;
+  }
+  nstate = header[4];
+  nconfig = header[5];
+
+  rules = malloc(sizeof(rules[0]) * melon->nrule);
+  sorted = malloc(sizeof(sorted[0]) * nstate);
+  configs = malloc(sizeof(configs[0]) * (nconfig > 0 ? nconfig : 1));
+  MlnMemoryCheck(rules);
+  MlnMemoryCheck(sorted);
+  MlnMemoryCheck(configs);
+  for (rp = melon->rule; rp != NULL; rp = rp->next) {
+    rules[rp->index] = rp;
+  }
+  for (i = 0; i < nstate; i++) {
+    sorted[i] = MlnStateNew();
+    memset(sorted[i], 0, sizeof(MlnState));
+  }
+
+  x = 0;
+  for (i = 0; ok && i < nstate; i++) {
+    MlnState *state = sorted[i];
+    state->index = i;
+    state->cfg_first = x;
+    ok = MlnCacheRead(fp, &state->ncfg, 0, nconfig - x) &&
+         MlnCacheRead(fp, &state->nap, 0, 0x7FFFFFFF);
+    x += state->ncfg;
+  }
+  ok = ok && x == nconfig;
+
+  for (i = 0; ok && i < nconfig; i++) {
+    MlnCompactConfig *cfp = &configs[i];
+    ok = MlnCacheRead(fp, &x, 0, melon->nrule - 1);
+    if (ok) {
+      cfp->rule = rules[x];
+      cfp->fws = NULL;
+      ok = MlnCacheRead(fp, &cfp->dot, 0, cfp->rule->nrhs) &&
+           MlnCacheRead(fp, &cfp->is_basis, 0, 1);
+    }
+  }
+
+  for (i = 0; ok && i < nstate; i++) {
+    MlnState *state = sorted[i];
+    state->nap_alloc = state->nap;
+    state->ap = malloc(sizeof(MlnAction) * (state->nap > 0 ? state->nap : 1));
+    MlnMemoryCheck(state->ap);
+    for (j = 0; ok && j < state->nap; j++) {
+      MlnAction *ap = &state->ap[j];
+      ok = MlnCacheRead(fp, &ap->sym, 0, melon->nsymbol) &&
+           MlnCacheRead(fp, &x, MLN_SHIFT, NOT_USED) &&
+           MlnCacheRead(fp, &ap->x.state, 0, nstate + melon->nrule);
+      ap->type = x;
+    }
+  }
+  fclose(fp);
+  free(rules);
+
+  if (!ok) {
+    for (i = 0; i < nstate; i++) {
+      free(sorted[i]->ap);
+      free(sorted[i]);
+    }
+    free(sorted);
+    free(configs);
+    return 0;
+  }
+
+  melon->sorted = sorted;
+  melon->nstate = nstate;
+  melon->configs = configs;
+  melon->nconfig = nconfig;
+  melon->nconflict = header[6];
+  return 1;
+}
+
+/*
+ * Write the automaton of the grammar to its cache file. A failure to
+ * write the cache is reported, but is not an error.
+ */
+void MlnCacheSave(Melon *melon, int compress) {
+  unsigned long long key;
+  char *name;
+  FILE *fp;
+  int i, j;
+
+  name = MlnFileMakeName(melon, kCacheSuffix);
+  fp = fopen(name, "wb");
+  if (fp == NULL) {
+    fprintf(MlnErrorStream(stderr), "Can't open file \"%s\".\n", name);
+    free(name);
+    return;
+  }
+
+  key = MlnCacheKey(melon, compress);
+  MlnCacheWrite(fp, kCacheMagic);
+  MlnCacheWrite(fp, kCacheVersion);
+  MlnCacheWrite(fp, (int)(unsigned)(key & 0xFFFFFFFF));
+  MlnCacheWrite(fp, (int)(unsigned)(key >> 32));
+  MlnCacheWrite(fp, melon->nstate);
+  MlnCacheWrite(fp, melon->nconfig);
+  MlnCacheWrite(fp, melon->nconflict);
+  for (i = 0; i < melon->nstate; i++) {
+    MlnCacheWrite(fp, melon->sorted[i]->ncfg);
+    MlnCacheWrite(fp, melon->sorted[i]->nap);
+  }
+  for (i = 0; i < melon->nconfig; i++) {
+    MlnCompactConfig *cfp = &melon->configs[i];
+    MlnCacheWrite(fp, cfp->rule->index);
+    MlnCacheWrite(fp, cfp->dot);
+    MlnCacheWrite(fp, cfp->is_basis);
+  }
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap; j++) {
+      MlnCacheWrite(fp, state->ap[j].sym);
+      MlnCacheWrite(fp, state->ap[j].type);
+      MlnCacheWrite(fp, state->ap[j].x.state);
+    }
+  }
+
+  if (ferror(fp) | fclose(fp)) {
+    fprintf(MlnErrorStream(stderr), "Can't write file \"%s\".\n", name);
+    remove(name);
+  }
+  free(name);
+}
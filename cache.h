@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#ifndef MELON_CACHE_H_
+#define MELON_CACHE_H_
+
+#include "struct.h"
+
+unsigned long long MlnCacheKey(Melon *melon, int compress);
+int MlnCacheLoad(Melon *melon, int compress);
+void MlnCacheSave(Melon *melon, int compress);
+
+#endif
@@ -5,89 +5,138 @@
 
 #include "configlist.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "assert.h"
 #include "error.h"
-#include "msort.h"
 #include "plink.h"
 #include "set.h"
 #include "struct.h"
 #include "table.h"
 
-static MlnConfig *free_list = NULL;    /* List of free configurations */
-static MlnConfig *current = NULL;      /* Top of list of configurations */
-static MlnConfig **current_end = NULL; /* Last on list of configs */
-static MlnConfig *basis = NULL;        /* Top of list of basis configs */
-static MlnConfig **basis_end = NULL;   /* End of list of basis configs */
+#define MLN_CONFIG_BLOCK_BITS 8
+#define MLN_CONFIG_BLOCK_SIZE (1 << MLN_CONFIG_BLOCK_BITS)
 
-static const int kDefaultConfigSize = 3;
+/* A configuration with its sort key: the rule index, then the dot */
+typedef struct MlnConfigKey {
+  unsigned long long key;
+  MlnConfig *cfp;
+} MlnConfigKey;
+
+/* Lists up to this long are sorted by insertion, longer ones by radix */
+static const int kInsertionSortMax = 16;
+
+/*
+ * Data of MlnConfigListClosure(), precomputed from the grammar by
+ * MlnConfigListClosureInit(). The closure contributed by a
+ * non-terminal is always the rules of the same non-terminals, its
+ * template. The follow set a configuration gives to the rules of the
+ * symbol after its dot is always FIRST of the rest of its rule.
+ */
+typedef struct MlnClosureInfo {
+  int *rest_base;     /* Start of the positions of each rule */
+  int nrest;          /* Number of positions of all rules */
+  char **rest_first;  /* FIRST(rhs[i..]) at every position, or NULL */
+  char *rest_lambda;  /* True if rhs[i..] at every position is nullable */
+  int nterminal;      /* Index of the first non-terminal */
+  int *tpl_first;     /* Start of the template of each non-terminal */
+  MlnSymbol **tpl;    /* Templates: the non-terminals in each closure */
+  int *mark;          /* Stamp of the last closure expanding each symbol */
+  int stamp;          /* Stamp of the current closure */
+  char *empty;        /* The empty follow set of a new configuration */
+} MlnClosureInfo;
 
 /*
- * Return a pointer to a new configuration.
+ * Return the configuration of index "index", or NULL for MLN_NO_INDEX.
  */
-static MlnConfig *NewConfig() {
+MlnConfig *MlnConfigAt(Melon *melon, int index) {
+  if (index == MLN_NO_INDEX) {
+    return NULL;
+  }
+  return &melon->config_pool.blocks[index >> MLN_CONFIG_BLOCK_BITS]
+                                   [index & (MLN_CONFIG_BLOCK_SIZE - 1)];
+}
+
+/*
+ * Return a pointer to a new configuration, whose index is set.
+ */
+static MlnConfig *NewConfig(Melon *melon) {
+  MlnConfigPool *pool = &melon->config_pool;
   MlnConfig *cfg;
-  if (free_list == NULL) {
-    int i;
-    free_list = calloc(kDefaultConfigSize, sizeof(MlnConfig));
-    if (free_list == NULL) {
-      fprintf(stderr, "Unable to allocate memory for a new configuration.");
-      exit(1);
+  if (pool->free_list == MLN_NO_INDEX) {
+    int i, first;
+    MlnConfig *block;
+    if (pool->nblock >= pool->block_alloc) {
+      pool->block_alloc = pool->block_alloc > 0 ? pool->block_alloc * 2 : 64;
+      pool->blocks =
+          realloc(pool->blocks, sizeof(MlnConfig *) * pool->block_alloc);
+      MlnMemoryCheck(pool->blocks);
     }
-
-    for (i = 0; i < kDefaultConfigSize - 1; i++) {
-      free_list[i].next = &free_list[i + 1];
+    block = malloc(sizeof(MlnConfig) * MLN_CONFIG_BLOCK_SIZE);
+    MlnMemoryCheck(block);
+    pool->blocks[pool->nblock] = block;
+    first = pool->nblock << MLN_CONFIG_BLOCK_BITS;
+    for (i = 0; i < MLN_CONFIG_BLOCK_SIZE; i++) {
+      block[i].index = first + i;
+      block[i].fws = NULL;
+      block[i].next =
+          i + 1 < MLN_CONFIG_BLOCK_SIZE ? first + i + 1 : MLN_NO_INDEX;
     }
+    pool->free_list = first;
+    pool->nblock++;
   }
-  cfg = free_list;
-  free_list = free_list->next;
+  cfg = MlnConfigAt(melon, pool->free_list);
+  pool->free_list = cfg->next;
   return cfg;
 }
 
 /*
  * Recycle a configuration to free list.
  */
-static void DeleteConfig(MlnConfig *c) {
-  c->next = free_list;
-  free_list = c;
+static void DeleteConfig(Melon *melon, MlnConfig *c) {
+  c->next = melon->config_pool.free_list;
+  melon->config_pool.free_list = c->index;
 }
 
 /*
  * Initialized the configuration list builder.
  */
-void MlnConfigListInit() {
-  current = NULL;
-  current_end = &current;
-  basis = NULL;
-  basis_end = &basis;
-  MlnConfigTableInit();
+void MlnConfigListInit(Melon *melon) {
+  MlnConfigPool *pool = &melon->config_pool;
+  pool->free_list = MLN_NO_INDEX;
+  pool->current = MLN_NO_INDEX;
+  pool->current_end = &pool->current;
+  pool->basis = MLN_NO_INDEX;
+  pool->basis_end = &pool->basis;
+  MlnConfigTableInit(melon);
 }
 
 /*
  * Add another configuration to the configuration list
  */
-MlnConfig *MlnConfigListAdd(MlnRule *rule, int dot) {
+MlnConfig *MlnConfigListAdd(Melon *melon, MlnRule *rule, int dot) {
+  MlnConfigPool *pool = &melon->config_pool;
   MlnConfig *cfp, model;
 
-  assert(current_end != NULL);
+  assert(pool->current_end != NULL);
   model.rule = rule;
   model.dot = dot;
-  cfp = MlnConfigTableFind(&model);
+  cfp = MlnConfigTableFind(melon, &model);
   if (cfp == NULL) {
-    cfp = NewConfig();
+    cfp = NewConfig(melon);
     cfp->rule = rule;
     cfp->dot = dot;
-    cfp->fws = MlnSetNew();
-    cfp->st = NULL;
-    cfp->fpl = cfp->bpl = NULL;
-    cfp->next = NULL;
-    cfp->bp = NULL;
+    cfp->fws = MlnSetRetain(pool->closure->empty);
+    cfp->fpl = cfp->bpl = MLN_NO_INDEX;
+    cfp->next = MLN_NO_INDEX;
+    cfp->bp = MLN_NO_INDEX;
 
-    *current_end = cfp;
-    current_end = &cfp->next;
-    MlnConfigTableInsert(cfp);
+    *pool->current_end = cfp->index;
+    pool->current_end = &cfp->next;
+    MlnConfigTableInsert(melon, cfp);
   }
 
   return cfp;
@@ -96,102 +145,327 @@ MlnConfig *MlnConfigListAdd(MlnRule *rule, int dot) {
 /*
  * Add a basis configuration to the configuration list.
  */
-MlnConfig *MlnConfigListAddBasis(MlnRule *rule, int dot) {
+MlnConfig *MlnConfigListAddBasis(Melon *melon, MlnRule *rule, int dot) {
+  MlnConfigPool *pool = &melon->config_pool;
   MlnConfig *cfp, model;
 
-  assert(basis_end != NULL);
-  assert(current_end != NULL);
+  assert(pool->basis_end != NULL);
+  assert(pool->current_end != NULL);
   model.rule = rule;
   model.dot = dot;
-  cfp = MlnConfigTableFind(&model);
+  cfp = MlnConfigTableFind(melon, &model);
   if (cfp == NULL) {
-    cfp = NewConfig();
+    cfp = NewConfig(melon);
     cfp->rule = rule;
     cfp->dot = dot;
-    cfp->fws = MlnSetNew();
-    cfp->st = NULL;
-    cfp->fpl = cfp->bpl = NULL;
-    cfp->next = NULL;
-    cfp->bp = NULL;
+    cfp->fws = MlnSetRetain(pool->closure->empty);
+    cfp->fpl = cfp->bpl = MLN_NO_INDEX;
+    cfp->next = MLN_NO_INDEX;
+    cfp->bp = MLN_NO_INDEX;
 
-    *current_end = cfp;
-    current_end = &cfp->next;
+    *pool->current_end = cfp->index;
+    pool->current_end = &cfp->next;
 
-    *basis_end = cfp;
-    basis_end = &cfp->bp;
-    MlnConfigTableInsert(cfp);
+    *pool->basis_end = cfp->index;
+    pool->basis_end = &cfp->bp;
+    MlnConfigTableInsert(melon, cfp);
   }
 
   return cfp;
 }
 
 /*
- * Compute the closure of the configuration list.
+ * Return true if no terminal is in the set.
+ */
+static int MlnClosureSetEmpty(const char *set, int nterminal) {
+  int i;
+  for (i = 0; i < nterminal; i++) {
+    if (set[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Precompute the data of MlnConfigListClosure() for the grammar, whose
+ * first sets and lambdas must be known.
+ */
+void MlnConfigListClosureInit(Melon *melon) {
+  MlnClosureInfo *ci = calloc(1, sizeof(MlnClosureInfo));
+  MlnRule *rp;
+  int i, j, k, n;
+
+  MlnMemoryCheck(ci);
+  melon->config_pool.closure = ci;
+  ci->empty = MlnSetIntern(melon, MlnSetNew(melon));
+
+  ci->rest_base = malloc(sizeof(int) * (melon->nrule + 1));
+  MlnMemoryCheck(ci->rest_base);
+  n = 0;
+  for (rp = melon->rule; rp != NULL; rp = rp->next) {
+    ci->rest_base[rp->index] = n;
+    n += rp->nrhs + 1;
+  }
+  ci->nrest = n;
+  ci->rest_first = calloc(n + 1, sizeof(char *));
+  ci->rest_lambda = malloc(n + 1);
+  MlnMemoryCheck(ci->rest_first);
+  MlnMemoryCheck(ci->rest_lambda);
+  for (rp = melon->rule; rp != NULL; rp = rp->next) {
+    char **first = &ci->rest_first[ci->rest_base[rp->index]];
+    char *lambda = &ci->rest_lambda[ci->rest_base[rp->index]];
+    first[rp->nrhs] = NULL;
+    lambda[rp->nrhs] = MLN_TRUE;
+    for (i = rp->nrhs - 1; i >= 0; i--) {
+      MlnSymbol *sp = rp->rhs[i];
+      char *set = MlnSetNew(melon);
+      if (sp->type == MLN_SYM_TERMINAL) {
+        MlnSetAdd(set, sp->index);
+        lambda[i] = MLN_FALSE;
+      } else {
+        MlnSetUnion(melon, set, sp->first_set);
+        if (sp->lambda && first[i + 1] != NULL) {
+          MlnSetUnion(melon, set, first[i + 1]);
+        }
+        lambda[i] = sp->lambda && lambda[i + 1];
+      }
+      if (MlnClosureSetEmpty(set, melon->nterminal)) {
+        MlnSetFree(set);
+      } else {
+        first[i] = MlnSetIntern(melon, set);
+      }
+    }
+  }
+
+  /* The template of a non-terminal holds itself and, transitively, the
+   * non-terminals at the start of the rules of its members */
+  n = melon->nsymbol - melon->nterminal;
+  ci->nterminal = melon->nterminal;
+  ci->tpl_first = malloc(sizeof(int) * (n + 1));
+  ci->tpl = malloc(sizeof(MlnSymbol *) * (n > 0 ? n : 1));
+  ci->mark = calloc(melon->nsymbol + 1, sizeof(int));
+  MlnMemoryCheck(ci->tpl_first);
+  MlnMemoryCheck(ci->tpl);
+  MlnMemoryCheck(ci->mark);
+  ci->stamp = 0;
+  j = 0;
+  for (i = 0; i < n; i++) {
+    ci->tpl_first[i] = j;
+    ci->stamp++;
+    ci->tpl = realloc(ci->tpl, sizeof(MlnSymbol *) * (j + n));
+    MlnMemoryCheck(ci->tpl);
+    ci->tpl[j++] = melon->symbols[melon->nterminal + i];
+    ci->mark[melon->nterminal + i] = ci->stamp;
+    for (k = ci->tpl_first[i]; k < j; k++) {
+      for (rp = ci->tpl[k]->rule; rp != NULL; rp = rp->next_lhs) {
+        MlnSymbol *sp = rp->nrhs > 0 ? rp->rhs[0] : NULL;
+        if (sp != NULL && sp->type == MLN_SYM_NON_TERMINAL &&
+            ci->mark[sp->index] != ci->stamp) {
+          ci->mark[sp->index] = ci->stamp;
+          ci->tpl[j++] = sp;
+        }
+      }
+    }
+  }
+  ci->tpl_first[n] = j;
+}
+
+/*
+ * Add the interned set "set" to the follow set of "cfp".
+ */
+void MlnConfigFollow(Melon *melon, MlnConfig *cfp, char *set) {
+  char *fws = MlnSetInternUnion(melon, cfp->fws, set);
+  MlnSetRelease(melon, cfp->fws);
+  cfp->fws = fws;
+}
+
+/*
+ * Add the rules of "sp", the symbol before the position "rest" of the
+ * rule of "cfp", to the closure. Their follow sets get FIRST of the
+ * rest of the rule, and the follow set of "cfp" when the rest is
+ * nullable.
+ */
+static void MlnClosureAddRules(Melon *melon, MlnConfig *cfp, MlnSymbol *sp,
+                               int rest) {
+  MlnClosureInfo *ci = melon->config_pool.closure;
+  MlnRule *rp = cfp->rule, *newrp;
+  char *first = ci->rest_first[ci->rest_base[rp->index] + rest];
+  int lambda = ci->rest_lambda[ci->rest_base[rp->index] + rest];
+  MlnConfig *newcfp;
+
+  if (sp->rule == NULL && sp != melon->err_sym) {
+    MlnErrorMsg(melon->filename, rp->line, "Non-terninal \"%s\" has no rules.",
+                sp->name);
+    melon->error_cnt++;
+  }
+  for (newrp = sp->rule; newrp != NULL; newrp = newrp->next_lhs) {
+    newcfp = MlnConfigListAdd(melon, newrp, 0);
+    if (first != NULL) {
+      MlnConfigFollow(melon, newcfp, first);
+    }
+    if (lambda) {
+      MlnPLinkAdd(melon, &cfp->fpl, newcfp->index);
+    }
+  }
+}
+
+/*
+ * Compute the closure of the configuration list. Every configuration
+ * of the kernel with a non-terminal after its dot brings in the rules
+ * of that non-terminal, then the template of the non-terminal, each
+ * member of which is expanded once per closure.
  */
 void MlnConfigListClosure(Melon *melon) {
+  MlnConfigPool *pool = &melon->config_pool;
+  MlnClosureInfo *ci = pool->closure;
   MlnConfig *cfp, *newcfp;
-  MlnRule *rp, *newrp;
-  MlnSymbol *sp, *xsp;
-  int i, dot;
-
-  assert(current_end != NULL);
-  for (cfp = current; cfp != NULL; cfp = cfp->next) {
-    rp = cfp->rule;
-    dot = cfp->dot;
-    if (dot >= rp->nrhs) {
+  MlnRule *rp;
+  MlnSymbol *sp, *tsp;
+  int i, k, nkernel, base;
+
+  assert(pool->current_end != NULL);
+  nkernel = 0;
+  for (cfp = MlnConfigAt(melon, pool->current); cfp != NULL;
+       cfp = MlnConfigAt(melon, cfp->next)) {
+    nkernel++;
+  }
+  ci->stamp++;
+  for (cfp = MlnConfigAt(melon, pool->current), i = 0; i < nkernel;
+       cfp = MlnConfigAt(melon, cfp->next), i++) {
+    if (cfp->dot >= cfp->rule->nrhs) {
+      continue;
+    }
+    sp = cfp->rule->rhs[cfp->dot];
+    if (sp->type != MLN_SYM_NON_TERMINAL) {
       continue;
     }
-    sp = rp->rhs[dot];
-    if (sp->type == MLN_SYM_NON_TERMINAL) {
-      if (sp->rule == NULL && sp != melon->err_sym) {
-        MlnErrorMsg(melon->filename, rp->line,
-                    "Non-terninal \"%s\" has no rules.", sp->name);
-        melon->error_cnt++;
+    MlnClosureAddRules(melon, cfp, sp, cfp->dot + 1);
+    base = sp->index - ci->nterminal;
+    for (k = ci->tpl_first[base]; k < ci->tpl_first[base + 1]; k++) {
+      tsp = ci->tpl[k];
+      if (ci->mark[tsp->index] == ci->stamp) {
+        continue;
       }
-      for (newrp = sp->rule; newrp != NULL; newrp = newrp->next_lhs) {
-        newcfp = MlnConfigListAdd(newrp, 0);
-        for (i = dot + 1; i < rp->nrhs; i++) {
-          xsp = rp->rhs[i];
-          if (xsp->type == MLN_SYM_TERMINAL) {
-            MlnSetAdd(newcfp->fws, xsp->index);
-            break;
-          } else {
-            MlnSetUnion(newcfp->fws, xsp->first_set);
-            if (xsp->lambda == MLN_FALSE) {
-              break;
-            }
-          }
-        }
-        if (i == rp->nrhs) {
-          MlnPLinkAdd(&cfp->fpl, newcfp);
+      ci->mark[tsp->index] = ci->stamp;
+      for (rp = tsp->rule; rp != NULL; rp = rp->next_lhs) {
+        newcfp = MlnConfigListAdd(melon, rp, 0);
+        if (rp->nrhs > 0 && rp->rhs[0]->type == MLN_SYM_NON_TERMINAL) {
+          MlnClosureAddRules(melon, newcfp, rp->rhs[0], 1);
         }
       }
     }
   }
 }
 
-static int config_cmp(void *a, void *b) { return MlnConfigCmp(a, b); }
+/* The link of "cfp" at offset "link", either next or bp */
+#define MlnConfigLink(cfp, link) (*(int *)((char *)(cfp) + (link)))
+
+/*
+ * Sort the list of configurations chained through the link at offset
+ * "link" in the order of MlnConfigCmp(), and return the index of the
+ * new head.
+ *
+ * The keys are packed into integers. Short lists, like most bases,
+ * are sorted by insertion, which is linear on the lists that are
+ * already sorted. Longer ones are sorted by a radix sort on the bytes
+ * of the key, skipping the bytes that are zero in every key.
+ */
+static int MlnConfigSort(Melon *melon, int list, size_t link) {
+  MlnConfigPool *pool = &melon->config_pool;
+  MlnConfigKey *keys, *tmp, *swap;
+  MlnConfig *cfp;
+  unsigned long long mask = 0;
+  int i, j, n, shift;
+
+  n = 0;
+  for (cfp = MlnConfigAt(melon, list); cfp != NULL;
+       cfp = MlnConfigAt(melon, MlnConfigLink(cfp, link))) {
+    n++;
+  }
+  if (n < 2) {
+    return list;
+  }
+  if (n > pool->sort_alloc) {
+    pool->sort_alloc = n * 2;
+    pool->sort_keys =
+        realloc(pool->sort_keys, sizeof(MlnConfigKey) * pool->sort_alloc);
+    pool->sort_tmp =
+        realloc(pool->sort_tmp, sizeof(MlnConfigKey) * pool->sort_alloc);
+    MlnMemoryCheck(pool->sort_keys);
+    MlnMemoryCheck(pool->sort_tmp);
+  }
+  keys = pool->sort_keys;
+  tmp = pool->sort_tmp;
+  for (i = 0, cfp = MlnConfigAt(melon, list); cfp != NULL;
+       i++, cfp = MlnConfigAt(melon, MlnConfigLink(cfp, link))) {
+    keys[i].key =
+        (unsigned long long)cfp->rule->index << 32 | (unsigned)cfp->dot;
+    keys[i].cfp = cfp;
+    mask |= keys[i].key;
+  }
+
+  if (n <= kInsertionSortMax) {
+    for (i = 1; i < n; i++) {
+      MlnConfigKey x = keys[i];
+      for (j = i; j > 0 && keys[j - 1].key > x.key; j--) {
+        keys[j] = keys[j - 1];
+      }
+      keys[j] = x;
+    }
+  } else {
+    for (shift = 0; shift < 64; shift += 8) {
+      int count[257];
+      if (((mask >> shift) & 0xFF) == 0) {
+        continue;
+      }
+      memset(count, 0, sizeof(count));
+      for (i = 0; i < n; i++) {
+        count[((keys[i].key >> shift) & 0xFF) + 1]++;
+      }
+      for (i = 0; i < 256; i++) {
+        count[i + 1] += count[i];
+      }
+      for (i = 0; i < n; i++) {
+        tmp[count[(keys[i].key >> shift) & 0xFF]++] = keys[i];
+      }
+      swap = keys;
+      keys = tmp;
+      tmp = swap;
+    }
+  }
+
+  for (i = 0; i < n - 1; i++) {
+    MlnConfigLink(keys[i].cfp, link) = keys[i + 1].cfp->index;
+  }
+  MlnConfigLink(keys[n - 1].cfp, link) = MLN_NO_INDEX;
+  return keys[0].cfp->index;
+}
 
 /*
  * Sort the configuration list.
  */
-void MlnConfigListSort() {
-  current = MlnMSort(current, &current->next, &config_cmp);
-  current_end = NULL;
+void MlnConfigListSort(Melon *melon) {
+  MlnConfigPool *pool = &melon->config_pool;
+  pool->current =
+      MlnConfigSort(melon, pool->current, offsetof(MlnConfig, next));
+  pool->current_end = NULL;
 }
 
 /*
- * Sort the basis configuration list.
+ * Sort a basis configuration list, as returned by MlnConfigListBasis(),
+ * and return its new head.
  */
-void MlnConfigListSortBasis() {
-  basis = MlnMSort(current, &current->bp, &config_cmp);
-  basis_end = NULL;
+MlnConfig *MlnConfigListSortBasis(Melon *melon, MlnConfig *bp) {
+  return MlnConfigAt(melon,
+                     MlnConfigSort(melon, bp->index, offsetof(MlnConfig, bp)));
 }
 
-MlnConfig *MlnConfigListReturn() {
-  MlnConfig *old = current;
-  current = NULL;
-  current_end = NULL;
+MlnConfig *MlnConfigListReturn(Melon *melon) {
+  MlnConfigPool *pool = &melon->config_pool;
+  MlnConfig *old = MlnConfigAt(melon, pool->current);
+  pool->current = MLN_NO_INDEX;
+  pool->current_end = NULL;
   return old;
 }
 
@@ -199,36 +473,85 @@ MlnConfig *MlnConfigListReturn() {
  * Return a pointer to the head of the configuration list and
  * reset the list.
  */
-MlnConfig *MlnConfigListBasis() {
-  MlnConfig *old = basis;
-  basis = NULL;
-  basis_end = NULL;
+MlnConfig *MlnConfigListBasis(Melon *melon) {
+  MlnConfigPool *pool = &melon->config_pool;
+  MlnConfig *old = MlnConfigAt(melon, pool->basis);
+  pool->basis = MLN_NO_INDEX;
+  pool->basis_end = NULL;
   return old;
 }
 
 /*
  * Free all elements of the given configuration list.
  */
-void MlnConfigListEat(MlnConfig *config) {
+void MlnConfigListEat(Melon *melon, MlnConfig *config) {
   MlnConfig *next;
   for (; config; config = next) {
-    next = config->next;
-    assert(config->fpl == NULL);
-    assert(config->bpl == NULL);
+    next = MlnConfigAt(melon, config->next);
+    assert(config->fpl == MLN_NO_INDEX);
+    assert(config->bpl == MLN_NO_INDEX);
     if (config->fws) {
-      MlnSetFree(config->fws);
+      MlnSetRelease(melon, config->fws);
+      config->fws = NULL;
     }
-    DeleteConfig(config);
+    DeleteConfig(melon, config);
   }
 }
 
 /*
  * Initialized the configuration list builder.
  */
-void MlnConfigListReset() {
-  current = NULL;
-  current_end = &current;
-  basis = NULL;
-  basis_end = &basis;
-  MlnConfigTableClear(NULL);
+void MlnConfigListReset(Melon *melon) {
+  MlnConfigPool *pool = &melon->config_pool;
+  pool->current = MLN_NO_INDEX;
+  pool->current_end = &pool->current;
+  pool->basis = MLN_NO_INDEX;
+  pool->basis_end = &pool->basis;
+  MlnConfigTableClear(melon, NULL);
+}
+
+/*
+ * Release the storage of every configuration ever allocated. The
+ * follow sets moved to the compact configurations stay with them; the
+ * others are left only by an aborted build, and released.
+ */
+void MlnConfigListFree(Melon *melon) {
+  MlnConfigPool *pool = &melon->config_pool;
+  MlnClosureInfo *ci = pool->closure;
+  int i, j;
+  for (i = 0; i < pool->nblock; i++) {
+    for (j = 0; j < MLN_CONFIG_BLOCK_SIZE; j++) {
+      if (pool->blocks[i][j].fws != NULL) {
+        MlnSetRelease(melon, pool->blocks[i][j].fws);
+      }
+    }
+    free(pool->blocks[i]);
+  }
+  free(pool->blocks);
+  pool->blocks = NULL;
+  pool->nblock = pool->block_alloc = 0;
+  pool->free_list = MLN_NO_INDEX;
+  free(pool->sort_keys);
+  free(pool->sort_tmp);
+  pool->sort_keys = pool->sort_tmp = NULL;
+  pool->sort_alloc = 0;
+  if (ci != NULL) {
+    for (i = 0; ci->rest_first != NULL && i < ci->nrest; i++) {
+      if (ci->rest_first[i] != NULL) {
+        MlnSetRelease(melon, ci->rest_first[i]);
+      }
+    }
+    if (ci->empty != NULL) {
+      MlnSetRelease(melon, ci->empty);
+    }
+    free(ci->rest_base);
+    free(ci->rest_first);
+    free(ci->rest_lambda);
+    free(ci->tpl_first);
+    free(ci->tpl);
+    free(ci->mark);
+    free(ci);
+    pool->closure = NULL;
+  }
+  MlnConfigListReset(melon);
 }
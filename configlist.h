@@ -8,15 +8,19 @@
 
 #include "struct.h"
 
-void MlnConfigListInit();
-MlnConfig *MlnConfigListAdd(MlnRule *rule, int dot);
-MlnConfig *MlnConfigListAddBasis(MlnRule *rule, int dot);
+void MlnConfigListInit(Melon *melon);
+MlnConfig *MlnConfigAt(Melon *melon, int index);
+MlnConfig *MlnConfigListAdd(Melon *melon, MlnRule *rule, int dot);
+MlnConfig *MlnConfigListAddBasis(Melon *melon, MlnRule *rule, int dot);
+void MlnConfigFollow(Melon *melon, MlnConfig *cfp, char *set);
+void MlnConfigListClosureInit(Melon *melon);
 void MlnConfigListClosure(Melon *melon);
-void MlnConfigListSort();
-void MlnConfigListSortBasis();
-MlnConfig *MlnConfigListReturn();
-MlnConfig *MlnConfigListBasis();
-void MlnConfigListEat(MlnConfig *config);
-void MlnConfigListReset();
+void MlnConfigListSort(Melon *melon);
+MlnConfig *MlnConfigListSortBasis(Melon *melon, MlnConfig *bp);
+MlnConfig *MlnConfigListReturn(Melon *melon);
+MlnConfig *MlnConfigListBasis(Melon *melon);
+void MlnConfigListEat(Melon *melon, MlnConfig *config);
+void MlnConfigListReset(Melon *melon);
+void MlnConfigListFree(Melon *melon);
 
 #endif
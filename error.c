@@ -7,10 +7,53 @@
 
 #include "error.h"
 
+#include <setjmp.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "struct.h"
+
+/* Where diagnostics go, NULL for the default stream of each message */
+static MLN_THREAD_LOCAL FILE *error_stream = NULL;
+/* Where a fatal error jumps, NULL to exit the program */
+static MLN_THREAD_LOCAL jmp_buf *abort_target = NULL;
+
+/*
+ * Send the diagnostics of the calling thread to "stream". NULL restores
+ * the default streams.
+ */
+void MlnErrorSetStream(FILE *stream) { error_stream = stream; }
+
+/*
+ * Make a fatal error of the calling thread jump to "target", and
+ * return the previous target. NULL makes it exit the program.
+ */
+jmp_buf *MlnErrorSetAbort(jmp_buf *target) {
+  jmp_buf *prev = abort_target;
+  abort_target = target;
+  return prev;
+}
+
+/*
+ * Give up after a fatal error, such as running out of memory. The
+ * message has already been printed.
+ */
+void MlnErrorAbort() {
+  if (abort_target != NULL) {
+    longjmp(*abort_target, 1);
+  }
+  exit(1);
+}
+
+/*
+ * Return the stream for a diagnostic which normally goes to "dflt".
+ */
+FILE *MlnErrorStream(FILE *dflt) {
+  return error_stream != NULL ? error_stream : dflt;
+}
+
 /*
  * Find a good place to break "msg" so that its length is at least "min"
  * but no more than "max". Make the point as close to mas as possible.
@@ -57,7 +100,7 @@ const int kPrefixLimit = 30;
  */
 void MlnErrorMsg(const char *filename, int line, const char *fmt, ...) {
   char err_msg[kErrMsgSize];
-  char prefix[kPrefixLimit + 10];
+  char prefix[kPrefixLimit + 24];
   int prefix_size;
   int available_width;
   int err_msg_size;
@@ -67,15 +110,16 @@ void MlnErrorMsg(const char *filename, int line, const char *fmt, ...) {
   va_start(ap, fmt);
   /* Prepare a prefix to be prepended to every output line. */
   if (line > 0) {
-    sprintf(prefix, "%.*s:%d: ", kPrefixLimit, filename, line);
+    snprintf(prefix, sizeof(prefix), "%.*s:%d: ", kPrefixLimit, filename,
+             line);
   } else {
-    sprintf(prefix, "%.*s: ", kPrefixLimit, filename);
+    snprintf(prefix, sizeof(prefix), "%.*s: ", kPrefixLimit, filename);
   }
   prefix_size = strlen(prefix);
   available_width = kLineWidth - prefix_size;
 
   /* Generate the error message. */
-  vsprintf(err_msg, fmt, ap);
+  vsnprintf(err_msg, kErrMsgSize, fmt, ap);
   va_end(ap);
   err_msg_size = strlen(err_msg);
   /* Remove trailing '\n's from the error message. */
@@ -91,7 +135,7 @@ void MlnErrorMsg(const char *filename, int line, const char *fmt, ...) {
     while (err_msg[restart] == ' ') {
       restart++;
     }
-    fprintf(stdout, "%s%.*s\n", prefix, end, &err_msg[base]);
+    fprintf(MlnErrorStream(stdout), "%s%.*s\n", prefix, end, &err_msg[base]);
     base = restart;
   }
 }
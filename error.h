@@ -6,6 +6,13 @@
 #ifndef MELON_ERROR_H_
 #define MELON_ERROR_H_
 
+#include <setjmp.h>
+#include <stdio.h>
+
+void MlnErrorSetStream(FILE *stream);
+FILE *MlnErrorStream(FILE *dflt);
+jmp_buf *MlnErrorSetAbort(jmp_buf *target);
+void MlnErrorAbort();
 void MlnErrorMsg(const char *filename, int line, const char *fmt, ...);
 
 #endif
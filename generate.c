@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ *
+ * The steps of one run of the generator, shared by the command line
+ * tool and the library: load a grammar, generate its parser, and
+ * release everything again.
+ */
+
+#include "generate.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "build.h"
+#include "cache.h"
+#include "configlist.h"
+#include "error.h"
+#include "parse.h"
+#include "plink.h"
+#include "renumber.h"
+#include "report.h"
+#include "set.h"
+#include "table.h"
+
+/*
+ * Parse a grammar into "melon", then count and index its symbols and
+ * find the rule precedences. The grammar is the text of the given
+ * length, or the file "filename" if "text" is NULL. Return the number
+ * of errors.
+ */
+int MlnLoadGrammar(Melon *melon, const MlnGenOptions *opts, char *argv0,
+                   char *filename, const char *text, size_t len) {
+  int i;
+
+  /* Initialize the machine. All of its tables are in "melon". */
+  memset(melon, 0, sizeof(*melon));
+  MlnStrSafeInit(melon);
+  MlnSymbolInit(melon);
+  MlnStateInit(melon);
+
+  melon->argv0 = argv0;
+  melon->defines = opts->defines;
+  melon->ndefine = opts->ndefine;
+  melon->filename = filename;
+  melon->basis_flag = opts->basis_flag;
+  melon->interleave = opts->interleave;
+  melon->pad_tables = opts->pad_tables;
+  melon->pack_tables = opts->pack_tables;
+  melon->cplusplus = opts->cplusplus;
+  melon->prune = opts->prune;
+  melon->renumber = opts->renumber;
+  melon->split = opts->split;
+
+  MlnSymbolNew(melon, "$");
+  melon->err_sym = MlnSymbolNew(melon, "error");
+
+  /* Parse the input file */
+  if (text != NULL) {
+    MlnParseBuffer(melon, text, len);
+  } else {
+    MlnParse(melon);
+  }
+
+  if (melon->error_cnt > 0) {
+    return melon->error_cnt;
+  }
+  if (melon->rule == 0) {
+    fprintf(MlnErrorStream(stderr), "Empty grammar.\n");
+    return ++melon->error_cnt;
+  }
+
+  /* Count and index the symbols of the grammar */
+  melon->nsymbol = MlnSymbolCount(melon);
+  MlnSymbolNew(melon, "{default}");
+  melon->symbols = MlnSymbolArrayOf(melon);
+  for (i = 0; i <= melon->nsymbol; i++) {
+    melon->symbols[i]->index = i;
+  }
+  qsort(melon->symbols, melon->nsymbol + 1, sizeof(MlnSymbol *),
+        (int (*)(const void *, const void *))MlnSymbolCmp);
+  for (i = 0; i <= melon->nsymbol; i++) {
+    melon->symbols[i]->index = i;
+  }
+  for (i = 1; isupper(melon->symbols[i]->name[0]); i++) {
+  }
+  melon->nterminal = i;
+
+  /* Drop the useless symbols and rules, before anything is built */
+  if (melon->prune) {
+    MlnPruneGrammar(melon);
+  }
+
+  /* Find the precedence for every production rule (that has one). A
+   * reprint shows only the precedences written in the grammar. */
+  if (!opts->rpflag) {
+    MlnFindRulePrecedences(melon);
+  }
+  return 0;
+}
+
+/*
+ * Release the states, configurations and actions of "melon". The
+ * automaton may be partly built, if its construction was aborted.
+ */
+void MlnFreeAutomaton(Melon *melon) {
+  int i;
+  if (melon->sorted != NULL) {
+    for (i = 0; i < melon->nstate; i++) {
+      free(melon->sorted[i]->ap);
+      free(melon->sorted[i]);
+    }
+    free(melon->sorted);
+  } else if (melon->nstate > 0) {
+    /* The states are still only in the state table */
+    MlnStateFreeAll(melon);
+  }
+  for (i = 0; melon->configs != NULL && i < melon->nconfig; i++) {
+    if (melon->configs[i].fws != NULL) {
+      MlnSetRelease(melon, melon->configs[i].fws);
+    }
+  }
+  free(melon->configs);
+  free(melon->link_first);
+  free(melon->links);
+  free(melon->shift_mark);
+  free(melon->shift_pos);
+  melon->sorted = NULL;
+  melon->nstate = 0;
+  melon->configs = NULL;
+  melon->nconfig = 0;
+  melon->link_first = melon->links = NULL;
+  melon->shift_mark = melon->shift_pos = NULL;
+}
+
+/*
+ * Release the grammar of "melon", and reset all global tables and
+ * free lists, so that another grammar can be loaded.
+ */
+void MlnFreeGrammar(Melon *melon) {
+  MlnRule *rp, *next;
+  MlnRegex *re, *next_re;
+  for (rp = melon->rule; rp != NULL; rp = next) {
+    next = rp->next;
+    free(rp);
+  }
+  melon->rule = NULL;
+  for (re = melon->regex; re != NULL; re = next_re) {
+    next_re = re->next;
+    free(re);
+  }
+  melon->regex = NULL;
+  melon->nrule = 0;
+  free(melon->symbols);
+  melon->symbols = NULL;
+  free(melon->output_file);
+  melon->output_file = NULL;
+
+  MlnConfigListFree(melon);
+  MlnPLinkFreeAll(melon);
+  MlnSetInternReset(melon);
+  MlnConfigTableReset(melon);
+  MlnStateReset(melon);
+  MlnSymbolReset(melon);
+  MlnStrSafeReset(melon);
+}
+
+/*
+ * Compute the LALR(1) automaton and the action tables of the grammar.
+ */
+static void MlnBuildAutomaton(Melon *melon, int compress) {
+  /* Compute the lambda-non-terminals and the first-sets for every
+   * non-terminal */
+  MlnFindFirstSets(melon);
+
+  /* Compute all LR(0) states. Also record follow-set propagation
+   * links so that the follow-set can be computed later */
+  melon->nstate = 0;
+  MlnFindStates(melon);
+  melon->sorted = MlnStateArrayOf(melon);
+
+  /* Switch to the compact configuration storage, and gather the
+   * propagation links into one array */
+  MlnFindLinks(melon);
+
+  /* Compute the follow set of every reducible configuration */
+  MlnFindFollowSets(melon);
+
+  /* Compute the action tables */
+  MlnFindActions(melon);
+
+  /* Compress the action tables */
+  if (compress == 0) {
+    MlnCompressTables(melon);
+  }
+}
+
+/*
+ * Generate the parser for the loaded grammar. The automaton is built,
+ * unless "melon" already holds one.
+ */
+void MlnGenerateParser(Melon *melon, const MlnGenOptions *opts) {
+  /* Generate a reprint of the grammar, if requested on the command line */
+  if (opts->rpflag) {
+    MlnReprint(melon);
+    return;
+  }
+
+  /* Initialize the size for all follow and first sets */
+  MlnSetSize(melon, melon->nterminal);
+
+  /* Reuse the automaton of the cache file, if the structure of the
+   * grammar is unchanged. Otherwise compute it, and save it. The
+   * cache keeps the numbers of the grammar, so renumber afterwards.
+   * Nor does it keep an automaton without the rules never reduced. */
+  if (melon->sorted == NULL) {
+    if (opts->use_cache == 0 || MlnCacheLoad(melon, opts->compress) == 0) {
+      MlnBuildAutomaton(melon, opts->compress);
+      if (opts->use_cache && melon->error_cnt == 0 &&
+          melon->nunreduced == 0) {
+        MlnCacheSave(melon, opts->compress);
+      }
+    }
+    if (melon->renumber) {
+      MlnRenumberSymbols(melon);
+    }
+  }
+
+  /* Generate a report of the parser generated. (the "y.output" file) */
+  if (opts->quiet == 0) {
+    MlnReportOutput(melon);
+  }
+
+  /* Generate the source code for the parser */
+  MlnReportTable(melon, opts->mhflag);
+
+  /* Produce a header file for use by the scanner. (This step is
+   * ommited if the "-m" option is used because makeheaders will
+   * generate the file for us, and for a C++ parser, whose header has
+   * the tokens.) */
+  if (!opts->mhflag && !opts->cplusplus) {
+    MlnReportHeader(melon);
+  }
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#ifndef MELON_GENERATE_H_
+#define MELON_GENERATE_H_
+
+#include "struct.h"
+
+typedef struct MlnGenOptions {
+  int rpflag;     /* Print the grammar without actions */
+  int basis_flag; /* Print only the basis in report */
+  int compress;   /* Don't compress the action table */
+  int interleave; /* Interleave the lookahead and action tables */
+  int pad_tables; /* Pad the action table for unchecked lookups */
+  int pack_tables; /* Output the tables as string literals */
+  int cplusplus;  /* Output a header-only C++ parser class */
+  int prune;      /* Remove useless symbols, rules and states */
+  int renumber;   /* Renumber the symbols to shrink the action table */
+  int split;      /* Rules per file of actions, 0 for a single file */
+  int use_cache;  /* Cache the automaton in a .mlc file */
+  int quiet;      /* Don't print the report file */
+  int mhflag;     /* Output a makeheaders compatible file */
+  char **defines; /* Macros for %ifdef, as given to -D */
+  int ndefine;    /* Number of defines */
+} MlnGenOptions;
+
+int MlnLoadGrammar(Melon *melon, const MlnGenOptions *opts, char *argv0,
+                   char *filename, const char *text, size_t len);
+void MlnGenerateParser(Melon *melon, const MlnGenOptions *opts);
+void MlnFreeAutomaton(Melon *melon);
+void MlnFreeGrammar(Melon *melon);
+
+#endif
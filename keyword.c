@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ *
+ * Perfect hashing of the tokens named by %keyword, so that the parser
+ * recognizes a keyword with one hash and one memcmp(). The keywords
+ * are spread over buckets by the high bits of their hash. The buckets
+ * are placed largest first, each at the smallest displacement that
+ * moves all of its keywords to free slots. If a bucket fits nowhere,
+ * another seed is tried, and after a few seeds the number of slots is
+ * doubled.
+ */
+
+#include "keyword.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+
+static const unsigned kKeywordSeed = 0x811C9DC5; /* FNV-1a offset basis */
+static const int kSeedsPerSize = 32; /* Seeds tried before growing */
+
+/* A keyword with the bucket it falls into */
+typedef struct {
+  int kw;     /* Index of the keyword */
+  int bucket; /* Its bucket */
+  int size;   /* Number of keywords in the bucket */
+} MlnKeywordBucket;
+
+/*
+ * The FNV-1a hash of the "n" bytes at "z", starting from "seed". The
+ * low bits of FNV-1a only depend on the low bits of the bytes, so the
+ * high bits are mixed into them at the end. The parser computes the
+ * same.
+ */
+unsigned MlnKeywordHash(unsigned seed, const char *z, int n) {
+  unsigned h = seed;
+  int i;
+  for (i = 0; i < n; i++) {
+    h = (h ^ (unsigned char)z[i]) * 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  return h;
+}
+
+static int MlnKeywordSpellingCmp(const void *a, const void *b) {
+  MlnSymbol *const *p1 = a, *const *p2 = b;
+  int c = strcmp((*p1)->keyword, (*p2)->keyword);
+  if (c != 0) {
+    return c;
+  }
+  return (*p1)->keyword_line - (*p2)->keyword_line;
+}
+
+static int MlnKeywordLengthCmp(const void *a, const void *b) {
+  MlnSymbol *const *p1 = a, *const *p2 = b;
+  size_t n1 = strlen((*p1)->keyword), n2 = strlen((*p2)->keyword);
+  if (n1 != n2) {
+    return n1 > n2 ? -1 : 1;
+  }
+  return strcmp((*p1)->keyword, (*p2)->keyword);
+}
+
+static int MlnKeywordBucketCmp(const void *a, const void *b) {
+  const MlnKeywordBucket *p1 = a, *p2 = b;
+  if (p1->size != p2->size) {
+    return p1->size > p2->size ? -1 : 1;
+  }
+  if (p1->bucket != p2->bucket) {
+    return p1->bucket < p2->bucket ? -1 : 1;
+  }
+  return p1->kw - p2->kw;
+}
+
+/*
+ * Store the spellings of the keywords kw[0..n-1], longest first, in
+ * the pool. A spelling found within the pool is not stored again.
+ * Set the offset of every spelling.
+ */
+static void MlnKeywordPool(MlnKeywordTable *kt, MlnSymbol **kw, int n,
+                           int *offset) {
+  int i, len;
+  size_t total = 0;
+
+  for (i = 0; i < n; i++) {
+    total += strlen(kw[i]->keyword);
+  }
+  kt->pool = malloc(total + 1);
+  MlnMemoryCheck(kt->pool);
+  kt->pool[0] = '\0';
+  kt->pool_len = 0;
+  for (i = 0; i < n; i++) {
+    char *found = strstr(kt->pool, kw[i]->keyword);
+    if (found != NULL) {
+      offset[i] = (int)(found - kt->pool);
+      continue;
+    }
+    len = (int)strlen(kw[i]->keyword);
+    memcpy(kt->pool + kt->pool_len, kw[i]->keyword, len + 1);
+    offset[i] = kt->pool_len;
+    kt->pool_len += len;
+  }
+}
+
+/*
+ * Try to place the keywords kw[0..n-1] with the current seed and
+ * number of slots. Return non-zero and set disp[] and who[], the
+ * keyword of every slot or -1, if no two keywords share a slot.
+ */
+static int MlnKeywordPlace(MlnKeywordTable *kt, MlnSymbol **kw, int n,
+                           MlnKeywordBucket *order, unsigned *hash,
+                           int *who) {
+  int i, j, k, d, s;
+  int mask = kt->nslot - 1;
+
+  for (i = 0; i < n; i++) {
+    hash[i] = MlnKeywordHash(kt->seed, kw[i]->keyword,
+                             (int)strlen(kw[i]->keyword));
+    order[i].kw = i;
+    order[i].bucket = (int)((hash[i] >> 16) % (unsigned)kt->nbucket);
+  }
+  memset(kt->disp, 0, sizeof(kt->disp[0]) * kt->nbucket);
+  for (i = 0; i < n; i++) {
+    kt->disp[order[i].bucket]++;
+  }
+  for (i = 0; i < n; i++) {
+    order[i].size = kt->disp[order[i].bucket];
+  }
+  qsort(order, n, sizeof(order[0]), MlnKeywordBucketCmp);
+  memset(kt->disp, 0, sizeof(kt->disp[0]) * kt->nbucket);
+  for (s = 0; s < kt->nslot; s++) {
+    who[s] = -1;
+  }
+
+  for (i = 0; i < n; i = j) {
+    for (j = i; j < n && order[j].bucket == order[i].bucket; j++) {
+    }
+    for (d = 0; d < kt->nslot; d++) {
+      for (k = i; k < j; k++) {
+        s = (int)((hash[order[k].kw] ^ (unsigned)d) & (unsigned)mask);
+        if (who[s] >= 0) {
+          break;
+        }
+        who[s] = order[k].kw;
+      }
+      if (k == j) {
+        break;
+      }
+      while (--k >= i) {
+        who[(hash[order[k].kw] ^ (unsigned)d) & (unsigned)mask] = -1;
+      }
+    }
+    if (d == kt->nslot) {
+      return 0;
+    }
+    kt->disp[order[i].bucket] = d;
+  }
+  return 1;
+}
+
+/*
+ * Build the table of the keywords of the grammar. Return the number
+ * of keywords, or 0 if there are none or two share a spelling, in
+ * which case nothing is allocated.
+ */
+int MlnKeywordTableInit(MlnKeywordTable *kt, Melon *melon) {
+  MlnSymbol **kw;
+  MlnKeywordBucket *order;
+  unsigned *hash;
+  int *offset, *who;
+  int i, n, attempt;
+
+  memset(kt, 0, sizeof(*kt));
+  kw = malloc(sizeof(kw[0]) * (melon->nterminal + 1));
+  MlnMemoryCheck(kw);
+  n = 0;
+  for (i = 1; i < melon->nterminal; i++) {
+    if (melon->symbols[i]->keyword != NULL) {
+      kw[n++] = melon->symbols[i];
+    }
+  }
+  qsort(kw, n, sizeof(kw[0]), MlnKeywordSpellingCmp);
+  for (i = 1; i < n; i++) {
+    if (strcmp(kw[i - 1]->keyword, kw[i]->keyword) == 0) {
+      MlnErrorMsg(melon->filename, kw[i]->keyword_line,
+                  "Tokens %s and %s have the same %%keyword spelling "
+                  "\"%s\".",
+                  kw[i - 1]->name, kw[i]->name, kw[i]->keyword);
+      melon->error_cnt++;
+      n = 0;
+    }
+  }
+  if (n == 0) {
+    free(kw);
+    return 0;
+  }
+
+  qsort(kw, n, sizeof(kw[0]), MlnKeywordLengthCmp);
+  offset = malloc(sizeof(int) * n);
+  order = malloc(sizeof(order[0]) * n);
+  hash = malloc(sizeof(unsigned) * n);
+  MlnMemoryCheck(offset);
+  MlnMemoryCheck(order);
+  MlnMemoryCheck(hash);
+  MlnKeywordPool(kt, kw, n, offset);
+
+  kt->nkeyword = n;
+  kt->nbucket = (n + 1) / 2;
+  kt->disp = malloc(sizeof(int) * kt->nbucket);
+  MlnMemoryCheck(kt->disp);
+  for (kt->nslot = 1; kt->nslot < n; kt->nslot *= 2) {
+  }
+  who = malloc(sizeof(int) * kt->nslot);
+  MlnMemoryCheck(who);
+  for (attempt = 0;; attempt++) {
+    if (attempt > 0 && attempt % kSeedsPerSize == 0) {
+      kt->nslot *= 2;
+      who = realloc(who, sizeof(int) * kt->nslot);
+      MlnMemoryCheck(who);
+    }
+    kt->seed = kKeywordSeed ^ ((unsigned)attempt * 0x9E3779B9u);
+    if (MlnKeywordPlace(kt, kw, n, order, hash, who)) {
+      break;
+    }
+  }
+
+  kt->slot = malloc(sizeof(kt->slot[0]) * kt->nslot);
+  kt->offset = malloc(sizeof(int) * kt->nslot);
+  MlnMemoryCheck(kt->slot);
+  MlnMemoryCheck(kt->offset);
+  for (i = 0; i < kt->nslot; i++) {
+    kt->slot[i] = who[i] >= 0 ? kw[who[i]] : NULL;
+    kt->offset[i] = who[i] >= 0 ? offset[who[i]] : 0;
+  }
+  free(who);
+  free(hash);
+  free(order);
+  free(offset);
+  free(kw);
+  return n;
+}
+
+void MlnKeywordTableFree(MlnKeywordTable *kt) {
+  free(kt->slot);
+  free(kt->offset);
+  free(kt->disp);
+  free(kt->pool);
+  memset(kt, 0, sizeof(*kt));
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#ifndef MELON_KEYWORD_H_
+#define MELON_KEYWORD_H_
+
+#include "struct.h"
+
+/*
+ * The perfect hash table of the tokens named by %keyword. A spelling
+ * of "n" bytes at "z" is in the slot
+ *
+ *    (h ^ disp[(h >> 16) % nbucket]) & (nslot - 1)
+ *
+ * where h is MlnKeywordHash(seed, z, n).
+ */
+typedef struct MlnKeywordTable {
+  int nkeyword;     /* Number of keywords */
+  unsigned seed;    /* Initial value of the hash */
+  int nslot;        /* Number of slots, a power of two */
+  MlnSymbol **slot; /* The keyword of every slot, NULL if empty */
+  int *offset;      /* Offset of the spelling of every slot in pool */
+  int nbucket;      /* Number of buckets */
+  int *disp;        /* Displacement of every bucket */
+  char *pool;       /* All spellings, those within another sharing it */
+  int pool_len;     /* Length of pool, without its terminator */
+} MlnKeywordTable;
+
+unsigned MlnKeywordHash(unsigned seed, const char *z, int n);
+int MlnKeywordTableInit(MlnKeywordTable *kt, Melon *melon);
+void MlnKeywordTableFree(MlnKeywordTable *kt);
+
+#endif
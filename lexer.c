@@ -0,0 +1,782 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ *
+ * The scanner of the patterns given by %token_regex and %skip_regex.
+ * Every pattern is compiled into a part of one NFA, by Thompson's
+ * construction. The bytes are grouped into classes that no pattern
+ * tells apart, the NFA is turned into a DFA over the classes by the
+ * subset construction, and the DFA is minimized by refining the
+ * partition of its states by their token until it is stable.
+ *
+ * A pattern is made of
+ *
+ *    x          the byte x
+ *    \x         x, for any other byte x than below
+ *    \n \t \r \f \v
+ *    \xHH       the byte of hexadecimal value HH
+ *    \d \s \w   a digit, a white space, a word byte
+ *    .          any byte but a newline
+ *    [...]      any byte listed, with ranges like a-z; [^...] for any
+ *               other byte
+ *    (r)        r
+ *    rs  r|s    r followed by s, r or s
+ *    r*  r+  r? zero or more, one or more, zero or one r
+ *
+ * The scanner takes the longest match, and the first pattern of the
+ * grammar among those matching as long.
+ */
+
+#include "lexer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+
+/* A state of the NFA */
+typedef struct {
+  int set;    /* Byte set of the edge, -1 if there is no edge */
+  int out;    /* Target of the edge */
+  int eps[2]; /* Targets of the empty edges, -1 if none */
+  int accept; /* 1 + index of the pattern matched here, 0 if none */
+} MlnNfaState;
+
+typedef struct {
+  MlnNfaState *states;
+  int nstate;
+  int nstate_alloc;
+  unsigned char (*sets)[32]; /* Byte sets of the edges */
+  int nset;
+  int nset_alloc;
+} MlnNfa;
+
+/* A part of the NFA, entered at start and left at end, which has no
+ * edge yet */
+typedef struct {
+  int start;
+  int end;
+} MlnFrag;
+
+/* The parser of one pattern */
+typedef struct {
+  MlnNfa *nfa;
+  const char *p;     /* Next byte of the pattern */
+  const char *error; /* Why the pattern is bad, NULL if it is not */
+} MlnRegexParser;
+
+/* The states of the DFA, as sets of NFA states */
+typedef struct {
+  int nword;         /* Words per set */
+  unsigned *sets;    /* The set of every state */
+  int nstate;        /* Number of states */
+  int nstate_alloc;  /* Number of states allocated */
+  int *next;         /* Transitions, nclass per state */
+  int *ht;           /* Hash table of the sets, 1 + state or 0 */
+  int ht_size;       /* Size of ht, a power of two */
+} MlnDfa;
+
+/* The DFA being minimized, for MlnSignatureOrder() */
+typedef struct {
+  const int *next;
+  const int *block;
+  int nclass;
+} MlnSignature;
+
+#define MlnBitSet(set, i) ((set)[(i) >> 3] |= (unsigned char)(1 << ((i)&7)))
+#define MlnBitTest(set, i) (((set)[(i) >> 3] >> ((i)&7)) & 1)
+
+static int MlnNfaNewState(MlnNfa *nfa) {
+  MlnNfaState *st;
+  if (nfa->nstate >= nfa->nstate_alloc) {
+    nfa->nstate_alloc = nfa->nstate_alloc ? nfa->nstate_alloc * 2 : 64;
+    nfa->states =
+        realloc(nfa->states, sizeof(nfa->states[0]) * nfa->nstate_alloc);
+    MlnMemoryCheck(nfa->states);
+  }
+  st = &nfa->states[nfa->nstate];
+  st->set = -1;
+  st->out = -1;
+  st->eps[0] = st->eps[1] = -1;
+  st->accept = 0;
+  return nfa->nstate++;
+}
+
+static void MlnNfaEps(MlnNfa *nfa, int from, int to) {
+  MlnNfaState *st = &nfa->states[from];
+  st->eps[st->eps[0] < 0 ? 0 : 1] = to;
+}
+
+/*
+ * Make the part of the NFA which matches one byte of "bits".
+ */
+static MlnFrag MlnFragBytes(MlnNfa *nfa, const unsigned char *bits) {
+  MlnFrag f;
+  if (nfa->nset >= nfa->nset_alloc) {
+    nfa->nset_alloc = nfa->nset_alloc ? nfa->nset_alloc * 2 : 16;
+    nfa->sets = realloc(nfa->sets, sizeof(nfa->sets[0]) * nfa->nset_alloc);
+    MlnMemoryCheck(nfa->sets);
+  }
+  memcpy(nfa->sets[nfa->nset], bits, 32);
+  f.start = MlnNfaNewState(nfa);
+  f.end = MlnNfaNewState(nfa);
+  nfa->states[f.start].set = nfa->nset++;
+  nfa->states[f.start].out = f.end;
+  return f;
+}
+
+static int MlnHexDigit(int c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+/*
+ * Parse the escape after a backslash, and add its bytes to "bits".
+ * Return the byte, or -1 if the escape is a class like \d.
+ */
+static int MlnParseEscape(MlnRegexParser *rp, unsigned char *bits) {
+  int c = (unsigned char)*rp->p++;
+  int i, hi, lo;
+  switch (c) {
+  case '\0':
+    rp->p--;
+    rp->error = "it ends with a backslash";
+    return 0;
+  case 'n':
+    c = '\n';
+    break;
+  case 't':
+    c = '\t';
+    break;
+  case 'r':
+    c = '\r';
+    break;
+  case 'f':
+    c = '\f';
+    break;
+  case 'v':
+    c = '\v';
+    break;
+  case 'x':
+    hi = MlnHexDigit(rp->p[0]);
+    lo = hi < 0 ? -1 : MlnHexDigit(rp->p[1]);
+    if (lo < 0) {
+      rp->error = "\\x needs two hexadecimal digits";
+      return 0;
+    }
+    rp->p += 2;
+    c = hi * 16 + lo;
+    break;
+  case 'd':
+  case 's':
+  case 'w':
+    for (i = 0; i < 256; i++) {
+      if ((c == 'd' && i >= '0' && i <= '9') ||
+          (c == 's' && (i == ' ' || (i >= '\t' && i <= '\r'))) ||
+          (c == 'w' && ((i >= '0' && i <= '9') || (i >= 'a' && i <= 'z') ||
+                        (i >= 'A' && i <= 'Z') || i == '_'))) {
+        MlnBitSet(bits, i);
+      }
+    }
+    return -1;
+  default:
+    break;
+  }
+  MlnBitSet(bits, c);
+  return c;
+}
+
+/*
+ * Parse a class of bytes, after its "[".
+ */
+static MlnFrag MlnParseClass(MlnRegexParser *rp) {
+  unsigned char bits[32];
+  int negate, c, hi, i;
+
+  memset(bits, 0, sizeof(bits));
+  negate = *rp->p == '^';
+  if (negate) {
+    rp->p++;
+  }
+  if (*rp->p == ']') {
+    rp->error = "a class is empty";
+  }
+  while (rp->error == NULL && *rp->p != ']') {
+    if (*rp->p == '\0') {
+      rp->error = "a class is not closed";
+      break;
+    }
+    if (*rp->p == '\\') {
+      rp->p++;
+      c = MlnParseEscape(rp, bits);
+    } else {
+      c = (unsigned char)*rp->p++;
+      MlnBitSet(bits, c);
+    }
+    if (c < 0 || rp->p[0] != '-' || rp->p[1] == ']' || rp->p[1] == '\0') {
+      continue;
+    }
+    rp->p++;
+    if (*rp->p == '\\') {
+      rp->p++;
+      hi = MlnParseEscape(rp, bits);
+    } else {
+      hi = (unsigned char)*rp->p++;
+    }
+    if (hi < c) {
+      rp->error = "a range of a class is reversed";
+      break;
+    }
+    for (i = c; i <= hi; i++) {
+      MlnBitSet(bits, i);
+    }
+  }
+  if (rp->error == NULL) {
+    rp->p++;
+  }
+  if (negate) {
+    for (i = 0; i < 32; i++) {
+      bits[i] = (unsigned char)~bits[i];
+    }
+  }
+  return MlnFragBytes(rp->nfa, bits);
+}
+
+static MlnFrag MlnParseAlt(MlnRegexParser *rp);
+
+/*
+ * Parse a byte, a class or a group.
+ */
+static MlnFrag MlnParseAtom(MlnRegexParser *rp) {
+  unsigned char bits[32];
+  MlnFrag f;
+  int c = (unsigned char)*rp->p++;
+
+  memset(bits, 0, sizeof(bits));
+  switch (c) {
+  case '(':
+    f = MlnParseAlt(rp);
+    if (rp->error == NULL && *rp->p++ != ')') {
+      rp->p--;
+      rp->error = "a parenthesis is not closed";
+    }
+    return f;
+  case '[':
+    return MlnParseClass(rp);
+  case '*':
+  case '+':
+  case '?':
+    rp->error = "a repetition has nothing to repeat";
+    break;
+  case '.':
+    memset(bits, 0xFF, sizeof(bits));
+    bits['\n' >> 3] &= (unsigned char)~(1 << ('\n' & 7));
+    break;
+  case '\\':
+    MlnParseEscape(rp, bits);
+    break;
+  default:
+    MlnBitSet(bits, c);
+    break;
+  }
+  return MlnFragBytes(rp->nfa, bits);
+}
+
+/*
+ * Parse an atom and the repetitions which follow it.
+ */
+static MlnFrag MlnParseRepeat(MlnRegexParser *rp) {
+  MlnNfa *nfa = rp->nfa;
+  MlnFrag f = MlnParseAtom(rp);
+  MlnFrag r;
+
+  while (rp->error == NULL &&
+         (*rp->p == '*' || *rp->p == '+' || *rp->p == '?')) {
+    int op = *rp->p++;
+    r.start = op == '+' ? f.start : MlnNfaNewState(nfa);
+    r.end = MlnNfaNewState(nfa);
+    if (op != '+') {
+      MlnNfaEps(nfa, r.start, f.start);
+      MlnNfaEps(nfa, r.start, r.end);
+    }
+    if (op != '?') {
+      MlnNfaEps(nfa, f.end, f.start);
+    }
+    MlnNfaEps(nfa, f.end, r.end);
+    f = r;
+  }
+  return f;
+}
+
+/*
+ * Parse a sequence of repetitions, which may be empty.
+ */
+static MlnFrag MlnParseConcat(MlnRegexParser *rp) {
+  MlnFrag f, g;
+
+  f.start = f.end = MlnNfaNewState(rp->nfa);
+  while (rp->error == NULL && *rp->p != '\0' && *rp->p != '|' &&
+         *rp->p != ')') {
+    g = MlnParseRepeat(rp);
+    MlnNfaEps(rp->nfa, f.end, g.start);
+    f.end = g.end;
+  }
+  return f;
+}
+
+/*
+ * Parse alternatives separated by "|".
+ */
+static MlnFrag MlnParseAlt(MlnRegexParser *rp) {
+  MlnNfa *nfa = rp->nfa;
+  MlnFrag f = MlnParseConcat(rp);
+  MlnFrag g, r;
+
+  while (rp->error == NULL && *rp->p == '|') {
+    rp->p++;
+    g = MlnParseConcat(rp);
+    r.start = MlnNfaNewState(nfa);
+    r.end = MlnNfaNewState(nfa);
+    MlnNfaEps(nfa, r.start, f.start);
+    MlnNfaEps(nfa, r.start, g.start);
+    MlnNfaEps(nfa, f.end, r.end);
+    MlnNfaEps(nfa, g.end, r.end);
+    f = r;
+  }
+  return f;
+}
+
+/*
+ * Add the NFA state "s" and the states reached from it by empty edges
+ * to "set".
+ */
+static void MlnNfaClosure(MlnNfa *nfa, int s, unsigned *set, int *stack) {
+  int n = 0;
+  int i;
+
+  if (set[s >> 5] & (1u << (s & 31))) {
+    return;
+  }
+  set[s >> 5] |= 1u << (s & 31);
+  stack[n++] = s;
+  while (n > 0) {
+    MlnNfaState *st = &nfa->states[stack[--n]];
+    for (i = 0; i < 2; i++) {
+      int t = st->eps[i];
+      if (t >= 0 && !(set[t >> 5] & (1u << (t & 31)))) {
+        set[t >> 5] |= 1u << (t & 31);
+        stack[n++] = t;
+      }
+    }
+  }
+}
+
+static unsigned MlnDfaHash(const unsigned *set, int nword) {
+  unsigned h = 0;
+  int i;
+  for (i = 0; i < nword; i++) {
+    h = h * 0x9E3779B1u + set[i];
+  }
+  return h;
+}
+
+/*
+ * Return the DFA state of the set of NFA states, adding it if it is
+ * new.
+ */
+static int MlnDfaState(MlnDfa *dfa, const unsigned *set, int nclass) {
+  size_t bytes = sizeof(unsigned) * dfa->nword;
+  unsigned h;
+  int i, k;
+
+  h = MlnDfaHash(set, dfa->nword);
+  for (i = h & (dfa->ht_size - 1); dfa->ht[i] != 0;
+       i = (i + 1) & (dfa->ht_size - 1)) {
+    k = dfa->ht[i] - 1;
+    if (memcmp(&dfa->sets[(size_t)k * dfa->nword], set, bytes) == 0) {
+      return k;
+    }
+  }
+
+  if (dfa->nstate >= dfa->nstate_alloc) {
+    dfa->nstate_alloc *= 2;
+    dfa->sets = realloc(dfa->sets, bytes * dfa->nstate_alloc);
+    dfa->next = realloc(dfa->next,
+                        sizeof(int) * (size_t)nclass * dfa->nstate_alloc);
+    MlnMemoryCheck(dfa->sets);
+    MlnMemoryCheck(dfa->next);
+  }
+  k = dfa->nstate++;
+  memcpy(&dfa->sets[(size_t)k * dfa->nword], set, bytes);
+  dfa->ht[i] = k + 1;
+
+  if (dfa->nstate * 2 > dfa->ht_size) {
+    free(dfa->ht);
+    dfa->ht_size *= 2;
+    dfa->ht = calloc(dfa->ht_size, sizeof(int));
+    MlnMemoryCheck(dfa->ht);
+    for (k = 0; k < dfa->nstate; k++) {
+      h = MlnDfaHash(&dfa->sets[(size_t)k * dfa->nword], dfa->nword);
+      for (i = h & (dfa->ht_size - 1); dfa->ht[i] != 0;
+           i = (i + 1) & (dfa->ht_size - 1)) {
+      }
+      dfa->ht[i] = k + 1;
+    }
+    k = dfa->nstate - 1;
+  }
+  return k;
+}
+
+/*
+ * Order the DFA states by their block, then by the blocks they lead
+ * to.
+ */
+static int MlnSignatureOrder(const MlnSignature *sig, int s1, int s2) {
+  const int *n1 = &sig->next[(size_t)s1 * sig->nclass];
+  const int *n2 = &sig->next[(size_t)s2 * sig->nclass];
+  int c, b1, b2;
+
+  if (sig->block[s1] != sig->block[s2]) {
+    return sig->block[s1] < sig->block[s2] ? -1 : 1;
+  }
+  for (c = 0; c < sig->nclass; c++) {
+    b1 = sig->block[n1[c]];
+    b2 = sig->block[n2[c]];
+    if (b1 != b2) {
+      return b1 < b2 ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Sort the "n" states of "order" by MlnSignatureOrder(), keeping the
+ * order of the equal ones. "tmp" has room for n states.
+ */
+static void MlnSignatureSort(const MlnSignature *sig, int *order, int *tmp,
+                             int n) {
+  int width, lo, mid, hi, i, j, k;
+
+  for (width = 1; width < n; width *= 2) {
+    for (lo = 0; lo < n - width; lo += 2 * width) {
+      mid = lo + width;
+      hi = mid + width < n ? mid + width : n;
+      i = lo;
+      j = mid;
+      for (k = lo; k < hi; k++) {
+        if (j >= hi ||
+            (i < mid && MlnSignatureOrder(sig, order[i], order[j]) <= 0)) {
+          tmp[k] = order[i++];
+        } else {
+          tmp[k] = order[j++];
+        }
+      }
+      memcpy(&order[lo], &tmp[lo], sizeof(int) * (hi - lo));
+    }
+  }
+}
+
+/*
+ * Group the bytes into the classes that no byte set tells apart. The
+ * classes are numbered by their first byte. Return the number of
+ * classes, and set the first byte of each in "rep".
+ */
+static int MlnByteClasses(MlnNfa *nfa, int *byte_class, int *rep) {
+  int renum[512];
+  int i, k, n = 1;
+
+  memset(byte_class, 0, sizeof(int) * 256);
+  for (k = 0; k < nfa->nset; k++) {
+    for (i = 0; i < 2 * n; i++) {
+      renum[i] = -1;
+    }
+    n = 0;
+    for (i = 0; i < 256; i++) {
+      int key = byte_class[i] * 2 + MlnBitTest(nfa->sets[k], i);
+      if (renum[key] < 0) {
+        renum[key] = n++;
+      }
+      byte_class[i] = renum[key];
+    }
+  }
+  for (i = 255; i >= 0; i--) {
+    rep[byte_class[i]] = i;
+  }
+  return n;
+}
+
+/*
+ * Turn the NFA into a DFA over the classes of bytes. State 0 is the
+ * empty set, and state 1 the set of "start".
+ */
+static void MlnDfaBuild(MlnDfa *dfa, MlnNfa *nfa, int start, const int *rep,
+                        int nclass) {
+  unsigned *set;
+  int *stack;
+  int s, c, i;
+
+  dfa->nword = (nfa->nstate + 31) / 32;
+  dfa->nstate = 0;
+  dfa->nstate_alloc = 64;
+  dfa->ht_size = 256;
+  dfa->sets = malloc(sizeof(unsigned) * dfa->nword * dfa->nstate_alloc);
+  dfa->next = malloc(sizeof(int) * nclass * dfa->nstate_alloc);
+  dfa->ht = calloc(dfa->ht_size, sizeof(int));
+  set = malloc(sizeof(unsigned) * dfa->nword);
+  stack = malloc(sizeof(int) * nfa->nstate);
+  MlnMemoryCheck(dfa->sets);
+  MlnMemoryCheck(dfa->next);
+  MlnMemoryCheck(dfa->ht);
+  MlnMemoryCheck(set);
+  MlnMemoryCheck(stack);
+
+  memset(set, 0, sizeof(unsigned) * dfa->nword);
+  MlnDfaState(dfa, set, nclass);
+  MlnNfaClosure(nfa, start, set, stack);
+  MlnDfaState(dfa, set, nclass);
+
+  for (s = 0; s < dfa->nstate; s++) {
+    for (c = 0; c < nclass; c++) {
+      memset(set, 0, sizeof(unsigned) * dfa->nword);
+      for (i = 0; i < nfa->nstate; i++) {
+        MlnNfaState *st = &nfa->states[i];
+        if ((dfa->sets[(size_t)s * dfa->nword + (i >> 5)] >> (i & 31)) & 1 &&
+            st->set >= 0 && MlnBitTest(nfa->sets[st->set], rep[c])) {
+          MlnNfaClosure(nfa, st->out, set, stack);
+        }
+      }
+      i = MlnDfaState(dfa, set, nclass);
+      dfa->next[(size_t)s * nclass + c] = i;
+    }
+  }
+  free(stack);
+  free(set);
+}
+
+/*
+ * Merge the equivalent states of the DFA, whose "accept" values are
+ * given, into "lx".
+ */
+static void MlnDfaMinimize(MlnDfa *dfa, const int *accept, int nclass,
+                           MlnLexer *lx) {
+  MlnSignature sig;
+  int *block, *order, *map, *queue, *first;
+  int nblock, n, s, c, i, head;
+
+  block = malloc(sizeof(int) * dfa->nstate);
+  order = malloc(sizeof(int) * dfa->nstate);
+  map = malloc(sizeof(int) * dfa->nstate);
+  first = malloc(sizeof(int) * dfa->nstate);
+  queue = malloc(sizeof(int) * dfa->nstate);
+  MlnMemoryCheck(block);
+  MlnMemoryCheck(order);
+  MlnMemoryCheck(map);
+  MlnMemoryCheck(first);
+  MlnMemoryCheck(queue);
+
+  /* The states start out grouped by their token, and a group is split
+   * while its states lead to different groups */
+  for (s = 0; s < dfa->nstate; s++) {
+    block[s] = accept[s] + 1;
+  }
+  sig.next = dfa->next;
+  sig.block = block;
+  sig.nclass = nclass;
+  nblock = -1;
+  for (;;) {
+    for (s = 0; s < dfa->nstate; s++) {
+      order[s] = s;
+    }
+    MlnSignatureSort(&sig, order, queue, dfa->nstate);
+    n = 0;
+    for (i = 0; i < dfa->nstate; i++) {
+      if (i > 0 && MlnSignatureOrder(&sig, order[i - 1], order[i]) != 0) {
+        n++;
+      }
+      map[order[i]] = n;
+    }
+    memcpy(block, map, sizeof(int) * dfa->nstate);
+    if (n + 1 == nblock) {
+      break;
+    }
+    nblock = n + 1;
+  }
+
+  /* Number the blocks: the dead state 0, the start 1, and the others
+   * in breadth-first order */
+  for (i = 0; i < nblock; i++) {
+    map[i] = -1;
+  }
+  for (s = dfa->nstate - 1; s >= 0; s--) {
+    first[block[s]] = s;
+  }
+  map[block[0]] = 0;
+  map[block[1]] = 1;
+  n = 2;
+  queue[0] = block[1];
+  for (head = 0, i = 1; head < i; head++) {
+    s = first[queue[head]];
+    for (c = 0; c < nclass; c++) {
+      int b = block[dfa->next[(size_t)s * nclass + c]];
+      if (map[b] < 0) {
+        map[b] = n++;
+        queue[i++] = b;
+      }
+    }
+  }
+
+  lx->nstate = n;
+  lx->nclass = nclass;
+  lx->next = malloc(sizeof(int) * nclass * n);
+  lx->accept = malloc(sizeof(int) * n);
+  MlnMemoryCheck(lx->next);
+  MlnMemoryCheck(lx->accept);
+  for (i = 0; i < nblock; i++) {
+    if (map[i] < 0) {
+      continue;
+    }
+    s = first[i];
+    lx->accept[map[i]] = accept[s];
+    for (c = 0; c < nclass; c++) {
+      lx->next[(size_t)map[i] * nclass + c] =
+          map[block[dfa->next[(size_t)s * nclass + c]]];
+    }
+  }
+  free(queue);
+  free(first);
+  free(map);
+  free(order);
+  free(block);
+}
+
+/*
+ * Build the scanner of the patterns of the grammar. Return the number
+ * of states, or 0 if there are no patterns or a pattern is bad, in
+ * which case nothing is allocated.
+ */
+int MlnLexerBuild(MlnLexer *lx, Melon *melon) {
+  MlnNfa nfa;
+  MlnDfa dfa;
+  MlnRegex *re;
+  MlnRegexParser rp;
+  MlnFrag f;
+  int *starts, *stack, *accept;
+  int rep[256];
+  unsigned *set;
+  int npattern, k, s, i, root, fork, prev, nerror;
+
+  memset(lx, 0, sizeof(*lx));
+  npattern = 0;
+  for (re = melon->regex; re != NULL; re = re->next) {
+    npattern++;
+  }
+  if (npattern == 0) {
+    return 0;
+  }
+
+  /* Join the parts of all patterns by a chain of empty edges */
+  memset(&nfa, 0, sizeof(nfa));
+  starts = malloc(sizeof(int) * npattern);
+  MlnMemoryCheck(starts);
+  nerror = 0;
+  root = prev = -1;
+  for (k = 0, re = melon->regex; re != NULL; k++, re = re->next) {
+    rp.nfa = &nfa;
+    rp.p = re->pattern;
+    rp.error = NULL;
+    f = MlnParseAlt(&rp);
+    if (rp.error == NULL && *rp.p != '\0') {
+      rp.error = "a parenthesis is not opened";
+    }
+    if (rp.error != NULL) {
+      MlnErrorMsg(melon->filename, re->line, "Bad pattern \"%s\": %s.",
+                  re->pattern, rp.error);
+      nerror++;
+      continue;
+    }
+    nfa.states[f.end].accept = k + 1;
+    starts[k] = f.start;
+    fork = MlnNfaNewState(&nfa);
+    MlnNfaEps(&nfa, fork, f.start);
+    if (prev >= 0) {
+      MlnNfaEps(&nfa, prev, fork);
+    } else {
+      root = fork;
+    }
+    prev = fork;
+  }
+
+  /* A pattern matching nothing would never advance */
+  set = malloc(sizeof(unsigned) * ((nfa.nstate + 31) / 32));
+  stack = malloc(sizeof(int) * nfa.nstate);
+  MlnMemoryCheck(set);
+  MlnMemoryCheck(stack);
+  for (k = 0, re = melon->regex; nerror == 0 && re != NULL;
+       k++, re = re->next) {
+    memset(set, 0, sizeof(unsigned) * ((nfa.nstate + 31) / 32));
+    MlnNfaClosure(&nfa, starts[k], set, stack);
+    for (s = 0; s < nfa.nstate; s++) {
+      if ((set[s >> 5] >> (s & 31)) & 1 && nfa.states[s].accept == k + 1) {
+        MlnErrorMsg(melon->filename, re->line,
+                    "Pattern \"%s\" matches the empty string.", re->pattern);
+        nerror++;
+        break;
+      }
+    }
+  }
+  free(stack);
+  free(set);
+  free(starts);
+  if (nerror > 0) {
+    melon->error_cnt += nerror;
+    free(nfa.states);
+    free(nfa.sets);
+    return 0;
+  }
+
+  lx->nclass = MlnByteClasses(&nfa, lx->byte_class, rep);
+  MlnDfaBuild(&dfa, &nfa, root, rep, lx->nclass);
+
+  /* The token of a DFA state is the one of its first pattern */
+  accept = malloc(sizeof(int) * dfa.nstate);
+  MlnMemoryCheck(accept);
+  for (s = 0; s < dfa.nstate; s++) {
+    int best = 0;
+    for (i = 0; i < nfa.nstate; i++) {
+      int a = nfa.states[i].accept;
+      if (a > 0 && (best == 0 || a < best) &&
+          (dfa.sets[(size_t)s * dfa.nword + (i >> 5)] >> (i & 31)) & 1) {
+        best = a;
+      }
+    }
+    accept[s] = 0;
+    if (best > 0) {
+      for (re = melon->regex; --best > 0; re = re->next) {
+      }
+      accept[s] = re->sym != NULL ? re->sym->index : -1;
+    }
+  }
+  MlnDfaMinimize(&dfa, accept, lx->nclass, lx);
+
+  free(accept);
+  free(dfa.sets);
+  free(dfa.next);
+  free(dfa.ht);
+  free(nfa.states);
+  free(nfa.sets);
+  return lx->nstate;
+}
+
+void MlnLexerFree(MlnLexer *lx) {
+  free(lx->next);
+  free(lx->accept);
+  memset(lx, 0, sizeof(*lx));
+}
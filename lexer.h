@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#ifndef MELON_LEXER_H_
+#define MELON_LEXER_H_
+
+#include "struct.h"
+
+/*
+ * The minimal DFA of the patterns of the grammar. State 0 is the dead
+ * state and state 1 the start. From state s, the byte c leads to
+ * next[s * nclass + byte_class[c]].
+ */
+typedef struct MlnLexer {
+  int nstate;          /* Number of states */
+  int nclass;          /* Number of classes of bytes */
+  int byte_class[256]; /* The class of every byte */
+  int *next;           /* Transitions, nclass per state */
+  int *accept;         /* Token accepted by each state, 0 for none, and
+                        * -1 for a skipped match */
+} MlnLexer;
+
+int MlnLexerBuild(MlnLexer *lx, Melon *melon);
+void MlnLexerFree(MlnLexer *lx);
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#include "libmelon.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "generate.h"
+#include "struct.h"
+
+struct MlnContext {
+  char *name;     /* Name of the grammar, the base of the output names */
+  int flags;      /* MLN_GEN_* flags */
+  int split;      /* Rules per file of actions, 0 for a single file */
+  char **defines; /* Macros for %ifdef, as given to -D */
+  int ndefine;    /* Number of defines */
+  char *tpl;      /* Text of the template */
+  size_t tpl_len; /* Length of tpl */
+};
+
+/*
+ * Report an out-of-memory condition and abort the generation. This
+ * function is used mostly by the "MlnMemoryCheck" function in struct.h
+ */
+void memory_error() {
+  fprintf(MlnErrorStream(stderr), "Out of memory. Aborting...\n");
+  MlnErrorAbort();
+}
+
+/*
+ * Copy "len" bytes of "text" into memory from malloc(), adding a
+ * terminator.
+ */
+static char *MlnContextCopy(const char *text, size_t len) {
+  char *copy = malloc(len + 1);
+  MlnMemoryCheck(copy);
+  memcpy(copy, text, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+/*
+ * Create a context for the grammar "name". The name is used like the
+ * name of a grammar file: it appears in the diagnostics, and the
+ * outputs are named after it.
+ */
+MlnContext *MlnContextNew(const char *name, int flags) {
+  MlnContext *ctx = malloc(sizeof(MlnContext));
+  MlnMemoryCheck(ctx);
+  ctx->name = MlnContextCopy(name, strlen(name));
+  ctx->flags = flags;
+  ctx->split = 0;
+  ctx->defines = NULL;
+  ctx->ndefine = 0;
+  ctx->tpl = NULL;
+  ctx->tpl_len = 0;
+  return ctx;
+}
+
+void MlnContextFree(MlnContext *ctx) {
+  int i;
+  if (ctx == NULL) {
+    return;
+  }
+  for (i = 0; i < ctx->ndefine; i++) {
+    free(ctx->defines[i]);
+  }
+  free(ctx->defines);
+  free(ctx->tpl);
+  free(ctx->name);
+  free(ctx);
+}
+
+/*
+ * Define a macro for %ifdef, like the -D switch.
+ */
+void MlnContextDefine(MlnContext *ctx, const char *macro) {
+  ctx->defines =
+      realloc(ctx->defines, sizeof(ctx->defines[0]) * (ctx->ndefine + 1));
+  MlnMemoryCheck(ctx->defines);
+  ctx->defines[ctx->ndefine++] = MlnContextCopy(macro, strlen(macro));
+}
+
+/*
+ * Split the parser into files, like the split=<integer> switch: a
+ * shared header, the tables, the action code of every "rules" rules,
+ * and the driver. Zero gives a single file.
+ */
+void MlnContextSetSplit(MlnContext *ctx, int rules) { ctx->split = rules; }
+
+/*
+ * Set the text of the parser driver template. The text is copied.
+ */
+void MlnContextSetTemplate(MlnContext *ctx, const char *text, size_t len) {
+  free(ctx->tpl);
+  ctx->tpl = MlnContextCopy(text, len);
+  ctx->tpl_len = len;
+}
+
+/*
+ * Generate the parser for the grammar text of the given length, and
+ * hand the outputs to "sinks". Return the number of errors and
+ * conflicts, like the exit code of the command line tool, or
+ * MLN_GEN_ABORTED.
+ */
+int MlnGenerate(MlnContext *ctx, const char *grammar, size_t len,
+                const MlnSinks *sinks) {
+  MlnGenOptions opts;
+  Melon *melon;
+  FILE *diag = NULL;
+  FILE *prev_stream;
+  char *diag_buf = NULL;
+  size_t diag_len = 0;
+  jmp_buf abort_target;
+  jmp_buf *prev_target;
+  int rc;
+
+  opts.rpflag = 0;
+  opts.basis_flag = (ctx->flags & MLN_GEN_BASIS) != 0;
+  opts.compress = (ctx->flags & MLN_GEN_NO_COMPRESS) != 0;
+  opts.interleave = (ctx->flags & MLN_GEN_INTERLEAVE) != 0;
+  opts.pad_tables = (ctx->flags & MLN_GEN_PAD_TABLES) != 0;
+  opts.pack_tables = (ctx->flags & MLN_GEN_PACK_TABLES) != 0;
+  opts.cplusplus = (ctx->flags & MLN_GEN_CPLUSPLUS) != 0;
+  opts.prune = (ctx->flags & MLN_GEN_PRUNE) != 0;
+  opts.renumber = (ctx->flags & MLN_GEN_RENUMBER) != 0;
+  opts.split = ctx->split;
+  opts.use_cache = 0;
+  opts.quiet = (ctx->flags & MLN_GEN_NO_REPORT) != 0;
+  opts.mhflag = (ctx->flags & MLN_GEN_MAKEHEADERS) != 0;
+  opts.defines = ctx->defines;
+  opts.ndefine = ctx->ndefine;
+
+  /* The generation may be nested in a sink of another one, so the
+   * stream and the abort target of the thread are restored at the end */
+  melon = calloc(1, sizeof(Melon));
+  if (melon == NULL) {
+    return MLN_GEN_ABORTED;
+  }
+  if (sinks->diagnostic != NULL) {
+    diag = open_memstream(&diag_buf, &diag_len);
+    if (diag == NULL) {
+      free(melon);
+      return MLN_GEN_ABORTED;
+    }
+  }
+  prev_stream = MlnErrorStream(NULL);
+  if (diag != NULL) {
+    MlnErrorSetStream(diag);
+  }
+  prev_target = MlnErrorSetAbort(&abort_target);
+
+  if (setjmp(abort_target) == 0) {
+    rc = MlnLoadGrammar(melon, &opts, NULL, ctx->name, grammar, len);
+    if (rc == 0) {
+      melon->sinks = sinks;
+      melon->tpl_buf = ctx->tpl;
+      melon->tpl_len = ctx->tpl_len;
+      MlnGenerateParser(melon, &opts);
+      rc = melon->error_cnt + melon->nconflict;
+    }
+    MlnFreeAutomaton(melon);
+  } else {
+    /* Release the automaton as far as it was built, and the output
+     * being written */
+    MlnFreeAutomaton(melon);
+    if (melon->sink_file != NULL) {
+      fclose(melon->sink_file);
+    }
+    free(melon->sink_buf);
+    rc = MLN_GEN_ABORTED;
+  }
+  MlnErrorSetAbort(prev_target);
+  MlnFreeGrammar(melon);
+  free(melon);
+
+  MlnErrorSetStream(prev_stream);
+  if (diag != NULL) {
+    fclose(diag);
+    if (diag_len > 0) {
+      sinks->diagnostic(sinks->arg, diag_buf, diag_len);
+    }
+    free(diag_buf);
+  }
+  return rc;
+}
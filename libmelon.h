@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ *
+ * In-process interface of the Melon parser generator. A context holds
+ * the settings of one grammar, and MlnGenerate() turns the grammar text
+ * into the parser sources, which are handed to caller-supplied sinks
+ * instead of being written to files. Each thread may run its own
+ * generation concurrently, and a sink may run another generation; a
+ * context must not be shared by threads generating at the same time.
+ * There is no default template: it must be given with
+ * MlnContextSetTemplate().
+ */
+
+#ifndef MELON_LIBMELON_H_
+#define MELON_LIBMELON_H_
+
+#include <stddef.h>
+
+/* Flags of MlnContextNew(), matching the command line switches */
+#define MLN_GEN_NO_COMPRESS 0x01 /* -c: Don't compress the action table */
+#define MLN_GEN_BASIS 0x02       /* -b: Print only the basis in report */
+#define MLN_GEN_NO_REPORT 0x04   /* -q: Don't produce the report */
+#define MLN_GEN_MAKEHEADERS 0x08 /* -m: Output a makeheaders compatible file */
+#define MLN_GEN_INTERLEAVE 0x10  /* -i: Interleave lookahead and action */
+#define MLN_GEN_PRUNE 0x20       /* -u: Remove useless symbols and states */
+#define MLN_GEN_RENUMBER 0x40    /* -r: Renumber symbols for a smaller table */
+#define MLN_GEN_PACK_TABLES 0x80 /* -p: Output tables as string literals */
+#define MLN_GEN_CPLUSPLUS 0x100  /* --cxx: Output a C++ parser header */
+#define MLN_GEN_PAD_TABLES 0x200 /* --pad: Pad the action table */
+
+/* Returned by MlnGenerate() when the generation ran out of memory or
+ * failed an internal check. The diagnostics tell which. */
+#define MLN_GEN_ABORTED (-1)
+
+typedef struct MlnSinks {
+  /* Receive the complete text of the output with the given suffix:
+   * ".c", ".h" or ".out". A split parser also has "_int.h", "_tab.c"
+   * and "_act0.c", "_act1.c"... A C++ parser is ".hpp" alone. */
+  void (*output)(void *arg, const char *suffix, const char *data,
+                 size_t len);
+  /* Receive all diagnostics of a generation, if there are any. If
+   * NULL, they are printed as by the command line tool. */
+  void (*diagnostic)(void *arg, const char *data, size_t len);
+  void *arg; /* Passed to the callbacks */
+} MlnSinks;
+
+typedef struct MlnContext MlnContext;
+
+MlnContext *MlnContextNew(const char *name, int flags);
+void MlnContextFree(MlnContext *ctx);
+void MlnContextDefine(MlnContext *ctx, const char *macro);
+void MlnContextSetSplit(MlnContext *ctx, int rules);
+void MlnContextSetTemplate(MlnContext *ctx, const char *text, size_t len);
+int MlnGenerate(MlnContext *ctx, const char *grammar, size_t len,
+                const MlnSinks *sinks);
+
+#endif
@@ -3,18 +3,22 @@
  * Author: mn, mn@furzoom.com
  */
 
-#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 
-#include "build.h"
+#include "cache.h"
 #include "error.h"
+#include "generate.h"
 #include "option.h"
-#include "parse.h"
 #include "report.h"
 #include "set.h"
 #include "struct.h"
 #include "table.h"
 #include "version.h"
+#include "watch.h"
 
 /*
  * Report an out-of-memory condition and abort. This function
@@ -25,161 +29,384 @@ void memory_error() {
   exit(1);
 }
 
-/* The main program. Parse the command line and do it... */
-int main(int argc, char *argv[]) {
-  int version = 0;
-  int rpflag = 0;
-  int basis_flag = 0;
-  int compress = 0;
-  int quiet = 0;
-  int statistics = 0;
-  int mhflag = 0;
-  int i;
-  MlnOption options[] = {
-      {MLN_OPT_FLAG, "b", &basis_flag, "Print only the basis in report."},
-      {MLN_OPT_FLAG, "c", &compress, "Don't compress the action table."},
-      {MLN_OPT_FSTR, "D", MlnHandleDOption, "Define an %ifdef macro."},
-      {MLN_OPT_FLAG, "g", &rpflag, "Print grammer without actions."},
-      {MLN_OPT_FLAG, "m", &mhflag, "Output a makeheaders compatible file."},
-      {MLN_OPT_FLAG, "q", &quiet, "(Quiet) Don't print the report file."},
-      {MLN_OPT_FLAG, "s", &statistics,
-       "Print parser stats to standard output."},
-      {MLN_OPT_FLAG, "v", &version, "Print the version number."},
-      {MLN_OPT_FLAG, NULL, NULL, NULL},
-  };
+static MlnGenOptions opts; /* Set from the command line */
+static int statistics = 0; /* Print parser stats to standard output */
+
+/* A grammar of a batch, and the outcome of its generation */
+typedef struct MlnBatchJob {
+  char *filename; /* The grammar file */
+  char *log;      /* Everything printed while generating the grammar */
+  size_t log_len; /* Length of the log */
+  int rc;         /* Number of errors and conflicts */
+} MlnBatchJob;
+
+static char *program = NULL;       /* The name of the program */
+static MlnBatchJob *batch = NULL;  /* All grammars, in command line order */
+static int nbatch = 0;             /* Number of grammars */
+static int next_job = 0;           /* Index of the next grammar to take */
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Handle a -D option. The macros are kept in the options, and read by
+ * every grammar of a batch.
+ */
+static void MlnAddDefine(char *z) {
+  opts.defines =
+      realloc(opts.defines, sizeof(opts.defines[0]) * (opts.ndefine + 1));
+  MlnMemoryCheck(opts.defines);
+  opts.defines[opts.ndefine++] = z;
+}
+
+static void MlnPrintStatistics(Melon *melon, FILE *out) {
+  fprintf(out, "Parser statistics: %d terminals, %d nonterminals, %d rules\n",
+          melon->nterminal - 1, melon->nsymbol - melon->nterminal - 1,
+          melon->nrule);
+  fprintf(out, "                   %d states, %ld parser table entries, "
+               "%d conflicts\n",
+          melon->nstate, melon->table_size, melon->nconflict);
+  fprintf(out, "                   %d classes of terminals\n",
+          melon->ntoken_class);
+  if (melon->nlex_state > 0) {
+    fprintf(out, "                   scanner of %d states, %d classes of "
+                 "bytes\n",
+            melon->nlex_state, melon->nlex_class);
+  }
+  if (melon->prune) {
+    fprintf(out, "                   removed %d nonterminals, %d rules, "
+                 "%d states\n",
+            melon->nprune_symbol, melon->nprune_rule, melon->nprune_state);
+  }
+  fprintf(out, "                   merged %d reduce actions, %d destructors\n",
+          melon->nmerge_action, melon->nmerge_dest);
+  MlnHashStatsPrint(melon, out);
+  MlnSetStatsPrint(melon, out);
+}
+
+/*
+ * Generate the parser of one grammar of a batch, on the state of the
+ * calling thread. The messages are collected in the log of the job.
+ */
+static void MlnRunJob(MlnBatchJob *job) {
   Melon melon;
+  FILE *log = open_memstream(&job->log, &job->log_len);
 
-  if (MlnOptInit(argv, options, stderr) < 0) {
-    return -1;
+  MlnMemoryCheck(log);
+  MlnErrorSetStream(log);
+
+  job->rc = MlnLoadGrammar(&melon, &opts, program, job->filename, NULL, 0);
+  if (job->rc == 0) {
+    MlnGenerateParser(&melon, &opts);
+    if (statistics != 0) {
+      /* Tell the statistics of the grammars of the batch apart */
+      fprintf(log, "%s:\n", job->filename);
+      MlnPrintStatistics(&melon, log);
+    }
+    job->rc = melon.error_cnt + melon.nconflict;
   }
-  if (version) {
-    printf("Melon version %s\n", MLN_VERSION);
-    return 0;
+  MlnFreeAutomaton(&melon);
+  MlnFreeGrammar(&melon);
+
+  MlnErrorSetStream(NULL);
+  fclose(log);
+}
+
+/*
+ * Take the grammars of the batch one after another, until all are
+ * taken.
+ */
+static void *MlnBatchWorker(void *arg) {
+  for (;;) {
+    int i;
+    pthread_mutex_lock(&batch_lock);
+    i = next_job++;
+    pthread_mutex_unlock(&batch_lock);
+    if (i >= nbatch) {
+      break;
+    }
+    MlnRunJob(&batch[i]);
   }
+  return arg;
+}
 
-  if (MlnOptNArgs() != 1) {
-    fprintf(stderr, "Exactly one filename argument is required.\n");
-    return -1;
+/*
+ * Generate the parsers of several grammars, with up to "jobs" of them
+ * at the same time. The messages of each grammar are printed once all
+ * are done, in the order of the grammars. Return the total number of
+ * errors and conflicts.
+ */
+static int MlnRunBatch(char **filenames, int n, int jobs) {
+  pthread_t *threads;
+  int nthread;
+  int i, rc = 0;
+
+  if (jobs <= 0) {
+    jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  nthread = jobs < n ? jobs : n;
+  if (nthread < 1) {
+    nthread = 1;
   }
 
-  /* Initialize the machine */
-  MlnStrSafeInit();
-  MlnSymbolInit();
-  MlnStateInit();
-
-  melon.error_cnt = 0;
-  melon.argv0 = argv[0];
-  melon.filename = MlnOptArg(0);
-  melon.basis_flag = basis_flag;
-  melon.has_fallback = 0;
-  melon.nconflict = 0;
-  melon.name = NULL;
-  melon.arg = NULL;
-  melon.token_type = NULL;
-  melon.var_type = NULL;
-  melon.start = NULL;
-  melon.stack_size = NULL;
-  melon.include = NULL;
-
-  melon.error = NULL;
-  melon.overflow = NULL;
-  melon.failure = NULL;
-  melon.accept = NULL;
-  melon.extra_code = NULL;
-  melon.token_dest = NULL;
-  melon.var_dest = NULL;
-  melon.output_file = NULL;
-  melon.token_prefix = NULL;
-
-  melon.table_size = 0;
-
-  MlnSymbolNew("$");
-  melon.err_sym = MlnSymbolNew("error");
-
-  /* Parse the input file */
-  MlnParse(&melon);
-
-  if (melon.error_cnt > 0) {
-    return melon.error_cnt;
-  }
-  if (melon.rule == 0) {
-    fprintf(stderr, "Empty grammar.\n");
-    return 1;
+  batch = calloc(n, sizeof(batch[0]));
+  threads = malloc(sizeof(threads[0]) * nthread);
+  MlnMemoryCheck(batch);
+  MlnMemoryCheck(threads);
+  for (i = 0; i < n; i++) {
+    batch[i].filename = filenames[i];
   }
+  nbatch = n;
+  next_job = 0;
 
-  /* Count and index the symbols of the grammar */
-  melon.nsymbol = MlnSymbolCount();
-  MlnSymbolNew("{default}");
-  melon.symbols = MlnSymbolArrayOf();
-  for (i = 0; i <= melon.nsymbol; i++) {
-    melon.symbols[i]->index = i;
+  for (i = 0; i < nthread; i++) {
+    if (pthread_create(&threads[i], NULL, MlnBatchWorker, NULL) != 0) {
+      break;
+    }
+  }
+  nthread = i;
+  if (nthread == 0) {
+    /* No thread could be started, do it all on this one */
+    MlnBatchWorker(NULL);
   }
-  qsort(melon.symbols, melon.nsymbol + 1, sizeof(MlnSymbol *),
-        (int (*)(const void *, const void *))MlnSymbolCmp);
-  for (i = 0; i <= melon.nsymbol; i++) {
-    melon.symbols[i]->index = i;
+  for (i = 0; i < nthread; i++) {
+    pthread_join(threads[i], NULL);
   }
-  for (i = 1; isupper(melon.symbols[i]->name[0]); i++) {
+
+  for (i = 0; i < n; i++) {
+    fwrite(batch[i].log, 1, batch[i].log_len, stdout);
+    free(batch[i].log);
+    rc += batch[i].rc;
   }
-  melon.nterminal = i;
+  free(threads);
+  free(batch);
+  batch = NULL;
+  return rc;
+}
 
-  /* Generate a reprint of the grammar, if requested on the command line */
-  if (rpflag) {
-    MlnReprint(&melon);
-  } else {
-    /* Initialize the size for all follow and first sets */
-    MlnSetSize(melon.nterminal);
+/*
+ * Return a monotonic time in milliseconds.
+ */
+static double MlnClockMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
 
-    /* Find the precedence for every production rule (that has one) */
-    MlnFindRulePrecedences(&melon);
+/* True if the automaton of "melon" can serve the next grammar */
+static int MlnIsReusable(Melon *melon, int loaded) {
+  /* A renumbered automaton, or one without the rules never reduced,
+   * doesn't match the numbers of a reloaded grammar */
+  return loaded && melon->sorted != NULL && melon->error_cnt == 0 &&
+         !melon->renumber && melon->nunreduced == 0;
+}
 
-    /* Compute the lambda-non-terminals and the first-sets for every
-     * non-terminal */
-    MlnFindFirstSets(&melon);
+/*
+ * Keep the grammar and its automaton resident, and regenerate the
+ * outputs whenever the grammar or the template changes. A template
+ * change only rewrites the parser. A grammar change reuses the
+ * automaton when the structure of the grammar is unchanged. Return
+ * only if the files can't be watched.
+ */
+static int MlnWatchGrammar(Melon *melon, int loaded) {
+  const char *paths[2];
+  char *tpl_name = MlnTplName(melon);
+  int npath = 0;
+  unsigned long long key = 0, prev_key;
+  int reusable; /* True if the automaton can serve the next grammar */
 
-    /* Compute all LR(0) states. Also record follow-set propagation
-     * links so that the follow-set can be computed later */
-    melon.nstate = 0;
-    MlnFindStates(&melon);
-    melon.sorted = MlnStateArrayOf();
+  paths[npath++] = melon->filename;
+  if (tpl_name != NULL) {
+    paths[npath++] = tpl_name;
+  }
+  if (MlnWatchInit(paths, npath) < 0) {
+    fprintf(stderr, "Can't watch \"%s\" for changes.\n", melon->filename);
+    free(tpl_name);
+    return 1;
+  }
+  printf("Watching \"%s\"%s%s%s for changes.\n", melon->filename,
+         tpl_name ? " and \"" : "", tpl_name ? tpl_name : "",
+         tpl_name ? "\"" : "");
+  fflush(stdout);
 
-    /* Tie up loose ends on the propagation links */
-    MlnFindLinks(&melon);
+  if (loaded) {
+    key = MlnCacheKey(melon, opts.compress);
+  }
+  reusable = MlnIsReusable(melon, loaded);
+  for (;;) {
+    int changed = MlnWatchWait();
+    int reused = 0;
+    double start;
 
-    /* Compute the follow set of every reducible configuration */
-    MlnFindFollowSets(&melon);
+    if (changed < 0) {
+      break;
+    }
+    start = MlnClockMs();
+    if (changed & 1) {
+      Melon prev = *melon; /* Holds the automaton of the old grammar */
+      int *rule_of = NULL; /* Rule index of every old configuration */
+      int i;
+
+      if (reusable) {
+        rule_of = malloc(sizeof(rule_of[0]) * (prev.nconfig + 1));
+        MlnMemoryCheck(rule_of);
+        for (i = 0; i < prev.nconfig; i++) {
+          rule_of[i] = prev.configs[i].rule->index;
+        }
+      } else {
+        MlnFreeAutomaton(&prev);
+      }
+      MlnFreeGrammar(melon);
 
-    /* Compute the action tables */
-    MlnFindActions(&melon);
+      loaded = MlnLoadGrammar(melon, &opts, prev.argv0, prev.filename, NULL,
+                              0) == 0;
+      prev_key = key;
+      if (loaded) {
+        key = MlnCacheKey(melon, opts.compress);
+      }
+      if (loaded && rule_of != NULL && key == prev_key) {
+        MlnRule **rules = malloc(sizeof(rules[0]) * melon->nrule);
+        MlnRule *rp;
+        MlnMemoryCheck(rules);
+        for (rp = melon->rule; rp != NULL; rp = rp->next) {
+          rules[rp->index] = rp;
+        }
+        for (i = 0; i < prev.nconfig; i++) {
+          prev.configs[i].rule = rules[rule_of[i]];
+        }
+        free(rules);
+        melon->sorted = prev.sorted;
+        melon->nstate = prev.nstate;
+        melon->configs = prev.configs;
+        melon->nconfig = prev.nconfig;
+        melon->nconflict = prev.nconflict;
+        reused = 1;
+      } else if (rule_of != NULL) {
+        MlnFreeAutomaton(&prev);
+      }
+      free(rule_of);
 
-    /* Compress the action tables */
-    if (compress == 0) {
-      MlnCompressTables(&melon);
+      if (loaded) {
+        MlnGenerateParser(melon, &opts);
+      }
+      reusable = MlnIsReusable(melon, loaded);
+    } else if (loaded && !opts.rpflag) {
+      /* Only the template changed */
+      MlnReportTable(melon, opts.mhflag);
+    } else {
+      continue;
     }
 
-    /* Generate a report of the parser generated. (the "y.output" file) */
-    if (quiet == 0) {
-      MlnReportOutput(&melon);
+    if (melon->error_cnt > 0) {
+      printf("%s: %d errors, regeneration took %.1f ms.\n", melon->filename,
+             melon->error_cnt, MlnClockMs() - start);
+    } else {
+      printf("%s: regenerated in %.1f ms%s.\n", melon->filename,
+             MlnClockMs() - start,
+             reused ? " (automaton reused)"
+                    : ((changed & 1) ? "" : " (template only)"));
+    }
+    if (statistics != 0 && loaded) {
+      MlnPrintStatistics(melon, stdout);
     }
+    fflush(stdout);
+  }
 
-    /* Generate the source code for the parser */
-    MlnReportTable(&melon, mhflag);
+  MlnWatchClose();
+  free(tpl_name);
+  return 1;
+}
 
-    /* Produce a header file for use by the scanner. (This step is
-     * ommited if the "-m" option is used because makeheaders will
-     * generate the file for us.) */
-    if (!mhflag) {
-      MlnReportHeader(&melon);
+/* The main program. Parse the command line and do it... */
+int main(int argc, char *argv[]) {
+  int version = 0;
+  int watch = 0;
+  int jobs = 1;
+  int errors;
+  int i;
+  MlnOption options[] = {
+      {MLN_OPT_FLAG, "b", &opts.basis_flag,
+       "Print only the basis in report."},
+      {MLN_OPT_FLAG, "c", &opts.compress,
+       "Don't compress the action table."},
+      {MLN_OPT_FSTR, "D", MlnAddDefine, "Define an %ifdef macro."},
+      {MLN_OPT_FLAG, "g", &opts.rpflag, "Print grammer without actions."},
+      {MLN_OPT_FLAG, "i", &opts.interleave,
+       "Interleave the lookahead and action tables. Entries of 3 bytes "
+       "are padded to 4."},
+      {MLN_OPT_INT, "j", &jobs,
+       "Generate this many grammars at once, 0 for one per CPU."},
+      {MLN_OPT_FLAG, "k", &opts.use_cache,
+       "Cache the automaton in a .mlc file."},
+      {MLN_OPT_FLAG, "m", &opts.mhflag,
+       "Output a makeheaders compatible file."},
+      {MLN_OPT_FLAG, "p", &opts.pack_tables,
+       "Output the parse tables as string literals."},
+      {MLN_OPT_FLAG, "q", &opts.quiet,
+       "(Quiet) Don't print the report file."},
+      {MLN_OPT_FLAG, "r", &opts.renumber,
+       "Renumber the symbols to shrink the action table."},
+      {MLN_OPT_FLAG, "s", &statistics,
+       "Print parser stats to standard output."},
+      {MLN_OPT_INT, "split", &opts.split,
+       "Split the parser into files, with this many rules of actions each."},
+      {MLN_OPT_FLAG, "u", &opts.prune,
+       "Remove useless symbols, rules and states."},
+      {MLN_OPT_FLAG, "v", &version, "Print the version number."},
+      {MLN_OPT_FLAG, "-cxx", &opts.cplusplus,
+       "Output a header-only C++17 parser class."},
+      {MLN_OPT_FLAG, "-pad", &opts.pad_tables,
+       "Pad the action table, so lookups need no range check."},
+      {MLN_OPT_FLAG, "-watch", &watch,
+       "Regenerate whenever the grammar or template changes."},
+      {MLN_OPT_FLAG, NULL, NULL, NULL},
+  };
+  Melon melon;
+
+  if (MlnOptInit(argv, options, stderr) < 0) {
+    return -1;
+  }
+  if (version) {
+    printf("Melon version %s\n", MLN_VERSION);
+    return 0;
+  }
+  if (opts.cplusplus && (opts.mhflag || opts.split > 0)) {
+    fprintf(stderr, "A C++ parser is a single header, without -m or "
+                    "split=.\n");
+    return -1;
+  }
+
+  if (MlnOptNArgs() < 1) {
+    fprintf(stderr, "At least one filename argument is required.\n");
+    return -1;
+  }
+  if (MlnOptNArgs() > 1) {
+    char **filenames;
+    if (watch) {
+      fprintf(stderr, "Only one grammar can be watched.\n");
+      return -1;
+    }
+    filenames = malloc(sizeof(filenames[0]) * MlnOptNArgs());
+    MlnMemoryCheck(filenames);
+    for (i = 0; i < MlnOptNArgs(); i++) {
+      filenames[i] = MlnOptArg(i);
     }
+    program = argv[0];
+    errors = MlnRunBatch(filenames, MlnOptNArgs(), jobs);
+    free(filenames);
+    return errors;
   }
 
-  if (statistics != 0) {
-    printf("Parser statistics: %d terminals, %d nonterminals, %d rules\n",
-           melon.nterminal - 1, melon.nsymbol - melon.nterminal - 1,
-           melon.nrule);
-    printf("                   %d states, %d parser table entries, "
-           "%d conflicts\n",
-           melon.nstate, melon.table_size, melon.nconflict);
+  errors = MlnLoadGrammar(&melon, &opts, argv[0], MlnOptArg(0), NULL, 0);
+  if (errors == 0) {
+    MlnGenerateParser(&melon, &opts);
+    if (statistics != 0) {
+      MlnPrintStatistics(&melon, stdout);
+    }
+  }
+  if (watch) {
+    return MlnWatchGrammar(&melon, errors == 0);
+  }
+  if (errors > 0) {
+    return errors;
   }
 
   return melon.error_cnt + melon.nconflict;
@@ -43,6 +43,9 @@
  *                        and nonterminal numbers. "unsigned char" is used
  *                        if there are fewer than 250 rules and states
  *                        combines. "int" is used otherwise.
+ *    YYNRHSTYPE          is the smallest unsigned type able to hold the
+ *                        number of right-hand side symbols of the longest
+ *                        rule in the grammar.
  *    ParseTOKENTYPE      is the data type used for minor tokens given
  *                        directly to the parser from the tokenizer.
  *    YYMINORTYPE         is the data type used for all minor tokens.
@@ -52,6 +55,7 @@
  *    YYSTACKDEPTH        is the maximum depth of the parser's stack.
  *    ParseARG_SDECL      A static variable declaration for the
  *    ParseARG_PDECL      A parameter declaration for the
+ *    ParseARG_PARAM      The %extra_argument passed on to Parse()
  *    ParseARG_STORE      Code to store %extra_argument into
  *    ParseARG_FETCH      Code to extract %extra_argument from
  *    YYNSTATE            the combined number of states.
@@ -64,6 +68,50 @@
 #define YY_ACCEPT_ACTION  (YYNSTATE + YYNRULE + 1)
 #define YY_ERROR_ACTION   (YYNSTATE + YYNRULE)
 
+/* Functions shared by the files of a split parser are not static */
+#ifndef YY_LINKAGE
+#define YY_LINKAGE static
+#endif
+
+/* The code run rarely, like the error handling and the actions of the
+ * rules marked %cold, is moved out of the way of the common paths */
+#if defined(__GNUC__)
+#define YY_COLD __attribute__((cold, noinline))
+#define YY_HOT __attribute__((hot))
+#else
+#define YY_COLD
+#define YY_HOT
+#endif
+
+/* The following structure represents a single element of the
+ * parser's stack. Information stored includes:
+ *
+ *    + The state number for the parser at this level of the stack.
+ *
+ *    + The value of the token stored at this level of the stack.
+ *      (In other words, the "major" token)
+ *
+ *    + The semantic value stored at this level of the stack. This is
+ *      the information used by the action routines in the grammar.
+ *      It is sometime called the "minor" token.
+ */
+typedef struct {
+  int state_no;       /* The state number */
+  int major;          /* The major token value. This is the code
+                         number for the token at this stack level */
+  YYMINORTYPE minor;  /* The user-supplied minor token value. This
+                         is the value of the token */
+} yyStackEntry;
+
+/* The state of the parser is completely contained in an instance of
+ * the following structure */
+typedef struct {
+  int yyidx;                  /* Index of top element in stack */
+  int yyerrcnt;               /* Shifts left before out of the error */
+  ParseARG_SDECL              /* A place to hold %extra_argument */
+  yyStackEntry yystack[YYSTACKDEPTH]; /* The parser's stack */
+} yyParser;
+
 /*
  * Next are that tables used to determine what action to take based on
  * the current state and lookahead token. These tables are used to
@@ -91,11 +139,15 @@
  *
  *      yy_action[ yy_shift_ofst[S] + X ]
  *
- *  If the index value yy_shift_ofst[S]+X is out of range or if the
- *  value yy_lookahead[yy_shift_ofst[S]+X is not equal to X or if
- *  yy_shift_ofst[S] is equal to YY_SHIFT_USE_DFLT, it means that
- *  the action is not in the table and that yy_default[S] should be
- *  used instead.
+ *  where X is the class of the lookahead, yy_token_class[] of it. The
+ *  terminals of a class have the same actions in every state, so they
+ *  share their entries. If the value yy_lookahead[yy_shift_ofst[S]+X]
+ *  is not equal to X, it means that the action is not in the table and
+ *  that yy_default[S] should be used instead, and so it does when the
+ *  index is outside of the table, as YY_IN_ACTTAB() checks. A state
+ *  without actions has the offset YY_SHIFT_USE_DFLT, the end of the
+ *  entries. With --pad, the tables are padded, so the index is within
+ *  them for every X up to YYNOCODE and nothing is checked.
  *
  *  The formula above is for computing the action when the lookahead
  *  is a terminal symbol. If the lookahead is a non-terminal (as occurs
@@ -113,9 +165,22 @@
  *    yy_reduce_ofst[]  For each state, the offset into yy_action for
  *                      shifting non-terminals after a reduce.
  *    yy_default[]      Default action for each state.
+ *    yy_token_class[]  The class of every symbol. Non-terminals are
+ *                      their own class. It is omitted, and
+ *                      YY_TOKEN_CLASS(s) is s, if every terminal is too.
+ *
+ *  With YY_ACTTAB_INTERLEAVED, yy_action[] and yy_lookahead[] are
+ *  replaced by yy_acttab[], a single table of {lookahead, action}
+ *  pairs, so that a lookup loads one entry instead of two.
+ *
+ *  With YY_TABLES_PACKED, every table is a string literal of
+ *  little-endian values, named with a "_packed" suffix.
+ *
+ *  The tables are read through the macros YY_ACTION(), YY_LOOKAHEAD(),
+ *  YY_SHIFT_OFST(), YY_REDUCE_OFST(), YY_DEFAULT() and YY_TOKEN_CLASS(),
+ *  which hide how they are stored.
  */
 %%
-#define YY_SZ_ACTTAB (sizeof(yy_action) / sizeof(yy_action[0]))
 
 /* The next table maps tokens into fallback tokens. If a construct
  * like the following:
@@ -133,34 +198,56 @@ static const YYCODETYPE yyFallback[] = {
 };
 #endif /* YYFALLBACK */
 
-/* The following structure represents a single element of the
- * parser's stack. Information stored includes:
+/* The next tables recognize the spellings of the tokens given by
  *
- *    + The state number for the parser at this level of the stack.
+ *      %keyword IF "if" ELSE "else".
  *
- *    + The value of the token stored at this level of the stack.
- *      (In other words, the "major" token)
+ * The spellings are stored once in yy_keyword_pool[], and a spelling
+ * within another is not repeated. Every keyword has its own slot in
+ * yy_keyword[], found by a perfect hash of its spelling: the high bits
+ * of the hash pick a bucket, and the hash displaced by the entry of the
+ * bucket in yy_keyword_disp[] is the slot.
  *
- *    + The semantic value stored at this level of the stack. This is
- *      the information used by the action routines in the grammar.
- *      It is sometime called the "minor" token.
+ *    YYNKEYWORD          is the number of keywords. If not defined,
+ *                        there are no tables and no ParseKeyword().
+ *    YYKEYWORDTYPE       holds offsets and lengths of the spellings.
+ *    YYKEYWORDSEED       is the initial value of the hash.
+ *    YYNKEYWORDBUCKET    is the number of buckets.
+ *    YYKEYWORDMASK       is the number of slots less one.
  */
-typedef struct {
-  int state_no;       /* The state number */
-  int major;          /* The major token value. This is the code
-                         number for the token at this stack level */
-  YYMINORTYPE minor;  /* The user-supplied minor token value. This
-                         is the value of the token */
-} yyStackEntry;
+#ifdef YYNKEYWORD
+#include <string.h>
+
+typedef struct yyKeyword {
+  YYKEYWORDTYPE offset; /* Offset of the spelling in yy_keyword_pool[] */
+  YYKEYWORDTYPE len;    /* Length of the spelling, 0 for an empty slot */
+  YYCODETYPE code;      /* The token */
+} yyKeyword;
+%%
 
-/* The state of the parser is completely contained in an instance of
- * the following structure */
-typedef struct {
-  int yyidx;                  /* Index of top element in stack */
-  int yyerrcnt;               /* Shifts left before out of the error */
-  ParseARG_SDECL              /* A place to hold %extra_argument */
-  yyStackEntry yystack[YYSTACKDEPTH]; /* The parser's stack */
-} yyParser;
+/*
+ * Return the token spelled by the "n" bytes at "z", as numbered in the
+ * header, or 0 if they do not spell a keyword.
+ */
+int ParseKeyword(const char *z, int n) {
+  unsigned h = YYKEYWORDSEED;
+  const yyKeyword *kw;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    h = (h ^ (unsigned char)z[i]) * 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  kw = &yy_keyword[(h ^ yy_keyword_disp[(h >> 16) % YYNKEYWORDBUCKET]) &
+                   YYKEYWORDMASK];
+  if (kw->len == n && memcmp(yy_keyword_pool + kw->offset, z, n) == 0) {
+    return kw->code;
+  }
+  return 0;
+}
+#endif /* YYNKEYWORD */
 
 #ifndef NDEBUG
 static FILE *yyTraceFILE = NULL;
@@ -240,7 +327,7 @@ void *ParseAlloc(void *(alloc)(size_t)) {
  * "yymajor" is the symbol code, and "yyminor" is a pointer to
  * the value.
  */
-static void yy_destructor(YYCODETYPE yymajor, YYMINORTYPE *yypminor) {
+YY_LINKAGE void yy_destructor(YYCODETYPE yymajor, YYMINORTYPE *yypminor) {
   switch (yymajor) {
     /* Here is inserted the actions which take place when a
      * terminal or non-terminal is destroyed. This can happen
@@ -308,23 +395,16 @@ void ParseFree(void *p, void (free_proc)(void*)) {
 /*
  * Find the appropriate action for a parser given the terminal
  * lookahead token lookahead.
- *
- * If the lookahead token is YYNOCODE, then check to see if the
- * action is independent of the lookahead. If it is, return the
- * action, otherwise return YY_NO_ACTION.
  */
 static int yy_find_shift_action(yyParser *pParser, int lookahead) {
   int state_no = pParser->yystack[pParser->yyidx].state_no;
-  int i = yy_shift_ofst[state_no];
-  if (i == YY_SHIFT_USE_DFLT) {
-    return yy_default[state_no];
+  int token_class = YY_TOKEN_CLASS(lookahead);
+  long i = YY_SHIFT_OFST(state_no) + token_class;
+  if (YY_IN_ACTTAB(i) && YY_LOOKAHEAD(i) == token_class) {
+    return YY_ACTION(i);
   }
-  if (lookahead == YYNOCODE) {
-    return YY_NO_ACTION;
-  }
-  i += lookahead;
-  if (i < 0 || i >= YY_SZ_ACTTAB || yy_lookahead[i] != lookahead) {
 #ifdef YYFALLBACK
+  {
     int fallback;
     if (lookahead < sizeof(yyFallback) / sizeof(yyFallback[0]) &&
         (fallback = yyFallback[lookahead]) != 0) {
@@ -336,37 +416,42 @@ static int yy_find_shift_action(yyParser *pParser, int lookahead) {
 #endif
       return yy_find_shift_action(pParser, fallback);
     }
-#endif
-    return yy_default[state_no];
-  } else {
-    return yy_action[i];
   }
+#endif
+  return YY_DEFAULT(state_no);
 }
 
 /*
  * Find the appropriate action for a parser given the non-terminal
  * lookahead token lookahead.
- *
- * If the lookahead token is YYNOCODE, then check to see if the
- * action is independent of the lookahead. If it is, return the
- * action, otherwise return YY_NO_ACTION.
  */
 static int yy_find_reduce_action(yyParser *pParser, int lookahead) {
   int state_no = pParser->yystack[pParser->yyidx].state_no;
-  int i = yy_reduce_ofst[state_no];
-
-  if (i == YY_REDUCE_USE_DFLT) {
-    return yy_default[state_no];
+  long i = YY_REDUCE_OFST(state_no) + lookahead;
+  if (YY_IN_ACTTAB(i) && YY_LOOKAHEAD(i) == lookahead) {
+    return YY_ACTION(i);
   }
-  if (lookahead == YYNOCODE) {
-    return YY_NO_ACTION;
+  return YY_DEFAULT(state_no);
+}
+
+/*
+ * The following code executes when the parser stack overflows.
+ */
+YY_COLD static void yy_stack_overflow(yyParser *yypParser) {
+  ParseARG_FETCH;
+  yypParser->yyidx--;
+#ifndef NDEBUG
+  if (yyTraceFILE != NULL) {
+    fprintf(yyTraceFILE, "%sStack Overflow!\n", yyTracePrompt);
   }
-  i += lookahead;
-  if (i < 0 || i >= YY_SZ_ACTTAB || yy_lookahead[i] != lookahead) {
-    return yy_default[state_no];
-  } else {
-    return yy_action[i];
+#endif
+  while (yypParser->yyidx >= 0) {
+    yy_pop_parser_stack(yypParser);
   }
+  /* Here code is inserted which will execute if the parser
+   * stack every overflows */
+%%
+  ParseARG_STORE; /* Suppress warning about unused %extra_argument var */
 }
 
 /*
@@ -377,20 +462,7 @@ static void yy_shift(yyParser *yypParser, int new_state, int major,
   yyStackEntry *yytos;
   yypParser->yyidx++;
   if (yypParser->yyidx >= YYSTACKDEPTH) {
-    ParseARG_FETCH;
-    yypParser->yyidx--;
-#ifndef NDEBUG
-    if (yyTraceFILE != NULL) {
-      fprintf(yyTraceFILE, "%sStack Overflow!\n", yyTracePrompt);
-    }
-#endif
-    while (yypParser->yyidx >= 0) {
-      yy_pop_parser_stack(yypParser);
-    }
-    /* Here code is inserted which will execute if the parser\
-     * stack every overflows */
-%%
-    ParseARG_STORE; /* Suppress warning about unused %extra_argument var */
+    yy_stack_overflow(yypParser);
     return;
   }
 
@@ -417,11 +489,17 @@ static void yy_shift(yyParser *yypParser, int new_state, int major,
  */
 static struct {
   YYCODETYPE lhs;       /* Symbol on the left-hand side of the rule */
-  unsigned char nrhs;   /* Number of right-hand side symbols in the rule */
+  YYNRHSTYPE nrhs;      /* Number of right-hand side symbols in the rule */
 } yyRuleInfo[] = {
 %%
 };
 
+/*
+ * The actions of the rules of the non-terminals marked %cold or %hot
+ * are functions of their own, laid out apart from the others.
+ */
+%%
+
 static void yy_accept(yyParser*);  /* Forward declaration */
 
 /*
@@ -461,6 +539,7 @@ static void yy_reduce(yyParser *yypParser, int yyruleno) {
    */
 %%
   }
+  ParseARG_STORE; /* Suppress warning about unused %extra_argument var */
   yygoto = yyRuleInfo[yyruleno].lhs;
   yysize = yyRuleInfo[yyruleno].nrhs;
   yypParser->yyidx -= yysize;
@@ -475,7 +554,7 @@ static void yy_reduce(yyParser *yypParser, int yyruleno) {
 /*
  * The following code executes when the parse fails.
  */
-static void yy_parse_failed(yyParser *yypParser) {
+YY_COLD static void yy_parse_failed(yyParser *yypParser) {
   ParseARG_FETCH;
 #ifndef NDEBUG
   if (yyTraceFILE != NULL) {
@@ -496,7 +575,7 @@ static void yy_parse_failed(yyParser *yypParser) {
 /*
  * The following code executes when a syntax error first occurs.
  */
-static void yy_syntax_error(yyParser *yypParser, int yymajor,
+YY_COLD static void yy_syntax_error(yyParser *yypParser, int yymajor,
     YYMINORTYPE yyminor) {
   ParseARG_FETCH;
 #define TOKEN (yyminor.yy0)
@@ -525,6 +604,98 @@ static void yy_accept(yyParser *yypParser) {
   ParseARG_STORE; /* Suppress warning about unused %extra_argument var */
 }
 
+/*
+ * The following code executes on a syntax error, and returns the token
+ * to try again, or YYNOCODE to go on with the next one.
+ *
+ *    + yyminorp points to the value of the token yymajor.
+ *    + yyendofinput is true if yymajor is the end of the input.
+ *    + yyerrorhit is set once the token has caused an error.
+ */
+YY_COLD static int yy_error_action(yyParser *yypParser, int yymajor,
+    YYMINORTYPE *yyminorp, int yyendofinput, int *yyerrorhit) {
+  int yyact;
+  int yymx;
+#ifndef NDEBUG
+  if (yyTraceFILE != NULL) {
+    fprintf(yyTraceFILE, "%sSyntax Error!\n", yyTracePrompt);
+  }
+#endif
+#ifdef YYERRORSYMBOL
+  /*
+   * A syntax error has occurred.
+   * The response to an error depends upon whether the
+   * grammar defines an error token "ERROR".
+   *
+   * THis is what we do if the grammar does define ERROR:
+   *
+   *    * Call the %syntax_error function.
+   *
+   *    * Begin popping the stack until we enter a state where
+   *      it is legal to shift the error symbol, then shift
+   *      the error symbol.
+   *
+   *    * Set the error count to three.
+   *
+   *    * Begin accepting and shifting new tokens. No new error
+   *      processing will occur until these tokens have been
+   *      shifted successfully.
+   */
+  if (yypParser->yyerrcnt < 0) {
+    yy_syntax_error(yypParser, yymajor, *yyminorp);
+  }
+  yymx = yypParser->yystack[yypParser->yyidx].major;
+  if (yymx == YYERRORSYMBOL || *yyerrorhit) {
+#ifndef NDEBUG
+    if (yyTraceFILE != NULL) {
+      fprintf(yyTraceFILE, "%s Discard input token %s\n",
+          yyTracePrompt, yyTokenName[yymajor]);
+    }
+#endif /* NDEBUG */
+    yy_destructor(yymajor, yyminorp);
+    yymajor = YYNOCODE;
+  } else {
+    while (yypParser->yyidx >= 0 && yymx != YYERRORSYMBOL &&
+        (yyact = yy_find_shift_action(yypParser, YYERRORSYMBOL)) >=
+        YYNSTATE) {
+      yy_pop_parser_stack(yypParser);
+    }
+    if (yypParser->yyidx < 0 || yymajor == 0) {
+      yy_destructor(yymajor, yyminorp);
+      yy_parse_failed(yypParser);
+      yymajor = YYNOCODE;
+    } else if (yymx != YYERRORSYMBOL) {
+      YYMINORTYPE u2;
+      u2.YYERRSYMDT = 0;
+      yy_shift(yypParser, yyact, YYERRORSYMBOL, &u2);
+    }
+  }
+  yypParser->yyerrcnt = 3;
+  *yyerrorhit = 1;
+#else /* YYERRORSYMBOL is not defined */
+  /*
+   * This is what we do if the grammar does not define ERROR.
+   *
+   *    * Report an error message, and throw away the input token.
+   *
+   *    * If the input token is $, then fail the parse.
+   *
+   * As before, subsequent error message are suppressed until
+   * three input tokens have been successfully shifted.
+   */
+  if (yypParser->yyerrcnt <= 0) {
+    yy_syntax_error(yypParser, yymajor, *yyminorp);
+  }
+  yypParser->yyerrcnt = 3;
+  yy_destructor(yymajor, yyminorp);
+  if (yyendofinput) {
+    yy_parse_failed(yypParser);
+  }
+  yymajor = YYNOCODE;
+#endif /* YYERRORSYMBOL */
+  return yymajor;
+}
+
 /*
  * The main parser program.
  *
@@ -577,84 +748,8 @@ void Parse(void *yyp, int yymajor, ParseTOKENTYPE yyminor ParseARG_PDECL) {
     } else if (yyact < YYNSTATE + YYNRULE) {
       yy_reduce(yypParser, yyact - YYNSTATE);
     } else if (yyact == YY_ERROR_ACTION) {
-      int yymx;
-#ifndef NDEBUG
-      if (yyTraceFILE != NULL) {
-        fprintf(yyTraceFILE, "%sSyntax Error!\n", yyTracePrompt);
-      }
-#endif
-#ifdef YYERRORSYMBOL
-      /*
-       * A syntax error has occurred.
-       * The response to an error depends upon whether the
-       * grammar defines an error token "ERROR".
-       *
-       * THis is what we do if the grammar does define ERROR:
-       *
-       *    * Call the %syntax_error function.
-       *
-       *    * Begin popping the stack until we enter a state where
-       *      it is legal to shift the error symbol, then shift
-       *      the error symbol.
-       *
-       *    * Set the error count to three.
-       *
-       *    * Begin accepting and shifting new tokens. No new error
-       *      processing will occur until these tokens have been
-       *      shifted successfully.
-       */
-      if (yypParser->yyerrcnt < 0) {
-        yy_syntax_error(yypParser, yymajor, minor);
-      }
-      yymx = yypParser->yystack[yypParser->yyidx].major;
-      if (yymx == YYERRORSYMBOL || yyerrorhit) {
-#ifndef NDEBUG
-        if (yyTraceFILE != NULL) {
-          fprintf(yyTraceFILE, "%s Discard input token %s\n",
-              yyTracePrompt, yyTokenName[yymajor]);
-        }
-#endif /* NDEBUG */
-        yy_destructor(yymajor, &minor);
-        yymajor = YYNOCODE;
-      } else {
-        while (yypParser->yyidx >= 0 && yymx != YYERRORSYMBOL &&
-            (yyact = yy_find_shift_action(yypParser, YYERRORSYMBOL)) >=
-            YYNSTATE) {
-          yy_pop_parser_stack(yypParser);
-        }
-        if (yypParser->yyidx < 0 || yymajor == 0) {
-          yy_destructor(yymajor, &minor);
-          yy_parse_failed(yypParser);
-          yymajor = YYNOCODE;
-        } else if (yymx != YYERRORSYMBOL) {
-          YYMINORTYPE u2;
-          u2.YYERRSYMDT = 0;
-          yy_shift(yypParser, yyact, YYERRORSYMBOL, &u2);
-        }
-      }
-      yypParser->yyerrcnt = 3;
-      yyerrorhit = 1;
-#else /* YYERRORSYMBOL is not defined */
-      /*
-       * This is what we do if the grammar does not define ERROR.
-       *
-       *    * Report an error message, and throw away the input token.
-       *
-       *    * If the input token is $, then fail the parse.
-       *
-       * As before, subsequent error message are suppressed until
-       * three input tokens have been successfully shifted.
-       */
-      if (yypParser->yyerrcnt <= 0) {
-        yy_syntax_error(yypParser, yymajor, minor);
-      }
-      yypParser->yyerrcnt = 3;
-      yy_destructor(yymajor, &yyminor);
-      if (yyendofinput) {
-        yy_parse_failed(yypParser);
-      }
-      yymajor = YYNOCODE;
-#endif /* YYERRORSYMBOL */
+      yymajor = yy_error_action(yypParser, yymajor, &minor, yyendofinput,
+                                &yyerrorhit);
     } else {
       yy_accept(yypParser);
       yymajor = YYNOCODE;
@@ -662,3 +757,75 @@ void Parse(void *yyp, int yymajor, ParseTOKENTYPE yyminor ParseARG_PDECL) {
   } while (yymajor != YYNOCODE && yypParser->yyidx >= 0);
 }
 
+/* The next tables drive the scanner of the patterns given by
+ *
+ *      %token_regex NUM "[0-9]+" ID "[a-z]+".
+ *      %skip_regex "[ \t\n]+".
+ *
+ * The scanner is a minimal DFA over classes of bytes: the byte c leads
+ * from state S to yy_lex_next[S * YYNLEXCLASS + yy_lex_class[c]]. State
+ * 0 is the dead state and state 1 the start. yy_lex_accept[S] is the
+ * token matched when the DFA is in state S, 0 if none, and YYNOCODE if
+ * the match is skipped.
+ *
+ *    YYNLEXSTATE         is the number of states. If not defined, there
+ *                        are no tables and no ParseScan().
+ *    YYNLEXCLASS         is the number of classes of bytes.
+ *    YYLEXSTATETYPE      is the type of the states.
+ *    YYLEXEME(m, z, n)   sets the minor token "m" to the "n" bytes at
+ *                        "z". By default, it sets the members "z" and
+ *                        "n", as in the ParseLexeme used when there is
+ *                        no %token_type.
+ */
+#ifdef YYNLEXSTATE
+#ifndef YYLEXEME
+#define YYLEXEME(m, yyz, yyn) ((m).z = (yyz), (m).n = (yyn))
+#endif
+%%
+
+/*
+ * Split the "n" bytes at "z" into tokens and give them to Parse(),
+ * then end the input. A token is the longest match of the patterns,
+ * the first declared if several match as long, and its minor token
+ * points into "z". A token spelling a %keyword is given the keyword.
+ * Return n, or the offset of the first byte no pattern matches, in
+ * which case the input is not ended.
+ */
+int ParseScan(void *yyp, const char *z, int n ParseARG_PDECL) {
+  ParseTOKENTYPE yyminor;
+  int i, j, yystate, yymajor, yyend;
+
+  for (i = 0; i < n; i = yyend) {
+    yystate = 1;
+    yymajor = 0;
+    yyend = i;
+    for (j = i; j < n; j++) {
+      yystate = yy_lex_next[yystate * YYNLEXCLASS +
+                            yy_lex_class[(unsigned char)z[j]]];
+      if (yystate == 0) {
+        break;
+      }
+      if (yy_lex_accept[yystate] != 0) {
+        yymajor = yy_lex_accept[yystate];
+        yyend = j + 1;
+      }
+    }
+    if (yymajor == 0) {
+      return i;
+    }
+    if (yymajor == YYNOCODE) {
+      continue;
+    }
+#ifdef YYNKEYWORD
+    if ((j = ParseKeyword(z + i, yyend - i)) != 0) {
+      yymajor = j;
+    }
+#endif
+    YYLEXEME(yyminor, z + i, yyend - i);
+    Parse(yyp, yymajor, yyminor ParseARG_PARAM);
+  }
+  YYLEXEME(yyminor, z + n, 0);
+  Parse(yyp, 0, yyminor ParseARG_PARAM);
+  return n;
+}
+#endif /* YYNLEXSTATE */
@@ -0,0 +1,798 @@
+/*
+ * C++17 driver template for the MELON parser generator, used with the
+ * --cxx switch. The author disclaims copyright to this source code.
+ *
+ * The parser is a header of its own, which may be included by several
+ * files. It defines the class template
+ *
+ *      template <typename TokenT, typename ContextT> class ParseParser;
+ *
+ * whose tables are constexpr members and whose actions are member code,
+ * so that the compiler sees the whole parser where it is used. TokenT
+ * is the type of the minor tokens, %token_type by default, and ContextT
+ * the type of the %extra_argument, which the parser keeps under the
+ * name it is declared with. The tokens are the enumerators nested in
+ * the struct ParseToken, so that several parsers can be included in
+ * one file.
+ *
+ * The values of the symbols may be of any C++ type which can be default
+ * constructed and moved, such as std::string or std::unique_ptr. They
+ * live in the stack of the parser, without an allocation of their own.
+ * The value of the left-hand side is constructed before the action, in
+ * which the values of the right-hand side may be moved from, as in
+ * "A = std::move(B);". They are all destroyed after it. The code of
+ * %destructor runs as in C, before the value itself is destroyed.
+ *
+ *      CalcParser<> parser(&state);
+ *      parser.parse(CalcToken::NUM, value);
+ *      parser.parse(0, value);    // End of the input
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+/* First off, code is include which follows the "include" declaration
+ * in the input file.
+ */
+%%
+
+/*
+ * These constants (all generated automatically by the parser generator)
+ * specify the various kinds of tokens (terminals) that the parser
+ * understands.
+ */
+struct ParseToken {
+  enum : int {
+%%
+  };
+};
+
+/*
+ * The next thing included is series of defines which control
+ * various aspects of the generated parser.
+ *    YYCODETYPE          is the data type used for storing terminal
+ *                        and nonterminal numbers.
+ *    YYNOCODE            is a number of type YYCODETYPE which corresponds
+ *                        to no legal terminal or nonterminal number.
+ *    YYFALLBACK          If defined, this indicates that one or more tokens
+ *                        have fall-back values which should be used if the
+ *                        original value of the token will not parse.
+ *    YYACTIONTYPE        is the data type used for storing the actions.
+ *    YYNRHSTYPE          is the smallest unsigned type able to hold the
+ *                        number of right-hand side symbols of the longest
+ *                        rule in the grammar.
+ *    ParseTOKENTYPE      is the default type of the minor tokens.
+ *    ParseMinor          is the union of the types of all minor values,
+ *                        of which the minor tokens are "yy0". It holds
+ *                        a value of the symbol given to yy_construct()
+ *                        or yy_move(), until yy_destroy().
+ *    YYSTACKDEPTH        is the maximum depth of the parser's stack.
+ *    ParseARG_TYPE       is the default type of the %extra_argument.
+ *    ParseARG_NAME       is the name of the %extra_argument.
+ *    YYNSTATE            the combined number of states.
+ *    YYNRULE             the number of rules in the grammar.
+ *    YYERRORSYMBOL       is the code number of the error symbol. If not
+ *                        defined, then to no error processing.
+ */
+%%
+#define YY_NO_ACTION      (YYNSTATE + YYNRULE + 2)
+#define YY_ACCEPT_ACTION  (YYNSTATE + YYNRULE + 1)
+#define YY_ERROR_ACTION   (YYNSTATE + YYNRULE)
+
+/* The code run rarely, like the error handling and the actions of the
+ * rules marked %cold, is moved out of the way of the common paths */
+#if defined(__GNUC__)
+#define YY_COLD [[gnu::cold, gnu::noinline]]
+#define YY_HOT [[gnu::hot]]
+#else
+#define YY_COLD
+#define YY_HOT
+#endif
+
+/* Without %extra_argument, the context of the parser is unused */
+#ifndef ParseARG_NAME
+#define ParseARG_TYPE std::nullptr_t
+#define ParseARG_NAME yycontext
+#endif
+#define ParseARG_FETCH \
+  ContextT &ParseARG_NAME = yypParser->ParseARG_NAME; \
+  (void)ParseARG_NAME
+
+template <typename TokenT = ParseTOKENTYPE,
+          typename ContextT = ParseARG_TYPE>
+class ParseParser {
+ public:
+  /*
+   * Create a parser, which keeps "context" as the %extra_argument of
+   * its actions.
+   */
+  explicit ParseParser(ContextT context = ContextT())
+      : yyidx(-1), yyerrcnt(-1), ParseARG_NAME(context) {}
+
+  /*
+   * Destroy the parser. Destructors are all called for all stack
+   * elements.
+   */
+  ~ParseParser() {
+    while (yyidx >= 0) {
+      yy_pop_parser_stack(this);
+    }
+  }
+
+  ParseParser(const ParseParser &) = delete;
+  ParseParser &operator=(const ParseParser &) = delete;
+
+  /* The %extra_argument given to the actions */
+  ContextT &context() { return ParseARG_NAME; }
+
+ private:
+  typedef ParseParser yyParser;
+  typedef ParseMinor<TokenT> YYMINORTYPE;
+
+  /* The following structure represents a single element of the
+   * parser's stack. Information stored includes:
+   *
+   *    + The state number for the parser at this level of the stack.
+   *
+   *    + The value of the token stored at this level of the stack.
+   *      (In other words, the "major" token)
+   *
+   *    + The semantic value stored at this level of the stack. This is
+   *      the information used by the action routines in the grammar.
+   *      It is sometime called the "minor" token.
+   */
+  struct yyStackEntry {
+    int state_no;       /* The state number */
+    int major;          /* The major token value. This is the code
+                           number for the token at this stack level */
+    YYMINORTYPE minor;  /* The user-supplied minor token value. This
+                           is the value of the token */
+  };
+
+  /*
+   * Destroys a value which is not on the stack when it goes out of
+   * scope, so that it is not leaked when an action throws.
+   */
+  struct yyMinorGuard {
+    YYMINORTYPE *minor; /* The value */
+    int major;          /* The symbol whose type the value has */
+    ~yyMinorGuard() { minor->yy_destroy(major); }
+  };
+
+  int yyidx;                  /* Index of top element in stack */
+  int yyerrcnt;               /* Shifts left before out of the error */
+  ContextT ParseARG_NAME;     /* The %extra_argument */
+  yyStackEntry yystack[YYSTACKDEPTH]; /* The parser's stack */
+
+  /*
+   * Next are that tables used to determine what action to take based on
+   * the current state and lookahead token, as in the C template. They
+   * are constexpr members, read through the macros YY_ACTION(),
+   * YY_LOOKAHEAD(), YY_SHIFT_OFST(), YY_REDUCE_OFST(), YY_DEFAULT() and
+   * YY_TOKEN_CLASS().
+   */
+%%
+
+  /* The next table maps tokens into fallback tokens, given by
+   *
+   *      %fallback ID X Y Z.
+   */
+#ifdef YYFALLBACK
+  static constexpr YYCODETYPE yyFallback[] = {
+%%
+  };
+#endif /* YYFALLBACK */
+
+  /* The next tables recognize the spellings of the tokens given by
+   *
+   *      %keyword IF "if" ELSE "else".
+   *
+   * with a perfect hash, as in the C template.
+   */
+#ifdef YYNKEYWORD
+  struct yyKeyword {
+    YYKEYWORDTYPE offset; /* Offset of the spelling in yy_keyword_pool[] */
+    YYKEYWORDTYPE len;    /* Length of the spelling, 0 for an empty slot */
+    YYCODETYPE code;      /* The token */
+  };
+%%
+
+ public:
+  /*
+   * Return the token spelled by the "n" bytes at "z", or 0 if they do
+   * not spell a keyword.
+   */
+  static int keyword(const char *z, int n) {
+    unsigned h = YYKEYWORDSEED;
+    const yyKeyword *kw;
+    int i;
+
+    for (i = 0; i < n; i++) {
+      h = (h ^ (unsigned char)z[i]) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    kw = &yy_keyword[(h ^ yy_keyword_disp[(h >> 16) % YYNKEYWORDBUCKET]) &
+                     YYKEYWORDMASK];
+    if (kw->len == n && std::memcmp(yy_keyword_pool + kw->offset, z, n) == 0) {
+      return kw->code;
+    }
+    return 0;
+  }
+
+ private:
+#endif /* YYNKEYWORD */
+
+#ifndef NDEBUG
+  inline static FILE *yyTraceFILE = nullptr;
+  inline static const char *yyTracePrompt = nullptr;
+
+  /* For tracing shifts, the names of all terminals and nonterminals
+   * are required. The following table supplies these names
+   */
+  static constexpr const char *yyTokenName[] = {
+%%
+  };
+
+  /*
+   * For tracing reduce actions, the names of all rules are required.
+   */
+  static constexpr const char *yyRuleName[] = {
+%%
+  };
+
+ public:
+  /* Turn parser tracing on by giving a stream to which to write the trace
+   * and a prompt to preface each trace message. Tracing is turned off
+   * by making either argument NULL. Tracing is shared by the parsers
+   * of the same class.
+   */
+  static void trace(FILE *file, const char *prompt) {
+    yyTraceFILE = file;
+    yyTracePrompt = prompt;
+    if (yyTraceFILE == nullptr) {
+      yyTracePrompt = nullptr;
+    } else if (yyTracePrompt == nullptr) {
+      yyTraceFILE = nullptr;
+    }
+  }
+#endif /* NDEBUG */
+
+ public:
+  /*
+   * This function returns the symbolic name associated with a token
+   * value.
+   */
+  static const char *token_name(int token_type) {
+#ifndef NDEBUG
+    if (token_type > 0 &&
+        token_type < (int)(sizeof(yyTokenName) / sizeof(yyTokenName[0]))) {
+      return yyTokenName[token_type];
+    } else {
+      return "Unknown";
+    }
+#else
+    (void)token_type;
+    return "";
+#endif
+  }
+
+ private:
+  /*
+   * The following function deletes the value associated with a
+   * symbol. The symbol can be either a terminal or nonterminal.
+   * "yymajor" is the symbol code, and "yyminor" is a pointer to
+   * the value.
+   */
+  static void yy_destructor(YYCODETYPE yymajor, YYMINORTYPE *yypminor) {
+    (void)yypminor;
+    switch (yymajor) {
+      /* Here is inserted the actions which take place when a
+       * terminal or non-terminal is destroyed. This can happen
+       * when the symbol is popped from the stack during a
+       * reduce or during error processing or when a parser is
+       * being destroyed before it is finished parsing.
+       *
+       * Note: during a reduce, the only symbols destroyed are those
+       * which appear on the RHS of the rule, but which are not used
+       * inside the C code.
+       */
+%%
+      default:
+        break; /* If no destructor action specified: do nothing */
+    }
+  }
+
+  /*
+   * Pop the parser's stack once.
+   *
+   * If there is a destructor routine associated with the token which
+   * is popped from the stack, then call it.
+   *
+   * Return the major token number for the symbol popped.
+   */
+  static int yy_pop_parser_stack(yyParser *pParser) {
+    YYCODETYPE yymajor;
+    yyStackEntry *yytos;
+
+    if (pParser->yyidx < 0) {
+      return 0;
+    }
+    yytos = &pParser->yystack[pParser->yyidx];
+#ifndef NDEBUG
+    if (yyTraceFILE != nullptr) {
+      std::fprintf(yyTraceFILE, "%sPopping %s\n",
+          yyTracePrompt,
+          yyTokenName[yytos->major]);
+    }
+#endif
+    yymajor = yytos->major;
+    yy_destructor(yymajor, &yytos->minor);
+    yytos->minor.yy_destroy(yymajor);
+    pParser->yyidx--;
+    return yymajor;
+  }
+
+  /*
+   * Find the appropriate action for a parser given the terminal
+   * lookahead token lookahead.
+   */
+  static int yy_find_shift_action(yyParser *pParser, int lookahead) {
+    int state_no = pParser->yystack[pParser->yyidx].state_no;
+    int token_class = YY_TOKEN_CLASS(lookahead);
+    long i = YY_SHIFT_OFST(state_no) + token_class;
+    if (YY_IN_ACTTAB(i) && YY_LOOKAHEAD(i) == token_class) {
+      return YY_ACTION(i);
+    }
+#ifdef YYFALLBACK
+    {
+      int fallback;
+      if (lookahead < (int)(sizeof(yyFallback) / sizeof(yyFallback[0])) &&
+          (fallback = yyFallback[lookahead]) != 0) {
+#ifndef NDEBUG
+        if (yyTraceFILE != nullptr) {
+          std::fprintf(yyTraceFILE, "%sFALLBACK %s => %s\n",
+              yyTracePrompt, yyTokenName[lookahead], yyTokenName[fallback]);
+        }
+#endif
+        return yy_find_shift_action(pParser, fallback);
+      }
+    }
+#endif
+    return YY_DEFAULT(state_no);
+  }
+
+  /*
+   * Find the appropriate action for a parser given the non-terminal
+   * lookahead token lookahead.
+   */
+  static int yy_find_reduce_action(yyParser *pParser, int lookahead) {
+    int state_no = pParser->yystack[pParser->yyidx].state_no;
+    long i = YY_REDUCE_OFST(state_no) + lookahead;
+    if (YY_IN_ACTTAB(i) && YY_LOOKAHEAD(i) == lookahead) {
+      return YY_ACTION(i);
+    }
+    return YY_DEFAULT(state_no);
+  }
+
+  /*
+   * The following code executes when the parser stack overflows.
+   */
+  YY_COLD static void yy_stack_overflow(yyParser *yypParser) {
+    ParseARG_FETCH;
+    yypParser->yyidx--;
+#ifndef NDEBUG
+    if (yyTraceFILE != nullptr) {
+      std::fprintf(yyTraceFILE, "%sStack Overflow!\n", yyTracePrompt);
+    }
+#endif
+    while (yypParser->yyidx >= 0) {
+      yy_pop_parser_stack(yypParser);
+    }
+    /* Here code is inserted which will execute if the parser
+     * stack every overflows */
+%%
+  }
+
+  /*
+   * Preform a shift action.
+   */
+  static void yy_shift(yyParser *yypParser, int new_state, int major,
+                       YYMINORTYPE *minor) {
+    yyStackEntry *yytos;
+    yypParser->yyidx++;
+    if (yypParser->yyidx >= YYSTACKDEPTH) {
+      yy_stack_overflow(yypParser);
+      return;
+    }
+
+    yytos = &yypParser->yystack[yypParser->yyidx];
+    yytos->state_no = new_state;
+    yytos->major = major;
+    yytos->minor.yy_move(major, minor);
+#ifndef NDEBUG
+    if (yyTraceFILE != nullptr && yypParser->yyidx > 0) {
+      int i;
+      std::fprintf(yyTraceFILE, "%sShift %d\n", yyTracePrompt, new_state);
+      std::fprintf(yyTraceFILE, "%sStack:", yyTracePrompt);
+      for (i = 1; i <= yypParser->yyidx; i++) {
+        std::fprintf(yyTraceFILE, " %s",
+            yyTokenName[yypParser->yystack[i].major]);
+      }
+      std::fprintf(yyTraceFILE, "\n");
+    }
+#endif
+  }
+
+  /*
+   * The following table contains information about every rule that
+   * is used during the reduce.
+   */
+  struct yyRuleInfoEntry {
+    YYCODETYPE lhs;       /* Symbol on the left-hand side of the rule */
+    YYNRHSTYPE nrhs;      /* Number of right-hand side symbols in the rule */
+  };
+  static constexpr yyRuleInfoEntry yyRuleInfo[] = {
+%%
+  };
+
+  /*
+   * The actions of the rules of the non-terminals marked %cold or %hot
+   * are functions of their own, laid out apart from the others.
+   */
+%%
+
+  /*
+   * Perform a reduce action and the shift that must immediately
+   * follow the reduce.
+   *
+   *    + yypParser is the parser.
+   *    + yyruleno is the number of the rule by which to reduce.
+   */
+  static void yy_reduce(yyParser *yypParser, int yyruleno) {
+    int yygoto;               /* The next state */
+    int yyact;                /* The next action */
+    YYMINORTYPE yygotominor;  /* The LHS of the rule reduced */
+    yyStackEntry *yymsp;      /* The top of the parser's stack */
+    int yysize;               /* Amount to pop the stack */
+
+    ParseARG_FETCH;
+    yymsp = &yypParser->yystack[yypParser->yyidx];
+    yygoto = yyRuleInfo[yyruleno].lhs;
+    yygotominor.yy_construct(yygoto);
+    yyMinorGuard yyguard = {&yygotominor, yygoto};
+
+#ifndef NDEBUG
+    if (yyTraceFILE != nullptr &&
+        yyruleno < (int)(sizeof(yyRuleName) / sizeof(yyRuleName[0]))) {
+      std::fprintf(yyTraceFILE, "%sReduce [%s].\n",
+              yyTracePrompt, yyRuleName[yyruleno]);
+    }
+#endif /* NDEBUG */
+
+    switch (yyruleno) {
+    /* Beginning here are the reduction cases. A typical example
+     * follows:
+     *  case 0:
+     *  #line <lineno> <grammmarfile>
+     *    { ... }   // User supplied code
+     *  #line <lineno> <thisfile>
+     *  break;
+     *
+     */
+%%
+    }
+    yysize = yyRuleInfo[yyruleno].nrhs;
+    for (; yysize > 0; yysize--, yymsp--) {
+      yymsp->minor.yy_destroy(yymsp->major);
+    }
+    yypParser->yyidx -= yyRuleInfo[yyruleno].nrhs;
+    yyact = yy_find_reduce_action(yypParser, yygoto);
+    if (yyact < YYNSTATE) {
+      yy_shift(yypParser, yyact, yygoto, &yygotominor);
+    } else if (yyact == YYNSTATE + YYNRULE + 1) {
+      yy_accept(yypParser);
+    }
+  }
+
+  /*
+   * The following code executes when the parse fails.
+   */
+  YY_COLD static void yy_parse_failed(yyParser *yypParser) {
+    ParseARG_FETCH;
+#ifndef NDEBUG
+    if (yyTraceFILE != nullptr) {
+      std::fprintf(yyTraceFILE, "%sFail!\n", yyTracePrompt);
+    }
+#endif
+    while (yypParser->yyidx >= 0) {
+      yy_pop_parser_stack(yypParser);
+    }
+    /*
+     * Here code is inserted which be executed whenever the
+     * parser fails.
+     */
+%%
+  }
+
+  /*
+   * The following code executes when a syntax error first occurs.
+   */
+  YY_COLD static void yy_syntax_error(yyParser *yypParser, int yymajor,
+      YYMINORTYPE &yyminor) {
+    ParseARG_FETCH;
+    (void)yymajor;
+    (void)yyminor;
+#define TOKEN (yyminor.yy0)
+%%
+  }
+
+  /*
+   * The following code executes when the parser accepts.
+   */
+  static void yy_accept(yyParser *yypParser) {
+    ParseARG_FETCH;
+#ifndef NDEBUG
+    if (yyTraceFILE != nullptr) {
+      std::fprintf(yyTraceFILE, "%sAccept!\n", yyTracePrompt);
+    }
+#endif
+    while (yypParser->yyidx >= 0) {
+      yy_pop_parser_stack(yypParser);
+    }
+    /*
+     * Here code is inserted which will be executed whenever the parser
+     * accepts.
+     */
+%%
+  }
+
+  /*
+   * The following code executes on a syntax error, and returns the token
+   * to try again, or YYNOCODE to go on with the next one.
+   *
+   *    + yyminorp points to the value of the token yymajor.
+   *    + yyendofinput is true if yymajor is the end of the input.
+   *    + yyerrorhit is set once the token has caused an error.
+   */
+  YY_COLD static int yy_error_action(yyParser *yypParser, int yymajor,
+      YYMINORTYPE *yyminorp, int yyendofinput, int *yyerrorhit) {
+#ifndef NDEBUG
+    if (yyTraceFILE != nullptr) {
+      std::fprintf(yyTraceFILE, "%sSyntax Error!\n", yyTracePrompt);
+    }
+#endif
+#ifdef YYERRORSYMBOL
+    /*
+     * A syntax error has occurred, and the grammar defines an error
+     * token "ERROR": call the %syntax_error function, pop the stack
+     * until the error symbol can be shifted, and shift it. No new
+     * error processing occurs until three tokens have been shifted.
+     */
+    int yyact = 0;
+    int yymx;
+    (void)yyendofinput;
+    if (yypParser->yyerrcnt < 0) {
+      yy_syntax_error(yypParser, yymajor, *yyminorp);
+    }
+    yymx = yypParser->yystack[yypParser->yyidx].major;
+    if (yymx == YYERRORSYMBOL || *yyerrorhit) {
+#ifndef NDEBUG
+      if (yyTraceFILE != nullptr) {
+        std::fprintf(yyTraceFILE, "%s Discard input token %s\n",
+            yyTracePrompt, yyTokenName[yymajor]);
+      }
+#endif /* NDEBUG */
+      yy_destructor(yymajor, yyminorp);
+      yymajor = YYNOCODE;
+    } else {
+      while (yypParser->yyidx >= 0 && yymx != YYERRORSYMBOL &&
+          (yyact = yy_find_shift_action(yypParser, YYERRORSYMBOL)) >=
+          YYNSTATE) {
+        yy_pop_parser_stack(yypParser);
+      }
+      if (yypParser->yyidx < 0 || yymajor == 0) {
+        yy_destructor(yymajor, yyminorp);
+        yy_parse_failed(yypParser);
+        yymajor = YYNOCODE;
+      } else if (yymx != YYERRORSYMBOL) {
+        YYMINORTYPE u2;
+        u2.YYERRSYMDT = 0;
+        yy_shift(yypParser, yyact, YYERRORSYMBOL, &u2);
+      }
+    }
+    yypParser->yyerrcnt = 3;
+    *yyerrorhit = 1;
+#else /* YYERRORSYMBOL is not defined */
+    /*
+     * The grammar does not define ERROR: report an error message and
+     * throw away the input token, failing the parse if it is $. As
+     * before, subsequent error message are suppressed until three
+     * input tokens have been successfully shifted.
+     */
+    (void)yyerrorhit;
+    if (yypParser->yyerrcnt <= 0) {
+      yy_syntax_error(yypParser, yymajor, *yyminorp);
+    }
+    yypParser->yyerrcnt = 3;
+    yy_destructor(yymajor, yyminorp);
+    if (yyendofinput) {
+      yy_parse_failed(yypParser);
+    }
+    yymajor = YYNOCODE;
+#endif /* YYERRORSYMBOL */
+    return yymajor;
+  }
+
+ public:
+  /*
+   * The main parser program.
+   *
+   *    + The first argument is the major token number, 0 at the end
+   *      of the input.
+   *    + The second argument is the minor token.
+   */
+  void parse(int yymajor, TokenT yyminor) {
+    YYMINORTYPE minor;
+    int yyact;                /* The parser actions */
+    int yyendofinput;         /* True if we are at the end of input */
+    int yyerrorhit = 0;       /* Ture if yymajor has invoked an error */
+    yyParser *yypParser = this;
+
+    /* (re)initialize the parser, if necessary */
+    if (yypParser->yyidx < 0) {
+      if (yymajor == 0) {
+        return;
+      }
+      yypParser->yyidx = 0;
+      yypParser->yyerrcnt = -1;
+      yypParser->yystack[0].state_no = 0;
+      yypParser->yystack[0].major = 0;
+      yypParser->yystack[0].minor.yy_construct(0);
+    }
+    ::new (static_cast<void *>(&minor.yy0)) TokenT(std::move(yyminor));
+    yyMinorGuard yyguard = {&minor, 0};
+    yyendofinput = (yymajor == 0);
+
+#ifndef NDEBUG
+    if (yyTraceFILE != nullptr) {
+      std::fprintf(yyTraceFILE, "%sInput %s\n", yyTracePrompt,
+          yyTokenName[yymajor]);
+    }
+#endif
+
+    do {
+      yyact = yy_find_shift_action(yypParser, yymajor);
+      if (yyact < YYNSTATE) {
+        yy_shift(yypParser, yyact, yymajor, &minor);
+        yypParser->yyerrcnt--;
+        if (yyendofinput && yypParser->yyidx >= 0) {
+          yymajor = 0;
+        } else {
+          yymajor = YYNOCODE;
+        }
+      } else if (yyact < YYNSTATE + YYNRULE) {
+        yy_reduce(yypParser, yyact - YYNSTATE);
+      } else if (yyact == YY_ERROR_ACTION) {
+        yymajor = yy_error_action(yypParser, yymajor, &minor, yyendofinput,
+                                  &yyerrorhit);
+      } else {
+        yy_accept(yypParser);
+        yymajor = YYNOCODE;
+      }
+    } while (yymajor != YYNOCODE && yypParser->yyidx >= 0);
+  }
+
+  /* The next tables drive the scanner of the patterns given by
+   *
+   *      %token_regex NUM "[0-9]+" ID "[a-z]+".
+   *      %skip_regex "[ \t\n]+".
+   *
+   * as in the C template. YYLEXEME(m, z, n) sets the minor token "m" to
+   * the "n" bytes at "z", by default by setting its members "z" and "n"
+   * as in the ParseLexeme used when there is no %token_type.
+   */
+#ifdef YYNLEXSTATE
+#ifndef YYLEXEME
+#define YYLEXEME(m, yyz, yyn) ((m).z = (yyz), (m).n = (yyn))
+#endif
+ private:
+%%
+
+ public:
+  /*
+   * Split the "n" bytes at "z" into tokens and give them to parse(),
+   * then end the input. A token is the longest match of the patterns,
+   * the first declared if several match as long, and its minor token
+   * points into "z". A token spelling a %keyword is given the keyword.
+   * Return n, or the offset of the first byte no pattern matches, in
+   * which case the input is not ended.
+   */
+  int scan(const char *z, int n) {
+    TokenT yyminor;
+    int i, j, yystate, yymajor, yyend;
+
+    for (i = 0; i < n; i = yyend) {
+      yystate = 1;
+      yymajor = 0;
+      yyend = i;
+      for (j = i; j < n; j++) {
+        yystate = yy_lex_next[yystate * YYNLEXCLASS +
+                              yy_lex_class[(unsigned char)z[j]]];
+        if (yystate == 0) {
+          break;
+        }
+        if (yy_lex_accept[yystate] != 0) {
+          yymajor = yy_lex_accept[yystate];
+          yyend = j + 1;
+        }
+      }
+      if (yymajor == 0) {
+        return i;
+      }
+      if (yymajor == YYNOCODE) {
+        continue;
+      }
+#ifdef YYNKEYWORD
+      if ((j = keyword(z + i, yyend - i)) != 0) {
+        yymajor = j;
+      }
+#endif
+      YYLEXEME(yyminor, z + i, yyend - i);
+      parse(yymajor, yyminor);
+    }
+    YYLEXEME(yyminor, z + n, 0);
+    parse(0, yyminor);
+    return n;
+  }
+#endif /* YYNLEXSTATE */
+};
+
+/* The macros of the parser are its own, and another parser may be
+ * included next */
+#undef TOKEN
+#undef YYCODETYPE
+#undef YYNOCODE
+#undef YYACTIONTYPE
+#undef YYNRHSTYPE
+#undef YYSTACKDEPTH
+#undef YYNSTATE
+#undef YYNRULE
+#undef YYERRORSYMBOL
+#undef YYERRSYMDT
+#undef YYFALLBACK
+#undef YYNKEYWORD
+#undef YYKEYWORDTYPE
+#undef YYKEYWORDSEED
+#undef YYNKEYWORDBUCKET
+#undef YYKEYWORDMASK
+#undef YYNLEXSTATE
+#undef YYNLEXCLASS
+#undef YYLEXSTATETYPE
+#undef YY_TABLES_PACKED
+#undef YY_ACTTAB_INTERLEAVED
+#undef YY_ACTION
+#undef YY_LOOKAHEAD
+#undef YY_IN_ACTTAB
+#undef YY_TOKEN_CLASS
+#undef YY_SHIFT_USE_DFLT
+#undef YY_SHIFT_OFST
+#undef YY_REDUCE_USE_DFLT
+#undef YY_REDUCE_OFST
+#undef YY_DEFAULT
+#undef YY_NO_ACTION
+#undef YY_ACCEPT_ACTION
+#undef YY_ERROR_ACTION
+#undef YY_COLD
+#undef YY_HOT
+#undef YYLEXEME
+#undef ParseTOKENTYPE
+#undef ParseARG_TYPE
+#undef ParseARG_NAME
+#undef ParseARG_FETCH
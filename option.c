@@ -41,6 +41,24 @@ static void MlnErrLine(int n, int k, FILE *err) {
   }
 }
 
+/*
+ * Return non-zero if the n-th command line argument is an option with
+ * an argument given alone, as "-j" of "-j 4", whose argument is the
+ * next one.
+ */
+static int MlnArgIsNext(int n) {
+  int i;
+  if (opts == NULL || (argv[n][0] != '-' && argv[n][0] != '+')) {
+    return 0;
+  }
+  for (i = 0; opts[i].label; i++) {
+    if (strcmp(&argv[n][1], opts[i].label) == 0) {
+      return opts[i].type != MLN_OPT_FLAG && opts[i].type != MLN_OPT_FFLAG;
+    }
+  }
+  return 0;
+}
+
 /*
  * Print the index of the n-th non-switch argument. Return -1
  * if n is out of range.
@@ -50,6 +68,10 @@ static int MlnArgIndex(int n) {
   int dash_dash = 0;
   if (argv != NULL && argv[0] != NULL) {
     for (i = 1; argv[i] != NULL; i++) {
+      if (!dash_dash && MlnArgIsNext(i) && argv[i + 1] != NULL) {
+        i++; /* The argument of the option */
+        continue;
+      }
       if (dash_dash || !MLN_IS_OPT(argv[i])) {
         if (n == 0) {
           return i;
@@ -67,7 +89,83 @@ static int MlnArgIndex(int n) {
 static char emsg[] = "Command line syntax error: ";
 
 /*
- * Process a flag command line argument.
+ * Set the option "i", which has an argument, from the text "cp" of the
+ * n-th command line argument.
+ */
+static int MlnSetOption(int i, int n, char *cp, FILE *err) {
+  int err_cnt = 0;
+  int lv = 0;
+  double dv = 0;
+  char *sv = NULL, *end;
+
+  switch (opts[i].type) {
+  case MLN_OPT_FLAG:
+  case MLN_OPT_FFLAG:
+    if (err) {
+      fprintf(err, "%soption requires an argument.\n", emsg);
+      MlnErrLine(n, 0, err);
+    }
+    err_cnt++;
+    break;
+  case MLN_OPT_DBL:
+  case MLN_OPT_FDBL:
+    dv = strtod(cp, &end);
+    if (*end) {
+      if (err) {
+        fprintf(err, "%sillegal character in floating-point argument.\n",
+                emsg);
+        MlnErrLine(n, (int)(end - argv[n]), err);
+      }
+      err_cnt++;
+    }
+    break;
+  case MLN_OPT_INT:
+  case MLN_OPT_FINT:
+    lv = strtol(cp, &end, 0);
+    if (*end) {
+      if (err) {
+        fprintf(err, "%sillegal character in integer argument.\n", emsg);
+        MlnErrLine(n, (int)(end - argv[n]), err);
+      }
+      err_cnt++;
+    }
+    break;
+  case MLN_OPT_STR:
+  case MLN_OPT_FSTR:
+    sv = cp;
+    break;
+  }
+
+  switch (opts[i].type) {
+  case MLN_OPT_FLAG:
+  case MLN_OPT_FFLAG:
+    break;
+  case MLN_OPT_DBL:
+    *(double *)(opts[i].arg) = dv;
+    break;
+  case MLN_OPT_FDBL:
+    (*(void (*)(double))(opts[i].arg))(dv);
+    break;
+  case MLN_OPT_INT:
+    *(int *)(opts[i].arg) = lv;
+    break;
+  case MLN_OPT_FINT:
+    (*(void (*)(int))(opts[i].arg))(lv);
+    break;
+  case MLN_OPT_STR:
+    *(char **)(opts[i].arg) = sv;
+    break;
+  case MLN_OPT_FSTR:
+    (*(void (*)(char *))(opts[i].arg))(sv);
+    break;
+  }
+  return err_cnt;
+}
+
+/*
+ * Process a flag command line argument. An option with an argument
+ * may be given as a flag with the argument appended, as in "-j4", or
+ * followed by it, as in "-j 4".
  */
 static int MlnHandleFlags(int n, FILE *err) {
   int i;
@@ -79,6 +177,14 @@ static int MlnHandleFlags(int n, FILE *err) {
       break;
     }
   }
+  if (opts[i].label == NULL) {
+    for (i = 0; opts[i].label; i++) {
+      if (opts[i].type != MLN_OPT_FLAG && opts[i].type != MLN_OPT_FFLAG &&
+          strncmp(&argv[n][1], opts[i].label, strlen(opts[i].label)) == 0) {
+        return MlnSetOption(i, n, &argv[n][1 + strlen(opts[i].label)], err);
+      }
+    }
+  }
   v = argv[n][0] == '-' ? 1 : 0;
   if (opts[i].label == NULL) {
     if (err) {
@@ -90,6 +196,8 @@ static int MlnHandleFlags(int n, FILE *err) {
     *((int *)opts[i].arg) = v;
   } else if (opts[i].type == MLN_OPT_FFLAG) {
     (*(void (*)(int))(opts[i].arg))(v);
+  } else if (argv[n + 1] != NULL) {
+    err_cnt += MlnSetOption(i, n + 1, argv[n + 1], err);
   } else {
     if (err) {
       fprintf(err, "%smissing argument on switch.\n", emsg);
@@ -122,72 +230,7 @@ static int MlnHandleSwitch(int n, FILE *err) {
     }
     err_cnt++;
   } else {
-    int lv = 0;
-    double dv = 0;
-    char *sv = NULL, *end;
-
-    cp++;
-    switch (opts[i].type) {
-    case MLN_OPT_FLAG:
-    case MLN_OPT_FFLAG:
-      if (err) {
-        fprintf(err, "%soption requires an argument.\n", emsg);
-        MlnErrLine(n, 0, err);
-      }
-      err_cnt++;
-      break;
-    case MLN_OPT_DBL:
-    case MLN_OPT_FDBL:
-      dv = strtod(cp, &end);
-      if (*end) {
-        if (err) {
-          fprintf(err, "%sillegal character in floating-point argument.\n",
-                  emsg);
-          MlnErrLine(n, (int)(end - argv[n]), err);
-        }
-        err_cnt++;
-      }
-      break;
-    case MLN_OPT_INT:
-    case MLN_OPT_FINT:
-      lv = strtol(cp, &end, 0);
-      if (*end) {
-        if (err) {
-          fprintf(err, "%sillegal character in integer argument.\n", emsg);
-          MlnErrLine(n, (int)(end - argv[n]), err);
-        }
-        err_cnt++;
-      }
-      break;
-    case MLN_OPT_STR:
-    case MLN_OPT_FSTR:
-      sv = cp;
-      break;
-    }
-
-    switch (opts[i].type) {
-    case MLN_OPT_FLAG:
-    case MLN_OPT_FFLAG:
-      break;
-    case MLN_OPT_DBL:
-      *(double *)(opts[i].arg) = dv;
-      break;
-    case MLN_OPT_FDBL:
-      (*(void (*)(double))(opts[i].arg))(dv);
-      break;
-    case MLN_OPT_INT:
-      *(int *)(opts[i].arg) = lv;
-      break;
-    case MLN_OPT_FINT:
-      (*(void (*)(int))(opts[i].arg))(lv);
-      break;
-    case MLN_OPT_STR:
-      *(char **)(opts[i].arg) = sv;
-      break;
-    case MLN_OPT_FSTR:
-      (*(void (*)(char *))(opts[i].arg))(sv);
-      break;
-    }
+    err_cnt += MlnSetOption(i, n, cp + 1, err);
   }
 
   return err_cnt;
@@ -205,6 +248,9 @@ int MlnOptInit(char **a, MlnOption *option, FILE *e) {
     for (i = 1; argv[i] != NULL; i++) {
       if (argv[i][0] == '+' || argv[i][0] == '-') {
         err_cnt += MlnHandleFlags(i, err);
+        if (MlnArgIsNext(i) && argv[i + 1] != NULL) {
+          i++; /* The argument of the option */
+        }
       } else if (strchr(argv[i], '=')) {
         err_cnt += MlnHandleSwitch(i, err);
       }
@@ -226,6 +272,10 @@ int MlnOptNArgs() {
 
   if (argv != NULL && argv[0] != NULL) {
     for (i = 1; argv[i] != NULL; i++) {
+      if (!dash_dash && MlnArgIsNext(i) && argv[i + 1] != NULL) {
+        i++; /* The argument of the option */
+        continue;
+      }
       if (dash_dash || !MLN_IS_OPT(argv[i])) {
         cnt++;
       }
@@ -42,26 +42,52 @@ typedef struct {
     MLN_PS_WAITING_FOR_DESTRUCTOR_SYMBOL,
     MLN_PS_WAITING_FOR_DATATYPE_SYMBOL,
     MLN_PS_WAITING_FOR_FALLBACK_ID,
+    MLN_PS_WAITING_FOR_TOKEN_NAME,
+    MLN_PS_WAITING_FOR_HEAT_SYMBOL,
+    MLN_PS_WAITING_FOR_KEYWORD_TOKEN,
+    MLN_PS_WAITING_FOR_KEYWORD_SPELLING,
+    MLN_PS_WAITING_FOR_REGEX_TOKEN,
+    MLN_PS_WAITING_FOR_REGEX_PATTERN,
   } state;                     /* The state of the parser */
   MlnSymbol *fallback;         /* The fallback token */
+  MlnSymbol *keyword;          /* The token whose %keyword spelling is next */
+  MlnSymbol *regex_sym;        /* Token of the next pattern, NULL to skip */
+  MlnRegex **regex_tail;       /* Where the next pattern is linked */
+  int ntoken;                  /* Number of tokens pinned by %token */
   MlnSymbol *lhs;              /* Left-hand side of current rule */
   char *lhs_alias;             /* Alias for the LHS */
   int rhs_count;               /* Number of right-hand side symbols seen */
-  MlnSymbol *rhs[MLN_MAX_RHS]; /* RHS symbols */
-  char *alias[MLN_MAX_RHS];    /* Aliases for each RHS symbol (or NULL) */
+  int rhs_alloc;               /* Slots allocated for rhs[] and alias[] */
+  MlnSymbol **rhs;             /* RHS symbols */
+  char **alias;                /* Aliases for each RHS symbol (or NULL) */
   MlnRule *prev_rule;          /* Previous rule parsed */
   char *decl_keyword;          /* Keyword of a declaration */
   char **decl_arg_slot;    /* Where the declaration argument should be put */
   int *decl_ln_slot;       /* Where the declaration linenumber is put */
   MlnAssocType decl_assoc; /* Assign this association to decl arguments */
+  MlnHeat decl_heat;       /* Assign this heat to decl arguments */
   int prec_counter;        /* Assign this precedence to decl arguments */
   MlnRule *first_rule;     /* Pointer to first rule in the grammar */
   MlnRule *last_rule;      /* Pointer to the most recently parsed rule */
 } pstate;
 
-/* Number of -D options on the command line. */
-static int define_cnt = 0;
-static char **define_array = NULL; /* Name of the -D macros */
+/*
+ * Make sure there is room for one more symbol on the right-hand side
+ * of the rule under construction. The buffers grow geometrically, so
+ * there is no fixed limit on the length of a rule.
+ */
+static void MlnGrowRhs(pstate *ps) {
+  size_t n;
+  if (ps->rhs_count < ps->rhs_alloc) {
+    return;
+  }
+  n = ps->rhs_alloc ? (size_t)ps->rhs_alloc * 2 : 16;
+  ps->rhs = realloc(ps->rhs, sizeof(ps->rhs[0]) * n);
+  ps->alias = realloc(ps->alias, sizeof(ps->alias[0]) * n);
+  MlnMemoryCheck(ps->rhs);
+  MlnMemoryCheck(ps->alias);
+  ps->rhs_alloc = (int)n;
+}
 
 #pragma GCC diagnostic push
 #if defined(__clang__)
@@ -71,7 +97,8 @@ static char **define_array = NULL; /* Name of the -D macros */
 
 /* Parse a single token */
 static void ParseOneToken(pstate *ps) {
-  char *x = MlnStrSafe(ps->token_start); /* save the token permanently */
+  /* save the token permanently */
+  char *x = MlnStrSafe(ps->melon, ps->token_start);
 #if TEST
   printf("%s:%d: Token=[%s] state=%d\n", ps->filename, ps->token_line, x,
          ps->state);
@@ -89,7 +116,7 @@ static void ParseOneToken(pstate *ps) {
     if (x[0] == '%') {
       ps->state = MLN_PS_WAITING_FOR_DECL_KEYWORD;
     } else if (islower(x[0])) {
-      ps->lhs = MlnSymbolNew(x);
+      ps->lhs = MlnSymbolNew(ps->melon, x);
       ps->rhs_count = 0;
       ps->lhs_alias = NULL;
       ps->state = MLN_PS_WAITING_FOR_ARROW;
@@ -133,7 +160,7 @@ static void ParseOneToken(pstate *ps) {
                   "previous rule.");
       ps->error_cnt++;
     } else {
-      ps->prev_rule->prec_sym = MlnSymbolNew(x);
+      ps->prev_rule->prec_sym = MlnSymbolNew(ps->melon, x);
     }
     ps->state = MLN_PS_PRECEDENCE_MARK_2;
     break;
@@ -200,8 +227,9 @@ static void ParseOneToken(pstate *ps) {
   case MLN_PS_IN_RHS:
     if (x[0] == '.') {
       MlnRule *rp;
-      rp = malloc(sizeof(MlnRule) + sizeof(MlnSymbol *) * ps->rhs_count +
-                  sizeof(char *) * ps->rhs_count);
+      size_t nrhs = (size_t)ps->rhs_count;
+      rp = malloc(sizeof(MlnRule) + sizeof(MlnSymbol *) * nrhs +
+                  sizeof(char *) * nrhs);
       if (rp == NULL) {
         MlnErrorMsg(ps->filename, ps->token_line,
                     "Can't allocate enough memory for this rule.");
@@ -235,16 +263,10 @@ static void ParseOneToken(pstate *ps) {
       }
       ps->state = MLN_PS_WAITING_FOR_DECL_OR_RULE;
     } else if (isalpha(x[0])) {
-      if (ps->rhs_count >= MLN_MAX_RHS) {
-        MlnErrorMsg(ps->filename, ps->token_line,
-                    "Too many symbol on RHS or rule beginning at \"%s\".", x);
-        ps->error_cnt++;
-        ps->state = MLN_PS_RESYNC_AFTER_RULE_ERROR;
-      } else {
-        ps->rhs[ps->rhs_count] = MlnSymbolNew(x);
-        ps->alias[ps->rhs_count] = NULL;
-        ps->rhs_count++;
-      }
+      MlnGrowRhs(ps);
+      ps->rhs[ps->rhs_count] = MlnSymbolNew(ps->melon, x);
+      ps->alias[ps->rhs_count] = NULL;
+      ps->rhs_count++;
     } else if (x[0] == '(' && ps->rhs_count > 0) {
       ps->state = MLN_PS_RHS_ALIAS_1;
     } else {
@@ -343,6 +365,21 @@ static void ParseOneToken(pstate *ps) {
       } else if (strcmp(x, "fallback") == 0) {
         ps->fallback = NULL;
         ps->state = MLN_PS_WAITING_FOR_FALLBACK_ID;
+      } else if (strcmp(x, "token") == 0) {
+        ps->state = MLN_PS_WAITING_FOR_TOKEN_NAME;
+      } else if (strcmp(x, "hot") == 0) {
+        ps->decl_heat = MLN_HEAT_HOT;
+        ps->state = MLN_PS_WAITING_FOR_HEAT_SYMBOL;
+      } else if (strcmp(x, "cold") == 0) {
+        ps->decl_heat = MLN_HEAT_COLD;
+        ps->state = MLN_PS_WAITING_FOR_HEAT_SYMBOL;
+      } else if (strcmp(x, "keyword") == 0) {
+        ps->state = MLN_PS_WAITING_FOR_KEYWORD_TOKEN;
+      } else if (strcmp(x, "token_regex") == 0) {
+        ps->state = MLN_PS_WAITING_FOR_REGEX_TOKEN;
+      } else if (strcmp(x, "skip_regex") == 0) {
+        ps->regex_sym = NULL;
+        ps->state = MLN_PS_WAITING_FOR_REGEX_PATTERN;
       } else {
         MlnErrorMsg(ps->filename, ps->token_line,
                     "Unknown declaration keyword: \"%%%s\".", x);
@@ -364,7 +401,7 @@ static void ParseOneToken(pstate *ps) {
       ps->error_cnt++;
       ps->state = MLN_PS_RESYNC_AFTER_DECL_ERROR;
     } else {
-      MlnSymbol *sym = MlnSymbolNew(x);
+      MlnSymbol *sym = MlnSymbolNew(ps->melon, x);
       ps->decl_arg_slot = &sym->destructor;
       ps->decl_ln_slot = &sym->destructor_line;
       ps->state = MLN_PS_WAITING_FOR_DECL_ARG;
@@ -378,7 +415,7 @@ static void ParseOneToken(pstate *ps) {
       ps->error_cnt++;
       ps->state = MLN_PS_RESYNC_AFTER_DECL_ERROR;
     } else {
-      MlnSymbol *sym = MlnSymbolNew(x);
+      MlnSymbol *sym = MlnSymbolNew(ps->melon, x);
       ps->decl_arg_slot = &sym->data_type;
       ps->decl_ln_slot = 0;
       ps->state = MLN_PS_WAITING_FOR_DECL_ARG;
@@ -389,7 +426,7 @@ static void ParseOneToken(pstate *ps) {
     if (x[0] == '.') {
       ps->state = MLN_PS_WAITING_FOR_DECL_OR_RULE;
     } else if (isupper(x[0])) {
-      MlnSymbol *sym = MlnSymbolNew(x);
+      MlnSymbol *sym = MlnSymbolNew(ps->melon, x);
       if (sym->prec >= 0) {
         MlnErrorMsg(ps->filename, ps->token_line,
                     "Symbol \"%s\" has already be given a precedence.", x);
@@ -437,7 +474,7 @@ static void ParseOneToken(pstate *ps) {
                   "%%fallback argument \"%s\" should be a token.", x);
       ps->error_cnt++;
     } else {
-      MlnSymbol *sym = MlnSymbolNew(x);
+      MlnSymbol *sym = MlnSymbolNew(ps->melon, x);
       if (ps->fallback == NULL) {
         ps->fallback = sym;
       } else if (sym->fallback != NULL) {
@@ -451,6 +488,120 @@ static void ParseOneToken(pstate *ps) {
     }
     break;
 
+  case MLN_PS_WAITING_FOR_TOKEN_NAME:
+    if (x[0] == '.') {
+      ps->state = MLN_PS_WAITING_FOR_DECL_OR_RULE;
+    } else if (!isupper(x[0])) {
+      MlnErrorMsg(ps->filename, ps->token_line,
+                  "%%token argument \"%s\" should be a token.", x);
+      ps->error_cnt++;
+    } else {
+      MlnSymbol *sym = MlnSymbolNew(ps->melon, x);
+      if (sym->token_order != 0) {
+        MlnErrorMsg(ps->filename, ps->token_line,
+                    "Token %s is named by %%token more than once.", x);
+        ps->error_cnt++;
+      } else {
+        sym->token_order = ++ps->ntoken;
+      }
+    }
+    break;
+
+  case MLN_PS_WAITING_FOR_HEAT_SYMBOL:
+    if (x[0] == '.') {
+      ps->state = MLN_PS_WAITING_FOR_DECL_OR_RULE;
+    } else if (!islower(x[0])) {
+      MlnErrorMsg(ps->filename, ps->token_line,
+                  "%%%s argument \"%s\" should be a non-terminal.",
+                  ps->decl_keyword, x);
+      ps->error_cnt++;
+    } else {
+      MlnSymbol *sym = MlnSymbolNew(ps->melon, x);
+      if (sym->heat != MLN_HEAT_NORMAL) {
+        MlnErrorMsg(ps->filename, ps->token_line,
+                    "Symbol \"%s\" is already marked %%hot or %%cold.", x);
+        ps->error_cnt++;
+      } else {
+        sym->heat = ps->decl_heat;
+      }
+    }
+    break;
+
+  case MLN_PS_WAITING_FOR_KEYWORD_TOKEN:
+    if (x[0] == '.') {
+      ps->state = MLN_PS_WAITING_FOR_DECL_OR_RULE;
+    } else if (!isupper(x[0])) {
+      MlnErrorMsg(ps->filename, ps->token_line,
+                  "%%keyword argument \"%s\" should be a token.", x);
+      ps->error_cnt++;
+      ps->state = MLN_PS_RESYNC_AFTER_DECL_ERROR;
+    } else {
+      ps->keyword = MlnSymbolNew(ps->melon, x);
+      ps->state = MLN_PS_WAITING_FOR_KEYWORD_SPELLING;
+    }
+    break;
+
+  case MLN_PS_WAITING_FOR_KEYWORD_SPELLING:
+    if (x[0] != '\"' || x[1] == '\0') {
+      MlnErrorMsg(ps->filename, ps->token_line,
+                  "The %%keyword spelling of token %s should be a non-empty "
+                  "string.",
+                  ps->keyword->name);
+      ps->error_cnt++;
+      ps->state = x[0] == '.' ? MLN_PS_WAITING_FOR_DECL_OR_RULE
+                              : MLN_PS_RESYNC_AFTER_DECL_ERROR;
+    } else if (ps->keyword->keyword != NULL) {
+      MlnErrorMsg(ps->filename, ps->token_line,
+                  "Token %s has more than one %%keyword spelling.",
+                  ps->keyword->name);
+      ps->error_cnt++;
+      ps->state = MLN_PS_WAITING_FOR_KEYWORD_TOKEN;
+    } else {
+      ps->keyword->keyword = &x[1];
+      ps->keyword->keyword_line = ps->token_line;
+      ps->state = MLN_PS_WAITING_FOR_KEYWORD_TOKEN;
+    }
+    break;
+
+  case MLN_PS_WAITING_FOR_REGEX_TOKEN:
+    if (x[0] == '.') {
+      ps->state = MLN_PS_WAITING_FOR_DECL_OR_RULE;
+    } else if (!isupper(x[0])) {
+      MlnErrorMsg(ps->filename, ps->token_line,
+                  "%%token_regex argument \"%s\" should be a token.", x);
+      ps->error_cnt++;
+      ps->state = MLN_PS_RESYNC_AFTER_DECL_ERROR;
+    } else {
+      ps->regex_sym = MlnSymbolNew(ps->melon, x);
+      ps->state = MLN_PS_WAITING_FOR_REGEX_PATTERN;
+    }
+    break;
+
+  case MLN_PS_WAITING_FOR_REGEX_PATTERN:
+    if (x[0] == '.' && ps->regex_sym == NULL) {
+      ps->state = MLN_PS_WAITING_FOR_DECL_OR_RULE;
+    } else if (x[0] != '\"' || x[1] == '\0') {
+      MlnErrorMsg(ps->filename, ps->token_line,
+                  "The pattern of %%%s should be a non-empty string.",
+                  ps->decl_keyword);
+      ps->error_cnt++;
+      ps->state = x[0] == '.' ? MLN_PS_WAITING_FOR_DECL_OR_RULE
+                              : MLN_PS_RESYNC_AFTER_DECL_ERROR;
+    } else {
+      MlnRegex *re = malloc(sizeof(MlnRegex));
+      MlnMemoryCheck(re);
+      re->sym = ps->regex_sym;
+      re->pattern = &x[1];
+      re->line = ps->token_line;
+      re->next = NULL;
+      *ps->regex_tail = re;
+      ps->regex_tail = &re->next;
+      if (ps->regex_sym != NULL) {
+        ps->state = MLN_PS_WAITING_FOR_REGEX_TOKEN;
+      }
+    }
+    break;
+
   case MLN_PS_RESYNC_AFTER_RULE_ERROR: /* Fall through */
   case MLN_PS_RESYNC_AFTER_DECL_ERROR:
     if (x[0] == '.') {
@@ -465,18 +616,34 @@ static void ParseOneToken(pstate *ps) {
 #pragma GCC diagnostic pop
 
 /*
- * Run the preprocessor over the input file text. The global variables
- * define_array[0] through define_array[define-cnt] contains the names
- * of all defined macros. This routine looks for "%ifdef" and "%ifndef"
- * and "%endif" and comments them out. Text in between is also commented
- * out as appropriate.
+ * Return true if "name" of "n" bytes is defined by a -D option. A
+ * macro may be given a value, as in "-DNAME=VALUE".
+ */
+static int MlnIsDefined(Melon *melon, const char *name, int n) {
+  int k;
+  for (k = 0; k < melon->ndefine; k++) {
+    const char *z = melon->defines[k];
+    if (strncmp(z, name, n) == 0 && (z[n] == '\0' || z[n] == '=')) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Run the preprocessor over the input file text. The names of all
+ * defined macros are in melon->defines. This routine looks for "%ifdef"
+ * and "%ifndef" and "%endif" and comments them out. Text in between is
+ * also commented out as appropriate. Return the line of an unterminated
+ * "%ifdef", or 0 if there is none.
  *
  * TODO(mn): optimize un-exclude endif
  */
-static void MlnPreprocessInput(char *z) {
-  int i, j, k, n;
+static int MlnPreprocessInput(Melon *melon, char *z) {
+  long i, j;
+  int n;
   int exclude = 0;
-  int start = 0;
+  long start = 0;
   int line_no = 1;
   int start_line_no = 0;
 
@@ -510,14 +677,7 @@ static void MlnPreprocessInput(char *z) {
         }
         for (n = 0; z[j + n] != '\0' && !isspace(z[j + n]); n++) {
         }
-        exclude = 1;
-        for (k = 0; k < define_cnt; k++) {
-          if (strncmp(define_array[k], &z[j], n) == 0 &&
-              strlen(define_array[k]) == n) {
-            exclude = 0;
-            break;
-          }
-        }
+        exclude = !MlnIsDefined(melon, &z[j], n);
         if (z[i + 3] == 'n') {
           exclude = !exclude;
         }
@@ -531,62 +691,25 @@ static void MlnPreprocessInput(char *z) {
       }
     }
   }
-  if (exclude) {
-    fprintf(stderr, "unterminated %%ifdef starting on line %d\n",
-            start_line_no);
-    exit(1);
-  }
+  return exclude ? start_line_no : 0;
 }
 
-/*
- * This routine is called with the argument to each -D command-line option.
- * Add the macro defined to the define_array array.
- */
-void MlnHandleDOption(char *z) {
-  define_cnt++;
-  define_array = realloc(define_array, sizeof(define_array[0]) * define_cnt);
-  if (define_array == NULL) {
-    fprintf(stderr, "out of memory\n");
-    exit(1);
-  }
-
-  define_array[define_cnt - 1] = strdup(z);
-  if (define_array[define_cnt - 1] == NULL) {
-    fprintf(stderr, "out of memory\n");
-    exit(1);
-  }
-  for (z = define_array[define_cnt - 1]; *z && *z != '='; z++) {
-  }
-  *z = '\0';
-}
+static void MlnParseText(Melon *melon, char *buf);
 
 /*
- * In spite of its name, this function is really a scanner. It read
- * int the entire input file (all at once) then tokenizes it. Each
- * token is passed to the function "ParseOneToken" which builds
- * all the appropriate data structures in the global state vector
- * "melon".
+ * Read in the entire input file (all at once) then parse it with
+ * MlnParseText().
  */
 void MlnParse(Melon *melon) {
-  pstate ps;
   FILE *fp;
   char *buf;
-  char *cp, *nextcp;
-  int file_size;
-  int line_no;
-  int c;
-  int start_line = 0;
-
-  ps.melon = melon;
-  ps.filename = melon->filename;
-  ps.error_cnt = 0;
-  ps.state = MLN_PS_INITIALIZE;
-  ps.first_rule = NULL;
+  long file_size;
+  const char *filename = melon->filename;
 
   /* Begin by reading the input file */
-  fp = fopen(ps.filename, "rb");
+  fp = fopen(filename, "rb");
   if (fp == NULL) {
-    MlnErrorMsg(ps.filename, 0, "Can't open this file for reading.");
+    MlnErrorMsg(filename, 0, "Can't open this file for reading.");
     melon->error_cnt++;
     return;
   }
@@ -594,25 +717,84 @@ void MlnParse(Melon *melon) {
   fseek(fp, 0, SEEK_END);
   file_size = ftell(fp);
   rewind(fp);
-  buf = malloc(file_size + 1);
+  if (file_size < 0) {
+    MlnErrorMsg(filename, 0, "Can't determine the size of this file.");
+    melon->error_cnt++;
+    fclose(fp);
+    return;
+  }
+  buf = malloc((size_t)file_size + 1);
   if (buf == NULL) {
-    MlnErrorMsg(ps.filename, 0,
-                "Can't allocate %d of memory to hold this file.",
+    MlnErrorMsg(filename, 0, "Can't allocate %ld of memory to hold this file.",
                 file_size + 1);
     melon->error_cnt++;
+    fclose(fp);
     return;
   }
-  if (fread(buf, 1, file_size, fp) != file_size) {
-    MlnErrorMsg(ps.filename, 0, "Can't read in all %d bytes of this file.",
+  if (fread(buf, 1, (size_t)file_size, fp) != (size_t)file_size) {
+    MlnErrorMsg(filename, 0, "Can't read in all %ld bytes of this file.",
                 file_size);
     melon->error_cnt++;
+    fclose(fp);
+    free(buf);
     return;
   }
   fclose(fp);
   buf[file_size] = '\0';
+  MlnParseText(melon, buf);
+}
+
+/*
+ * Parse the grammar held in memory. The text need not be terminated,
+ * and melon->filename is only used in messages.
+ */
+void MlnParseBuffer(Melon *melon, const char *text, size_t len) {
+  char *buf = malloc(len + 1);
+  if (buf == NULL) {
+    MlnErrorMsg(melon->filename, 0,
+                "Can't allocate %lu of memory to hold this grammar.",
+                (unsigned long)len + 1);
+    melon->error_cnt++;
+    return;
+  }
+  memcpy(buf, text, len);
+  buf[len] = '\0';
+  MlnParseText(melon, buf);
+}
+
+/*
+ * In spite of its name, this function is really a scanner. It
+ * tokenizes the text in "buf", which it takes over. Each token is
+ * passed to the function "ParseOneToken" which builds all the
+ * appropriate data structures in the global state vector "melon".
+ */
+static void MlnParseText(Melon *melon, char *buf) {
+  pstate ps;
+  char *cp, *nextcp;
+  int line_no;
+  int c;
+  int start_line = 0;
+
+  ps.melon = melon;
+  ps.filename = melon->filename;
+  ps.error_cnt = 0;
+  ps.state = MLN_PS_INITIALIZE;
+  ps.first_rule = NULL;
+  ps.ntoken = 0;
+  ps.rhs_count = 0;
+  ps.rhs_alloc = 0;
+  ps.rhs = NULL;
+  ps.alias = NULL;
+  ps.regex_tail = &melon->regex;
 
   /* Make an initial pass through the file to handle %ifdef and %ifndef */
-  MlnPreprocessInput(buf);
+  line_no = MlnPreprocessInput(melon, buf);
+  if (line_no > 0) {
+    MlnErrorMsg(ps.filename, line_no, "Unterminated %%ifdef.");
+    melon->error_cnt++;
+    free(buf);
+    return;
+  }
 
   /* Now scan the next of the input file */
   line_no = 1;
@@ -749,6 +931,8 @@ void MlnParse(Melon *melon) {
   }
 
   free(buf); /* Release the buffer after parsing */
+  free(ps.rhs);
+  free(ps.alias);
   melon->rule = ps.first_rule;
   melon->error_cnt = ps.error_cnt;
 }
@@ -10,7 +10,7 @@
 
 #include "struct.h"
 
-void MlnHandleDOption(char *z);
 void MlnParse(Melon *melon);
+void MlnParseBuffer(Melon *melon, const char *text, size_t len);
 
 #endif
@@ -8,51 +8,67 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-static MlnPLink *plink_free_list = NULL;
-static const int kDefaultPLinkSize = 100;
+#include "struct.h"
+
+static const int kDefaultPLinkSize = 1024;
 
 /*
- * Allocate a new plink.
+ * Start with no plinks.
  */
-MlnPLink *MlnPLinkNew() {
-  MlnPLink *new;
-  if (plink_free_list == NULL) {
-    int i;
-    plink_free_list = calloc(kDefaultPLinkSize, sizeof(MlnPLink));
-    if (plink_free_list == NULL) {
-      fprintf(stderr, "Unable to allocate memory for a new follow-set "
-                      "propagation link.\n");
-      exit(1);
-    }
-    for (i = 0; i < kDefaultPLinkSize - 1; i++) {
-      plink_free_list[i].next = &plink_free_list[i + 1];
-    }
+void MlnPLinkInit(Melon *melon) {
+  MlnPLinkPool *pool = &melon->plink_pool;
+  pool->plinks = NULL;
+  pool->alloc = pool->count = 0;
+  pool->free_list = MLN_NO_INDEX;
+}
+
+/*
+ * Allocate a new plink, and return its index.
+ */
+int MlnPLinkNew(Melon *melon) {
+  MlnPLinkPool *pool = &melon->plink_pool;
+  int new;
+  if (pool->free_list != MLN_NO_INDEX) {
+    new = pool->free_list;
+    pool->free_list = pool->plinks[new].next;
+    return new;
+  }
+  if (pool->count >= pool->alloc) {
+    pool->alloc = pool->alloc > 0 ? pool->alloc * 2 : kDefaultPLinkSize;
+    pool->plinks = realloc(pool->plinks, sizeof(MlnPLink) * pool->alloc);
+    MlnMemoryCheck(pool->plinks);
   }
+  return pool->count++;
+}
 
-  new = plink_free_list;
-  plink_free_list = plink_free_list->next;
-  return new;
+/*
+ * Return the plink of index "index".
+ */
+MlnPLink *MlnPLinkAt(Melon *melon, int index) {
+  return &melon->plink_pool.plinks[index];
 }
 
 /*
- * Add a plink to a plink list.
+ * Add a link to the configuration of index "config" to the plink list
+ * "*plpp".
  */
-void MlnPLinkAdd(MlnPLink **plpp, MlnConfig *config) {
-  MlnPLink *new;
-  new = MlnPLinkNew();
-  new->next = *plpp;
+void MlnPLinkAdd(Melon *melon, int *plpp, int config) {
+  int new = MlnPLinkNew(melon);
+  MlnPLink *plp = MlnPLinkAt(melon, new);
+  plp->next = *plpp;
+  plp->config = config;
   *plpp = new;
-  new->config = config;
 }
 
 /*
  * Transfer every plink on the list "from" to the list "to".
  */
-void MlnPLinkCopy(MlnPLink **to, MlnPLink *from) {
-  MlnPLink *next;
-  while (from != NULL) {
-    next = from->next;
-    from->next = *to;
+void MlnPLinkCopy(Melon *melon, int *to, int from) {
+  MlnPLink *plinks = melon->plink_pool.plinks;
+  int next;
+  while (from != MLN_NO_INDEX) {
+    next = plinks[from].next;
+    plinks[from].next = *to;
     *to = from;
     from = next;
   }
@@ -61,13 +77,21 @@ void MlnPLinkCopy(MlnPLink **to, MlnPLink *from) {
 /*
  * Delete every plink on the list.
  */
-void MlnPLinkDelete(MlnPLink *plp) {
-  MlnPLink *next;
-
-  while (plp != NULL) {
-    next = plp->next;
-    plp->next = plink_free_list;
-    plink_free_list = plp;
+void MlnPLinkDelete(Melon *melon, int plp) {
+  MlnPLinkPool *pool = &melon->plink_pool;
+  int next;
+  while (plp != MLN_NO_INDEX) {
+    next = pool->plinks[plp].next;
+    pool->plinks[plp].next = pool->free_list;
+    pool->free_list = plp;
     plp = next;
   }
 }
+
+/*
+ * Release the storage of every plink ever allocated.
+ */
+void MlnPLinkFreeAll(Melon *melon) {
+  free(melon->plink_pool.plinks);
+  MlnPLinkInit(melon);
+}
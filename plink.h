@@ -8,9 +8,12 @@
 
 #include "struct.h"
 
-MlnPLink *MlnPLinkNew();
-void MlnPLinkAdd(MlnPLink **plpp, MlnConfig *config);
-void MlnPLinkCopy(MlnPLink **to, MlnPLink *from);
-void MlnPLinkDelete(MlnPLink *plp);
+void MlnPLinkInit(Melon *melon);
+int MlnPLinkNew(Melon *melon);
+MlnPLink *MlnPLinkAt(Melon *melon, int index);
+void MlnPLinkAdd(Melon *melon, int *plpp, int config);
+void MlnPLinkCopy(Melon *melon, int *to, int from);
+void MlnPLinkDelete(Melon *melon, int plp);
+void MlnPLinkFreeAll(Melon *melon);
 
 #endif
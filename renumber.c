@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ *
+ * Renumbering of the symbols, to shrink the action table. The rows
+ * are packed by MlnActionTableInsert() at offsets where all of their
+ * lookaheads fit, so a row whose symbols have nearby numbers is both
+ * cheaper to place and leaves fewer holes. A few orderings of the
+ * terminals and of the non-terminals are tried:
+ *
+ *    frequency      Symbols in the most rows first
+ *    Cuthill-McKee  Breadth-first over the symbols sharing a row
+ *    reverse CM     The same, reversed
+ *
+ * and the one giving the smallest table is kept. "$", the tokens
+ * named by %token and "{default}" keep their numbers.
+ */
+
+#include "renumber.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "action.h"
+#include "report.h"
+#include "set.h"
+
+/*
+ * The rows of the action table in which the symbols lo..hi-1 appear,
+ * stored both ways: the symbols of every row, and the rows of every
+ * symbol. Symbols are stored relative to lo.
+ */
+typedef struct MlnSymbolRows {
+  int lo, hi;     /* The symbols renumbered are lo..hi-1 */
+  int nrow;       /* Number of rows */
+  int *row_first; /* Start of each row in row_sym[] */
+  int *row_sym;   /* Symbols of all rows */
+  int *sym_first; /* Start of the rows of each symbol in sym_row[] */
+  int *sym_row;   /* Rows of all symbols */
+} MlnSymbolRows;
+
+/* A symbol with its sort key */
+typedef struct {
+  int sym;
+  int key;
+} MlnSymbolKey;
+
+static int MlnSymbolKeyCmp(const void *a, const void *b) {
+  const MlnSymbolKey *p1 = a, *p2 = b;
+  if (p1->key != p2->key) {
+    return p1->key < p2->key ? -1 : 1;
+  }
+  return p1->sym - p2->sym;
+}
+
+/*
+ * True if the action goes into the action table.
+ */
+static int MlnIsEntered(MlnAction *ap) { return ap->type <= MLN_ERROR; }
+
+/*
+ * Collect the rows of the symbols lo..hi-1: one row per state, made of
+ * the lookaheads of its entered actions within that range.
+ */
+static void MlnSymbolRowsInit(MlnSymbolRows *rows, Melon *melon, int lo,
+                              int hi) {
+  int i, j, n, nsym;
+  int *fill;
+
+  nsym = hi - lo;
+  rows->lo = lo;
+  rows->hi = hi;
+  rows->nrow = melon->nstate;
+  rows->row_first = malloc(sizeof(int) * (melon->nstate + 1));
+  rows->sym_first = calloc(nsym + 1, sizeof(int));
+  MlnMemoryCheck(rows->row_first);
+  MlnMemoryCheck(rows->sym_first);
+
+  n = 0;
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    rows->row_first[i] = n;
+    for (j = 0; j < state->nap; j++) {
+      MlnAction *ap = &state->ap[j];
+      if (ap->sym >= lo && ap->sym < hi && MlnIsEntered(ap)) {
+        rows->sym_first[ap->sym - lo + 1]++;
+        n++;
+      }
+    }
+  }
+  rows->row_first[melon->nstate] = n;
+  rows->row_sym = malloc(sizeof(int) * (n + 1));
+  rows->sym_row = malloc(sizeof(int) * (n + 1));
+  fill = malloc(sizeof(int) * (nsym + 1));
+  MlnMemoryCheck(rows->row_sym);
+  MlnMemoryCheck(rows->sym_row);
+  MlnMemoryCheck(fill);
+  for (i = 0; i < nsym; i++) {
+    rows->sym_first[i + 1] += rows->sym_first[i];
+    fill[i] = rows->sym_first[i];
+  }
+
+  n = 0;
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap; j++) {
+      MlnAction *ap = &state->ap[j];
+      if (ap->sym >= lo && ap->sym < hi && MlnIsEntered(ap)) {
+        rows->row_sym[n++] = ap->sym - lo;
+        rows->sym_row[fill[ap->sym - lo]++] = i;
+      }
+    }
+  }
+  free(fill);
+}
+
+static void MlnSymbolRowsFree(MlnSymbolRows *rows) {
+  free(rows->row_first);
+  free(rows->row_sym);
+  free(rows->sym_first);
+  free(rows->sym_row);
+}
+
+/* Number of rows the symbol "s" (relative to lo) appears in */
+#define MlnDegree(rows, s) ((rows)->sym_first[(s) + 1] - (rows)->sym_first[s])
+
+/*
+ * Order the symbols by the number of rows they appear in, most first.
+ */
+static void MlnOrderByFrequency(MlnSymbolRows *rows, int *order) {
+  int i, nsym = rows->hi - rows->lo;
+  MlnSymbolKey *keys = malloc(sizeof(keys[0]) * (nsym + 1));
+  MlnMemoryCheck(keys);
+  for (i = 0; i < nsym; i++) {
+    keys[i].sym = i;
+    keys[i].key = -MlnDegree(rows, i);
+  }
+  qsort(keys, nsym, sizeof(keys[0]), MlnSymbolKeyCmp);
+  for (i = 0; i < nsym; i++) {
+    order[i] = keys[i].sym;
+  }
+  free(keys);
+}
+
+/*
+ * Order the symbols by Cuthill-McKee: breadth first over the graph in
+ * which two symbols are adjacent if they share a row, starting from a
+ * symbol of least degree and visiting neighbours by increasing degree.
+ * Reversed if "reverse" is set. The symbols in no row come last.
+ */
+static void MlnOrderByCuthillMcKee(MlnSymbolRows *rows, int *order,
+                                   int reverse) {
+  int i, j, k, n, head, first;
+  int nsym = rows->hi - rows->lo;
+  char *visited = calloc(nsym + 1, 1);
+  MlnSymbolKey *keys = malloc(sizeof(keys[0]) * (nsym + 1));
+  MlnMemoryCheck(visited);
+  MlnMemoryCheck(keys);
+
+  n = 0;
+  for (;;) {
+    int start = -1;
+    for (i = 0; i < nsym; i++) {
+      if (!visited[i] && MlnDegree(rows, i) > 0 &&
+          (start < 0 || MlnDegree(rows, i) < MlnDegree(rows, start))) {
+        start = i;
+      }
+    }
+    if (start < 0) {
+      break;
+    }
+    visited[start] = 1;
+    order[n++] = start;
+    for (head = n - 1; head < n; head++) {
+      int s = order[head];
+      first = n;
+      for (i = rows->sym_first[s]; i < rows->sym_first[s + 1]; i++) {
+        int r = rows->sym_row[i];
+        for (j = rows->row_first[r]; j < rows->row_first[r + 1]; j++) {
+          int t = rows->row_sym[j];
+          if (!visited[t]) {
+            visited[t] = 1;
+            order[n++] = t;
+          }
+        }
+      }
+      for (k = first; k < n; k++) {
+        keys[k - first].sym = order[k];
+        keys[k - first].key = MlnDegree(rows, order[k]);
+      }
+      qsort(keys, n - first, sizeof(keys[0]), MlnSymbolKeyCmp);
+      for (k = first; k < n; k++) {
+        order[k] = keys[k - first].sym;
+      }
+    }
+  }
+  if (reverse) {
+    for (i = 0, j = n - 1; i < j; i++, j--) {
+      k = order[i];
+      order[i] = order[j];
+      order[j] = k;
+    }
+  }
+  for (i = 0; i < nsym; i++) {
+    if (!visited[i]) {
+      order[n++] = i;
+    }
+  }
+  free(keys);
+  free(visited);
+}
+
+/*
+ * Give the symbol lo+order[k] the number lo+k, for every k below
+ * hi-lo, in the symbol array and in the actions of every state.
+ */
+static void MlnApplyOrder(Melon *melon, int lo, int hi, const int *order) {
+  int i, j;
+  int *map = malloc(sizeof(int) * (melon->nsymbol + 1));
+  MlnSymbol **symbols = malloc(sizeof(MlnSymbol *) * (melon->nsymbol + 1));
+  MlnMemoryCheck(map);
+  MlnMemoryCheck(symbols);
+
+  for (i = 0; i <= melon->nsymbol; i++) {
+    map[i] = i;
+  }
+  for (i = 0; i < hi - lo; i++) {
+    map[lo + order[i]] = lo + i;
+  }
+  for (i = 0; i <= melon->nsymbol; i++) {
+    symbols[map[i]] = melon->symbols[i];
+  }
+  for (i = 0; i <= melon->nsymbol; i++) {
+    melon->symbols[i] = symbols[i];
+    melon->symbols[i]->index = i;
+  }
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap; j++) {
+      state->ap[j].sym = map[state->ap[j].sym];
+    }
+    MlnActionSort(state);
+  }
+  free(symbols);
+  free(map);
+}
+
+/*
+ * Try the orderings of the symbols lo..hi-1, and keep the one giving
+ * the smallest action table, if it is smaller than "*cost".
+ */
+static void MlnRenumberRange(Melon *melon, int lo, int hi, long *cost) {
+  MlnSymbolRows rows;
+  int nsym = hi - lo;
+  int *order, *inverse, *best;
+  int c, i;
+  long size;
+
+  if (nsym < 2) {
+    return;
+  }
+  MlnSymbolRowsInit(&rows, melon, lo, hi);
+  order = malloc(sizeof(int) * nsym);
+  inverse = malloc(sizeof(int) * nsym);
+  best = malloc(sizeof(int) * nsym);
+  MlnMemoryCheck(order);
+  MlnMemoryCheck(inverse);
+  MlnMemoryCheck(best);
+
+  best[0] = -1;
+  for (c = 0; c < 3; c++) {
+    if (c == 0) {
+      MlnOrderByFrequency(&rows, order);
+    } else {
+      MlnOrderByCuthillMcKee(&rows, order, c == 2);
+    }
+    MlnApplyOrder(melon, lo, hi, order);
+    size = MlnActionTableCost(melon);
+    if (size < *cost) {
+      *cost = size;
+      memcpy(best, order, sizeof(int) * nsym);
+    }
+    for (i = 0; i < nsym; i++) {
+      inverse[order[i]] = i;
+    }
+    MlnApplyOrder(melon, lo, hi, inverse);
+  }
+  if (best[0] >= 0) {
+    MlnApplyOrder(melon, lo, hi, best);
+  }
+
+  free(best);
+  free(inverse);
+  free(order);
+  MlnSymbolRowsFree(&rows);
+}
+
+/* The terminals before and after the renumbering */
+typedef struct MlnRemap {
+  MlnSymbol **old; /* The symbols by their old numbers */
+  int nterminal;   /* Number of terminals */
+  char *tmp;       /* Scratch set */
+} MlnRemap;
+
+/*
+ * Move the element of every terminal from its old number to its
+ * current number.
+ */
+static void MlnRemapSet(char *set, void *arg) {
+  MlnRemap *remap = arg;
+  int i;
+  for (i = 0; i < remap->nterminal; i++) {
+    remap->tmp[remap->old[i]->index] = set[i];
+  }
+  memcpy(set, remap->tmp, remap->nterminal);
+}
+
+/*
+ * Renumber the terminals and the non-terminals of the automaton, so
+ * that the action table packs more tightly.
+ */
+void MlnRenumberSymbols(Melon *melon) {
+  MlnRemap remap;
+  int i, npinned;
+  long cost;
+
+  if (melon->nstate == 0) {
+    return;
+  }
+  remap.old = malloc(sizeof(MlnSymbol *) * (melon->nsymbol + 1));
+  remap.tmp = malloc(melon->nterminal + 1);
+  remap.nterminal = melon->nterminal;
+  MlnMemoryCheck(remap.old);
+  MlnMemoryCheck(remap.tmp);
+  memcpy(remap.old, melon->symbols,
+         sizeof(MlnSymbol *) * (melon->nsymbol + 1));
+
+  npinned = 0;
+  while (npinned + 1 < melon->nterminal &&
+         melon->symbols[npinned + 1]->token_order != 0) {
+    npinned++;
+  }
+  cost = MlnActionTableCost(melon);
+  MlnRenumberRange(melon, npinned + 1, melon->nterminal, &cost);
+  MlnRenumberRange(melon, melon->nterminal, melon->nsymbol, &cost);
+
+  /* The sets of terminals follow the new numbers. The follow sets are
+   * shared by the configurations, so each is remapped once. */
+  MlnSetInternMap(melon, MlnRemapSet, &remap);
+  for (i = 0; i <= melon->nsymbol; i++) {
+    if (remap.old[i]->first_set != NULL) {
+      MlnRemapSet(remap.old[i]->first_set, &remap);
+    }
+  }
+  free(remap.tmp);
+  free(remap.old);
+}
@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#ifndef MELON_RENUMBER_H_
+#define MELON_RENUMBER_H_
+
+#include "struct.h"
+
+void MlnRenumberSymbols(Melon *melon);
+
+#endif
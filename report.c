@@ -15,23 +15,24 @@
 #include "acttab.h"
 #include "assert.h"
 #include "error.h"
+#include "keyword.h"
+#include "lexer.h"
+#include "libmelon.h"
 #include "set.h"
 #include "table.h"
 
 const char *kDefaultTemplateFile = "mlt_parser.c";
+const char *kDefaultCxxTemplateFile = "mlt_parser.hpp";
 
 /*
  * Generate a filename with the given suffix. Space to hold the
  * name comes from malloc() and must be freed by calling function.
  */
-static char *MlnFileMakeName(Melon *melon, const char *suffix) {
+char *MlnFileMakeName(Melon *melon, const char *suffix) {
   char *cp;
   char *name = malloc(strlen(melon->filename) + strlen(suffix) + 5);
 
-  if (name == NULL) {
-    fprintf(stderr, "Can't allocate space for a filename.\n");
-    exit(1);
-  }
+  MlnMemoryCheck(name);
   strcpy(name, melon->filename);
   cp = strrchr(name, '.');
   if (cp != NULL) {
@@ -44,33 +45,146 @@ static char *MlnFileMakeName(Melon *melon, const char *suffix) {
 /*
  * Open a file with a name based on the name of the input file,
  * but with a different (specified) suffix, and return a pointer
- * to the stream.
+ * to the stream. With melon->sinks, outputs are collected in memory
+ * and nothing can be read back.
  */
 static FILE *MlnFileOpen(Melon *melon, const char *suffix, const char *mode) {
+  char *name;
   FILE *fp;
 
-  if (melon->output_file != NULL) {
-    free(melon->output_file);
+  name = MlnFileMakeName(melon, suffix);
+  free(melon->output_file);
+  melon->output_file = name;
+  if (melon->sinks != NULL) {
+    if (*mode != 'w') {
+      return NULL;
+    }
+    assert(melon->sink_buf == NULL);
+    fp = open_memstream(&melon->sink_buf, &melon->sink_len);
+    melon->sink_file = fp;
+    melon->sink_suffix = suffix;
+  } else {
+    fp = fopen(melon->output_file, mode);
   }
-  melon->output_file = MlnFileMakeName(melon, suffix);
-  fp = fopen(melon->output_file, mode);
   if (fp == NULL && *mode == 'w') {
-    fprintf(stderr, "Can't open file \"%s\".\n", melon->output_file);
+    fprintf(MlnErrorStream(stderr), "Can't open file \"%s\".\n",
+            melon->output_file);
     melon->error_cnt++;
     return NULL;
   }
   return fp;
 }
 
+/*
+ * Close an output opened by MlnFileOpen(), and hand it over to the
+ * sinks if there are any.
+ */
+static void MlnFileClose(Melon *melon, FILE *fp) {
+  fclose(fp);
+  if (melon->sinks != NULL) {
+    melon->sink_file = NULL;
+    melon->sinks->output(melon->sinks->arg, melon->sink_suffix,
+                         melon->sink_buf, melon->sink_len);
+    free(melon->sink_buf);
+    melon->sink_buf = NULL;
+    melon->sink_len = 0;
+  }
+}
+
+/*
+ * Open an output like MlnFileOpen(), but into a temporary file, which
+ * MlnFileCommit() moves over the output only if their bytes differ.
+ * The unchanged files of a parser then keep their time stamps, so
+ * that make rebuilds only the changed ones.
+ */
+static FILE *MlnFileOpenTemp(Melon *melon, const char *suffix) {
+  char tmp_suffix[48];
+  char *tmp_name, *name;
+  FILE *fp;
+
+  if (melon->sinks != NULL) {
+    return MlnFileOpen(melon, suffix, "w");
+  }
+  snprintf(tmp_suffix, sizeof(tmp_suffix), "%s.tmp", suffix);
+  tmp_name = MlnFileMakeName(melon, tmp_suffix);
+  fp = fopen(tmp_name, "w");
+  if (fp == NULL) {
+    fprintf(MlnErrorStream(stderr), "Can't open file \"%s\".\n", tmp_name);
+    melon->error_cnt++;
+  }
+  free(tmp_name);
+  name = MlnFileMakeName(melon, suffix);
+  free(melon->output_file);
+  melon->output_file = name;
+  return fp;
+}
+
+/*
+ * Return true if the files "a" and "b" have the same bytes.
+ */
+static int MlnFileSame(const char *a, const char *b) {
+  char buf_a[4096], buf_b[4096];
+  FILE *fa, *fb;
+  size_t na, nb;
+  int same;
+
+  fa = fopen(a, "rb");
+  fb = fopen(b, "rb");
+  same = fa != NULL && fb != NULL;
+  while (same) {
+    na = fread(buf_a, 1, sizeof(buf_a), fa);
+    nb = fread(buf_b, 1, sizeof(buf_b), fb);
+    same = na == nb && memcmp(buf_a, buf_b, na) == 0;
+    if (na < sizeof(buf_a)) {
+      break;
+    }
+  }
+  if (fa != NULL) {
+    fclose(fa);
+  }
+  if (fb != NULL) {
+    fclose(fb);
+  }
+  return same;
+}
+
+/*
+ * Close an output opened by MlnFileOpenTemp(), and replace the output
+ * with it unless they are the same.
+ */
+static void MlnFileCommit(Melon *melon, FILE *fp) {
+  char *tmp_name;
+  size_t len;
+
+  if (melon->sinks != NULL) {
+    MlnFileClose(melon, fp);
+    return;
+  }
+  fclose(fp);
+  len = strlen(melon->output_file);
+  tmp_name = malloc(len + 5);
+  MlnMemoryCheck(tmp_name);
+  memcpy(tmp_name, melon->output_file, len);
+  memcpy(tmp_name + len, ".tmp", 5);
+  if (MlnFileSame(tmp_name, melon->output_file)) {
+    remove(tmp_name);
+  } else if (rename(tmp_name, melon->output_file) != 0) {
+    fprintf(MlnErrorStream(stderr), "Can't write file \"%s\".\n",
+            melon->output_file);
+    melon->error_cnt++;
+    remove(tmp_name);
+  }
+  free(tmp_name);
+}
+
 /*
  * Print the configuration to file.
  */
-static void MlnConfigPrint(FILE *file, MlnConfig *config) {
+static void MlnConfigPrint(FILE *file, MlnRule *rule, int dot) {
   int i;
-  MlnRule *rule = config->rule;
   fprintf(file, "%s ::=", rule->lhs->name);
   for (i = 0; i <= rule->nrhs; i++) {
-    if (i == config->dot) {
+    if (i == dot) {
       fprintf(file, " *");
     }
     if (i == rule->nrhs) {
@@ -83,26 +197,26 @@ static void MlnConfigPrint(FILE *file, MlnConfig *config) {
  * Print an action to the given file stream. Return 0 if nothing
  * was actually printed.
  */
-static int MlnPrintAction(MlnAction *action, FILE *file, int indent) {
+static int MlnPrintAction(Melon *melon, MlnAction *action, FILE *file,
+                          int indent) {
   int ret = 1;
+  const char *name = melon->symbols[action->sym]->name;
   switch (action->type) {
   case MLN_SHIFT:
-    fprintf(file, "%*s shift  %d", indent, action->sym->name,
-            action->x.state->index);
+    fprintf(file, "%*s shift  %d", indent, name, action->x.state);
     break;
   case MLN_REDUCE:
-    fprintf(file, "%*s reduce %d", indent, action->sym->name,
-            action->x.rule->index);
+    fprintf(file, "%*s reduce %d", indent, name, action->x.rule);
     break;
   case MLN_ACCEPT:
-    fprintf(file, "%*s accept", indent, action->sym->name);
+    fprintf(file, "%*s accept", indent, name);
     break;
   case MLN_ERROR:
-    fprintf(file, "%*s error", indent, action->sym->name);
+    fprintf(file, "%*s error", indent, name);
     break;
   case MLN_CONFLICT:
-    fprintf(file, "%*s reduce %-3d ** Parsing conflict **", indent,
-            action->sym->name, action->x.rule->index);
+    fprintf(file, "%*s reduce %-3d ** Parsing conflict **", indent, name,
+            action->x.rule);
     break;
   case MLN_SH_RESOLVED:
   case MLN_RD_RESOLVED:
@@ -131,18 +245,6 @@ static void MlnSetPrint(FILE *file, void *set, Melon *melon) {
   fprintf(file, "]\n");
 }
 
-/*
- * Print a PLink chain.
- */
-static void MlnPLinkPrint(FILE *file, MlnPLink *pl, const char *tag) {
-  while (pl != NULL) {
-    fprintf(file, "%12s%s (state %2d) ", "", tag, pl->config->st->index);
-    MlnConfigPrint(file, pl->config);
-    fprintf(file, "\n");
-    pl = pl->next;
-  }
-}
-
 #endif /* TEST */
 
 /*
@@ -190,36 +292,62 @@ static char *MlnPathSearch(const char *argv0, const char *name, int mode) {
   return path;
 }
 
+/*
+ * The default template of the parser, C or C++.
+ */
+static const char *MlnTplDefault(Melon *melon) {
+  return melon->cplusplus ? kDefaultCxxTemplateFile : kDefaultTemplateFile;
+}
+
+/*
+ * Find the name of the template file. Space to hold the name comes
+ * from malloc() and must be freed by the calling function. Return
+ * NULL if there is no template.
+ */
+char *MlnTplName(Melon *melon) {
+  char *tpl_name = MlnFileMakeName(melon, ".mtpl");
+  const char *dflt = MlnTplDefault(melon);
+
+  if (melon->argv0 == NULL) {
+    /* Only the library lacks a program, it has no default template */
+    free(tpl_name);
+    return NULL;
+  }
+  if (access(tpl_name, 0004) == 0) {
+    return tpl_name;
+  }
+  free(tpl_name);
+  if (access(dflt, 0004) == 0) {
+    tpl_name = malloc(strlen(dflt) + 1);
+    MlnMemoryCheck(tpl_name);
+    strcpy(tpl_name, dflt);
+    return tpl_name;
+  }
+  return MlnPathSearch(melon->argv0, dflt, 0004);
+}
+
 /*
  * The next function finds the template file and opens it, returning
  * a pointer to the opened file.
  */
 static FILE *MlnTplOpen(Melon *melon) {
-  char buf[1024];
   FILE *in;
-  char *cp;
-  const char *tpl_name;
-  int need_free = 0;
-
-  cp = strrchr(melon->filename, '.');
-  if (cp != NULL) {
-    sprintf(buf, "%.*s.mtpl", (int)(cp - melon->filename), melon->filename);
-  } else {
-    sprintf(buf, "%s.mtpl", melon->filename);
-  }
+  char *tpl_name;
 
-  if (access(buf, 0004) == 0) {
-    tpl_name = buf;
-  } else if (access(kDefaultTemplateFile, 0004) == 0) {
-    tpl_name = kDefaultTemplateFile;
-  } else {
-    tpl_name = MlnPathSearch(melon->argv0, kDefaultTemplateFile, 0004);
-    need_free = 1;
+  if (melon->tpl_buf != NULL) {
+    in = fmemopen((void *)melon->tpl_buf, melon->tpl_len, "r");
+    if (in == NULL) {
+      fprintf(MlnErrorStream(stderr), "Can't open the template text.\n");
+      melon->error_cnt++;
+    }
+    return in;
   }
 
+  tpl_name = MlnTplName(melon);
   if (tpl_name == NULL) {
-    fprintf(stderr, "Can't find the parser driver template file \"%s\".\n",
-            kDefaultTemplateFile);
+    fprintf(MlnErrorStream(stderr),
+            "Can't find the parser driver template file \"%s\".\n",
+            MlnTplDefault(melon));
     melon->error_cnt++;
     return NULL;
   }
@@ -227,14 +355,12 @@ static FILE *MlnTplOpen(Melon *melon) {
   in = fopen(tpl_name, "r");
 
   if (in == NULL) {
-    fprintf(stderr, "Can't open the template file \"%s\".\n", tpl_name);
+    fprintf(MlnErrorStream(stderr), "Can't open the template file \"%s\".\n",
+            tpl_name);
     melon->error_cnt++;
   }
 
-  if (need_free) {
-    free((char *)tpl_name);
-  }
-
+  free(tpl_name);
   return in;
 }
 
@@ -243,16 +369,16 @@ static FILE *MlnTplOpen(Melon *melon) {
  * which is to be put in the action table of the generated
  * machine. Return negative if no action should be generated.
  */
-static int MlnComputeAction(Melon *melon, MlnAction *ap) {
+static long MlnComputeAction(Melon *melon, MlnAction *ap) {
   switch (ap->type) {
   case MLN_SHIFT:
-    return ap->x.state->index;
+    return ap->x.state;
   case MLN_REDUCE:
-    return ap->x.rule->index + melon->nstate;
+    return (long)ap->x.rule + melon->nstate;
   case MLN_ERROR:
-    return melon->nstate + melon->nrule;
+    return (long)melon->nstate + melon->nrule;
   case MLN_ACCEPT:
-    return melon->nstate + melon->nrule + 1;
+    return (long)melon->nstate + melon->nrule + 1;
   default:
     return -1;
   }
@@ -319,40 +445,156 @@ static void MlnTplPrint(FILE *out, Melon *melon, const char *str, int str_line,
 }
 
 /*
- * The following routine emits code for the destructor for the symbol sym
+ * The body of a case of a switch in the generated code, as it is
+ * emitted but without the #line directives, so that the cases with
+ * the same body can share it.
+ */
+typedef struct MlnCaseBody {
+  char *code;    /* User code with its macros replaced, NULL if none */
+  int code_line; /* Line of the code in the grammar */
+  char *tail;    /* Generated statements following the code */
+  unsigned hash; /* Hash of the code and the tail */
+  MlnHeat heat;  /* Only cases of the same heat share a body */
+  int next;      /* Next case with the same body, -1 if none */
+  int shared;    /* Non-zero if an earlier case has the same body */
+} MlnCaseBody;
+
+/*
+ * Hash a string, NULL included, into a running FNV-1a hash.
+ */
+static unsigned MlnCaseHash(unsigned h, const char *s) {
+  if (s == NULL) {
+    return h * 0x01000193;
+  }
+  do {
+    h ^= (unsigned char)*s;
+    h *= 0x01000193;
+  } while (*s++ != '\0');
+  return h;
+}
+
+static int MlnCaseBodyEqual(const MlnCaseBody *a, const MlnCaseBody *b) {
+  if (a->hash != b->hash || a->heat != b->heat ||
+      (a->code == NULL) != (b->code == NULL)) {
+    return 0;
+  }
+  return (a->code == NULL || strcmp(a->code, b->code) == 0) &&
+         strcmp(a->tail, b->tail) == 0;
+}
+
+/*
+ * Chain together the cases with the same body, each to the first of
+ * them, and return the number of bodies saved. Only the first case of
+ * a chain keeps the texts of its body.
+ */
+static int MlnShareCaseBodies(MlnCaseBody *bodies, int n) {
+  int *slots, *last;
+  int i, k, size, nmerge;
+
+  for (size = 16; size < 2 * n; size *= 2) {
+  }
+  slots = malloc(sizeof(int) * size);
+  last = malloc(sizeof(int) * (n + 1));
+  MlnMemoryCheck(slots);
+  MlnMemoryCheck(last);
+  for (k = 0; k < size; k++) {
+    slots[k] = -1;
+  }
+  nmerge = 0;
+  for (i = 0; i < n; i++) {
+    MlnCaseBody *body = &bodies[i];
+    body->hash = MlnCaseHash(MlnCaseHash(0x811C9DC5, body->code), body->tail);
+    body->next = -1;
+    body->shared = 0;
+    for (k = body->hash & (size - 1); slots[k] >= 0; k = (k + 1) & (size - 1)) {
+      if (MlnCaseBodyEqual(&bodies[slots[k]], body)) {
+        break;
+      }
+    }
+    if (slots[k] < 0) {
+      slots[k] = i;
+      last[i] = i;
+    } else {
+      int first = slots[k];
+      bodies[last[first]].next = i;
+      last[first] = i;
+      body->shared = 1;
+      free(body->code);
+      free(body->tail);
+      nmerge++;
+    }
+  }
+  free(last);
+  free(slots);
+  return nmerge;
+}
+
+/*
+ * Write the body of a case, with #line directives around the user code
+ * so that errors point into the grammar. Keep lineno up to date, and
+ * free the texts of the body.
+ */
+static void MlnWriteCaseBody(FILE *out, Melon *melon, MlnCaseBody *body,
+                             int *lineno) {
+  const char *cp;
+  if (body->code != NULL) {
+    fprintf(out, "#line %d \"%s\"\n{", body->code_line, melon->filename);
+    for (cp = body->code; *cp != '\0'; cp++) {
+      if (*cp == '\n') {
+        (*lineno)++;
+      }
+    }
+    fputs(body->code, out);
+    (*lineno) += 3;
+    fprintf(out, "}\n#line %d \"%s\"\n", *lineno, melon->output_file);
+  }
+  for (cp = body->tail; *cp != '\0'; cp++) {
+    if (*cp == '\n') {
+      (*lineno)++;
+    }
+  }
+  fputs(body->tail, out);
+  free(body->code);
+  free(body->tail);
+}
+
+/*
+ * Translate the destructor of the symbol "sym" into "body".
  */
-static void MlnEmitDestructorCode(FILE *out, MlnSymbol *sym, Melon *melon,
-                                  int *lineno) {
+static void MlnTranslateDestructor(MlnSymbol *sym, Melon *melon,
+                                   MlnCaseBody *body) {
   char *cp = NULL;
+  FILE *out;
+  size_t len;
+
   if (sym->type == MLN_SYM_TERMINAL) {
     cp = melon->token_dest;
-    if (cp == NULL) {
-      return;
-    }
-    fprintf(out, "#line %d \"%s\"\n{", melon->token_dest_line, melon->filename);
+    body->code_line = melon->token_dest_line;
   } else if (sym->destructor != NULL) {
     cp = sym->destructor;
-    fprintf(out, "#line %d \"%s\"\n{", sym->destructor_line, melon->filename);
+    body->code_line = sym->destructor_line;
   } else if (melon->var_dest != NULL) {
     cp = melon->var_dest;
-    fprintf(out, "#line %d \"%s\"\n{", melon->var_dest_line, melon->filename);
+    body->code_line = melon->var_dest_line;
   } else {
     assert(0); /* Cannot happen */
   }
 
+  out = open_memstream(&body->code, &len);
+  MlnMemoryCheck(out);
   for (; *cp != '\0'; cp++) {
     if (*cp == '$' && cp[1] == '$') {
       fprintf(out, "(yypminor->yy%d)", sym->data_type_num);
       cp++;
       continue;
     }
-    if (*cp == '\n') {
-      (*lineno)++;
-    }
     fputc(*cp, out);
   }
-  (*lineno) += 3;
-  fprintf(out, "}\n#line %d \"%s\"\n", *lineno, melon->output_file);
+  fclose(out);
+  body->tail = malloc(1);
+  MlnMemoryCheck(body->tail);
+  body->tail[0] = '\0';
+  body->heat = MLN_HEAT_NORMAL;
 }
 
 /*
@@ -423,47 +665,41 @@ void MlnReportOutput(Melon *melon) {
   }
 
   for (i = 0; i < melon->nstate; i++) {
-    MlnConfig *cfp;
-    MlnAction *ap;
+    int j;
     MlnState *state = melon->sorted[i];
+    MlnCompactConfig *cfp = &melon->configs[state->cfg_first];
+    MlnCompactConfig *end = cfp + state->ncfg;
     fprintf(fp, "State %d:\n", state->index);
-    if (melon->basis_flag) {
-      cfp = state->bp;
-    } else {
-      cfp = state->cfp;
-    }
-    while (cfp != NULL) {
+    for (; cfp < end; cfp++) {
       char buf[20];
+      if (melon->basis_flag && !cfp->is_basis) {
+        continue;
+      }
       if (cfp->dot == cfp->rule->nrhs) {
         sprintf(buf, "(%d)", cfp->rule->index);
         fprintf(fp, "%9s ", buf);
       } else {
         fprintf(fp, "%10s", "");
       }
-      MlnConfigPrint(fp, cfp);
+      MlnConfigPrint(fp, cfp->rule, cfp->dot);
       fprintf(fp, "\n");
 #ifdef TEST
-      MlnSetPrint(fp, cfp->fws, melon);
-      MlnPLinkPrint(fp, cfp->fpl, "To  ");
-      MlnPLinkPrint(fp, cfp->bpl, "From");
-#endif
-      if (melon->basis_flag) {
-        cfp = cfp->bp;
-      } else {
-        cfp = cfp->next;
+      if (cfp->fws != NULL) { /* Not kept in the automaton cache */
+        MlnSetPrint(fp, cfp->fws, melon);
       }
+#endif
     }
 
     fprintf(fp, "\n");
-    for (ap = state->ap; ap != NULL; ap = ap->next) {
-      if (MlnPrintAction(ap, fp, 30)) {
+    for (j = 0; j < state->nap; j++) {
+      if (MlnPrintAction(melon, &state->ap[j], fp, 30)) {
         fprintf(fp, "\n");
       }
     }
     fprintf(fp, "\n");
   }
 
-  fclose(fp);
+  MlnFileClose(melon, fp);
   return;
 }
 
@@ -479,18 +715,28 @@ static int MlnHasDestructor(MlnSymbol *sym, Melon *melon) {
 }
 
 /*
- * Generate code which executes when the rule "rule" is reduced.
- * Write the code to "out", Make sure lineno stays up-to-date.
+ * Translate the code which executes when the rule "rule" is reduced
+ * into "body": the labels become references to the stack, and the
+ * symbols without a label are destroyed after the code.
  */
-void MlnEmitCode(FILE *out, MlnRule *rule, Melon *melon, int *lineno) {
-  char used[MLN_MAX_RHS] = {0};
+static void MlnTranslateCode(MlnRule *rule, Melon *melon, MlnCaseBody *body) {
+  char *used; /* True for each RHS label referenced by the code */
   char *cp;
+  FILE *out;
+  size_t len;
   int i;
   int lhs_used = 0;
 
+  used = calloc(rule->nrhs > 0 ? rule->nrhs : 1, sizeof(char));
+  MlnMemoryCheck(used);
+
   /* Generate code to do the reduce action */
+  body->code = NULL;
+  body->code_line = rule->line;
+  body->heat = rule->lhs->heat;
   if (rule->code != NULL) {
-    fprintf(out, "#line %d \"%s\"\n{", rule->line, melon->filename);
+    out = open_memstream(&body->code, &len);
+    MlnMemoryCheck(out);
     for (cp = rule->code; *cp != '\0'; cp++) {
       if (isalpha(*cp) &&
           (cp == rule->code || (!isalnum(cp[-1]) && cp[-1] != '_'))) {
@@ -518,13 +764,9 @@ void MlnEmitCode(FILE *out, MlnRule *rule, Melon *melon, int *lineno) {
         }
         *xp = saved;
       }
-      if (*cp == '\n') {
-        (*lineno)++;
-      }
       fputc(*cp, out);
     }
-    (*lineno) += 3;
-    fprintf(out, "}\n#line %d \"%s\"\n", *lineno, melon->output_file);
+    fclose(out);
   }
 
   /* Check to make sure the LHS has been used */
@@ -537,26 +779,95 @@ void MlnEmitCode(FILE *out, MlnRule *rule, Melon *melon, int *lineno) {
 
   /*
    * Generate destructor code for RHS symbols which are not used in the
-   * reduce code.
+   * reduce code. Nothing is said of the symbols without a destructor,
+   * which would keep rules with the same code from sharing it.
    */
+  out = open_memstream(&body->tail, &len);
+  MlnMemoryCheck(out);
   for (i = 0; i < rule->nrhs; i++) {
     if (rule->rhs_alias[i] != NULL && !used[i]) {
       MlnErrorMsg(melon->filename, rule->rule_line,
                   "Label \"%s\" for \"%s(%s)\" is never used.",
                   rule->rhs_alias[i], rule->rhs[i]->name, rule->rhs_alias[i]);
       melon->error_cnt++;
-    } else if (rule->rhs_alias[i] == NULL) {
-      if (MlnHasDestructor(rule->rhs[i], melon)) {
-        fprintf(out, "  yy_destructor(%d, &yymsp[%d].minor);\n",
-                rule->rhs[i]->index, i - rule->nrhs + 1);
-        (*lineno)++;
-      } else {
-        fprintf(out, "        /* No destructor defined for %s */\n",
-                rule->rhs[i]->name);
+    } else if (rule->rhs_alias[i] == NULL &&
+               MlnHasDestructor(rule->rhs[i], melon)) {
+      fprintf(out, "  yy_destructor(%d, &yymsp[%d].minor);\n",
+              rule->rhs[i]->index, i - rule->nrhs + 1);
+    }
+  }
+  fclose(out);
+  free(used);
+}
+
+/*
+ * Write the switch which applies "op" to the member of the union of a
+ * C++ parser holding the value of the symbol "yymajor". Every "%d" of
+ * "op" is the number of the member, yy0 for the tokens and the symbols
+ * without a type.
+ */
+static void MlnWriteValueSwitch(FILE *out, Melon *melon, char **types,
+                                int type_size, const char *op,
+                                int *lineno) {
+  int i, k, num;
+
+  fprintf(out, "    switch (yymajor) {\n");
+  (*lineno)++;
+  for (i = 0; i <= type_size; i++) {
+    if (i < type_size && types[i] == NULL) {
+      continue;
+    }
+    num = i < type_size ? i + 1 : melon->err_sym->data_type_num;
+    for (k = 0; k < melon->nsymbol; k++) {
+      if (melon->symbols[k]->data_type_num == num) {
+        fprintf(out, "      case %d:\n", melon->symbols[k]->index);
         (*lineno)++;
       }
     }
+    fprintf(out, "        ");
+    fprintf(out, op, num, num, num);
+    fprintf(out, "\n        break;\n");
+    *lineno += 2;
   }
+  fprintf(out, "      default:\n        ");
+  fprintf(out, op, 0, 0, 0);
+  fprintf(out, "\n        break;\n    }\n");
+  *lineno += 4;
+}
+
+/*
+ * Write the members of the union of a C++ parser which manage the
+ * lifetime of its values. The union is raw storage, sized and aligned
+ * for every type, in which the values of any C++ type are constructed
+ * in place, moved from slot to slot and destroyed by the type of their
+ * symbol.
+ */
+static void MlnWriteValueOps(FILE *out, Melon *melon, const char *name,
+                             char **types, int type_size, int *lineno) {
+  fprintf(out, "\n  %sMinor() {}\n", name);
+  fprintf(out, "  ~%sMinor() {}\n\n", name);
+  fprintf(out, "  /* Construct the value of the symbol \"yymajor\" */\n");
+  fprintf(out, "  void yy_construct(int yymajor) {\n");
+  *lineno += 6;
+  MlnWriteValueSwitch(out, melon, types, type_size,
+                      "::new (static_cast<void *>(&yy%d)) decltype(yy%d)();",
+                      lineno);
+  fprintf(out, "  }\n\n");
+  fprintf(out, "  /* Move the value of the symbol \"yymajor\" in place */\n");
+  fprintf(out, "  void yy_move(int yymajor, %sMinor *yyfrom) {\n", name);
+  *lineno += 4;
+  MlnWriteValueSwitch(out, melon, types, type_size,
+                      "::new (static_cast<void *>(&yy%d)) "
+                      "decltype(yy%d)(std::move(yyfrom->yy%d));",
+                      lineno);
+  fprintf(out, "  }\n\n");
+  fprintf(out, "  /* Destroy the value of the symbol \"yymajor\" */\n");
+  fprintf(out, "  void yy_destroy(int yymajor) {\n");
+  *lineno += 4;
+  MlnWriteValueSwitch(out, melon, types, type_size,
+                      "std::destroy_at(&yy%d);", lineno);
+  fprintf(out, "  }\n");
+  (*lineno)++;
 }
 
 /*
@@ -564,7 +875,9 @@ void MlnEmitCode(FILE *out, MlnRule *rule, Melon *melon, int *lineno) {
  * This union contains fields for every possible data type for tokens
  * and nonterminals. In the process of computing and printing this
  * union, also set the ".data_type_num" filed of every terminal and
- * nonterminal symbol.
+ * nonterminal symbol. For a C++ parser, the union is a template over
+ * the type of the tokens, which the parser class is instantiated with,
+ * and manages the lifetime of the values itself.
  */
 static void MlnPrintStackUnion(FILE *out, Melon *melon, int *lineno,
                                int mhflag) {
@@ -573,7 +886,7 @@ static void MlnPrintStackUnion(FILE *out, Melon *melon, int *lineno,
   int max_dt_len; /* Maximum length of any ".data_type" filed */
   char *stddt;    /* Standardized name for a datatype */
   char *name;     /* Name of the parser */
-  int hash;       /* For hashing the name of a type */
+  unsigned hash;  /* For hashing the name of a type */
   int i, j;       /* Loop counters */
 
   /* Allocate and initialize types[] and allocate stddt[]. */
@@ -595,10 +908,8 @@ static void MlnPrintStackUnion(FILE *out, Melon *melon, int *lineno,
     }
   }
   stddt = malloc(max_dt_len * 2 + 1);
-  if (types == NULL || stddt == NULL) {
-    fprintf(stderr, "Out of memory.\n");
-    exit(1);
-  }
+  MlnMemoryCheck(types);
+  MlnMemoryCheck(stddt);
 
   /*
    * Build a hash table of datatypes. The ".data_type_num" field of
@@ -639,7 +950,7 @@ static void MlnPrintStackUnion(FILE *out, Melon *melon, int *lineno,
     for (j = 0; stddt[j]; j++) {
       hash = hash * 53 + stddt[j];
     }
-    hash = (hash & 0x7FFFFFFF) % type_size;
+    hash = hash % type_size;
     while (types[hash] != NULL) {
       if (strcmp(types[hash], stddt) == 0) {
         sp->data_type_num = hash + 1;
@@ -653,10 +964,7 @@ static void MlnPrintStackUnion(FILE *out, Melon *melon, int *lineno,
     if (types[hash] == NULL) {
       sp->data_type_num = hash + 1;
       types[hash] = malloc(strlen(stddt) + 1);
-      if (types[hash] == NULL) {
-        fprintf(stderr, "Out of memory.\n");
-        exit(1);
-      }
+      MlnMemoryCheck(types[hash]);
       strcpy(types[hash], stddt);
     }
   }
@@ -667,29 +975,50 @@ static void MlnPrintStackUnion(FILE *out, Melon *melon, int *lineno,
     fprintf(out, "#if INTERFACE\n");
     (*lineno)++;
   }
-  fprintf(out, "#define %sTOKENTYPE %s\n", name,
-          melon->token_type ? melon->token_type : "void *");
-  (*lineno)++;
+  if (melon->token_type == NULL && melon->regex != NULL) {
+    /* The minor tokens of the scanner are the bytes they match */
+    fprintf(out, "typedef struct %sLexeme {\n", name);
+    fprintf(out, "  const char *z;\n");
+    fprintf(out, "  int n;\n");
+    fprintf(out, "} %sLexeme;\n", name);
+    fprintf(out, "#define %sTOKENTYPE %sLexeme\n", name, name);
+    *lineno += 5;
+  } else {
+    fprintf(out, "#define %sTOKENTYPE %s\n", name,
+            melon->token_type ? melon->token_type : "void *");
+    (*lineno)++;
+  }
   if (mhflag) {
     fprintf(out, "#endif /* INTERFACE */\n");
     (*lineno)++;
   }
-  fprintf(out, "typedef union {\n");
-  (*lineno)++;
-  fprintf(out, "  %sTOKENTYPE yy0;\n", name);
-  (*lineno)++;
+  if (melon->cplusplus) {
+    fprintf(out, "template <typename TokenT>\n");
+    fprintf(out, "union %sMinor {\n", name);
+    fprintf(out, "  TokenT yy0;\n");
+    *lineno += 3;
+  } else {
+    fprintf(out, "typedef union {\n");
+    fprintf(out, "  %sTOKENTYPE yy0;\n", name);
+    *lineno += 2;
+  }
   for (i = 0; i < type_size; i++) {
     if (types[i] == NULL) {
       continue;
     }
     fprintf(out, "  %s yy%d;\n", types[i], i + 1);
     (*lineno)++;
-    free(types[i]);
   }
   fprintf(out, "  int yy%d;\n", melon->err_sym->data_type_num);
   (*lineno)++;
-  fprintf(out, "} YYMINORTYPE;\n");
+  if (melon->cplusplus) {
+    MlnWriteValueOps(out, melon, name, types, type_size, lineno);
+  }
+  fprintf(out, melon->cplusplus ? "};\n" : "} YYMINORTYPE;\n");
   (*lineno)++;
+  for (i = 0; i < type_size; i++) {
+    free(types[i]);
+  }
   free(stddt);
   free(types);
 }
@@ -698,21 +1027,220 @@ static void MlnPrintStackUnion(FILE *out, Melon *melon, int *lineno,
  * Return the name of a C data type able to represent values between
  * lwr and upr, inclusive.
  */
-static const char *MlnMinimumSizeType(int lwr, int upr) {
+static const char *MlnMinimumSizeType(long long lwr, long long upr) {
   if (lwr >= 0) {
     if (upr <= 0xFF) {
       return "unsigned char";
     } else if (upr < 0xFFFF) {
       return "unsigned short";
-    } else {
+    } else if (upr <= 0xFFFFFFFFLL) {
       return "unsigned";
+    } else {
+      return "unsigned long long";
     }
-  } else if (lwr >= -0xFF && upr <= 0xFF) {
+  } else if (lwr >= -0x7F && upr <= 0x7F) {
     return "signed char";
-  } else if (lwr >= -0xFFFF && upr <= 0xFFFF) {
+  } else if (lwr >= -0x7FFF && upr <= 0x7FFF) {
     return "short";
-  } else {
+  } else if (lwr >= -0x7FFFFFFFLL && upr <= 0x7FFFFFFFLL) {
     return "int";
+  } else {
+    return "long long";
+  }
+}
+
+/*
+ * Return the size in bytes of the type MlnMinimumSizeType() picks for
+ * values between 0 and upr.
+ */
+static int MlnMinimumSize(long long upr) {
+  if (upr <= 0xFF) {
+    return 1;
+  } else if (upr < 0xFFFF) {
+    return 2;
+  } else if (upr <= 0xFFFFFFFFLL) {
+    return 4;
+  }
+  return 8;
+}
+
+/*
+ * Where the parse tables go: their definitions to "def", and the
+ * macros reading them to "out". Both are the .c file, unless the
+ * parser is split: then "def" collects the tables file, and "out" is
+ * the shared header, which also declares the tables under external
+ * names starting with "prefix".
+ */
+typedef struct MlnTableOut {
+  FILE *out;           /* The macros, and the declarations if split */
+  int *line_no;        /* Line number in "out" */
+  FILE *def;           /* The definitions */
+  int *def_line;       /* Line number in "def" */
+  const char *prefix;  /* Prefix of the external names, NULL if static */
+  const char *storage; /* Storage class of the static tables */
+} MlnTableOut;
+
+/*
+ * The storage class of the tables. The tables of a C++ parser are
+ * constexpr members of its class, which the compiler can fold.
+ */
+static const char *MlnTableStorage(Melon *melon) {
+  return melon->cplusplus ? "static constexpr" : "static";
+}
+
+/*
+ * Start the definition of the table "name" of the given type, up to
+ * the "=". A table shared by the files of a split parser is declared
+ * in the header first.
+ */
+static void MlnTableBegin(MlnTableOut *to, const char *type,
+                          const char *name) {
+  if (to->prefix != NULL) {
+    fprintf(to->out, "#define %s %s_%s\n", name, to->prefix, name);
+    fprintf(to->out, "extern %s %s[];\n", type, name);
+    *to->line_no += 2;
+    fprintf(to->def, "%s %s[] =", type, name);
+  } else {
+    fprintf(to->def, "%s %s %s[] =", to->storage, type, name);
+  }
+}
+
+/*
+ * Write the values of a table as the array "name" of the given type,
+ * ten to a line, each line led by the index of its first value.
+ */
+static void MlnWriteArray(MlnTableOut *to, const char *type,
+                          const char *name, const long *values, long n) {
+  FILE *out = to->def;
+  long i;
+  int j;
+  MlnTableBegin(to, type, name);
+  fprintf(out, " {\n");
+  (*to->def_line)++;
+  for (i = 0, j = 0; i < n; i++) {
+    if (j == 0) {
+      fprintf(out, " /* %5ld */ ", i);
+    }
+    fprintf(out, " %4ld,", values[i]);
+    if (j == 9 || i == n - 1) {
+      fprintf(out, "\n");
+      (*to->def_line)++;
+      j = 0;
+    } else {
+      j++;
+    }
+  }
+  fprintf(out, "};\n");
+  (*to->def_line)++;
+}
+
+/*
+ * Store "value" at "bytes" in "size" bytes, least significant first.
+ */
+static void MlnPackValue(unsigned char *bytes, long value, int size) {
+  int k;
+  for (k = 0; k < size; k++) {
+    bytes[k] = (unsigned char)((unsigned long long)value >> (8 * k));
+  }
+}
+
+/*
+ * Write "n" bytes as the string literal initializing the array "name".
+ * Printable characters stand for themselves and the other bytes are
+ * octal escapes, so the compiler scans a few characters per byte
+ * instead of parsing a number.
+ */
+static void MlnWritePacked(MlnTableOut *to, const char *name,
+                           const unsigned char *bytes, long n) {
+  FILE *out = to->def;
+  long i;
+  int col, octal;
+  MlnTableBegin(to, "const unsigned char", name);
+  fprintf(out, "\n");
+  (*to->def_line)++;
+  if (n == 0) {
+    fprintf(out, "  \"\";\n");
+    (*to->def_line)++;
+  }
+  for (i = 0, col = 0, octal = 0; i < n; i++) {
+    int c = bytes[i];
+    if (col == 0) {
+      col = fprintf(out, "  \"");
+    }
+    /* A digit after an octal escape would extend it */
+    if (c >= ' ' && c <= '~' && c != '"' && c != '\\' && c != '?' &&
+        !(octal && c >= '0' && c <= '7')) {
+      putc(c, out);
+      col++;
+      octal = 0;
+    } else {
+      col += fprintf(out, "\\%o", c);
+      octal = 1;
+    }
+    if (col >= 72 || i == n - 1) {
+      fprintf(out, "\"%s\n", i == n - 1 ? ";" : "");
+      (*to->def_line)++;
+      col = 0;
+      octal = 0;
+    }
+  }
+}
+
+/*
+ * Write the macro "macro" reading entry i of the packed table "name",
+ * whose entries of "stride" bytes hold the value at "offset" in "size"
+ * bytes, less "bias".
+ */
+static void MlnWriteUnpack(MlnTableOut *to, const char *macro,
+                           const char *name, int stride, int offset,
+                           int size, long bias) {
+  FILE *out = to->out;
+  const char *type = size > 4 ? "long long" : "int";
+  const char *part = size > 4 ? "unsigned long long" : "unsigned";
+  int k;
+  fprintf(out, "#define %s(i) ((%s)(", macro, type);
+  for (k = 0; k < size; k++) {
+    fprintf(out, "%s(%s)%s[%d * (i)", k > 0 ? " | " : "", part, name,
+            stride);
+    fprintf(out, offset + k > 0 ? " + %d]" : "]", offset + k);
+    if (k > 0) {
+      fprintf(out, " << %d", 8 * k);
+    }
+  }
+  fprintf(out, bias != 0 ? ") - %ld)\n" : "))\n", bias);
+  (*to->line_no)++;
+}
+
+/*
+ * Write a table of "n" values up to "upr", indexed by state or by
+ * symbol, either as an array or packed, and the macro reading it,
+ * which subtracts "bias" from the values.
+ */
+static void MlnWriteStateTable(MlnTableOut *to, Melon *melon,
+                               const char *type, const char *name,
+                               const char *macro, const long *values,
+                               long n, long upr, long bias) {
+  char packed[40];
+  if (melon->pack_tables) {
+    int size = MlnMinimumSize(upr);
+    unsigned char *bytes = malloc((size_t)size * n + 1);
+    long i;
+    MlnMemoryCheck(bytes);
+    for (i = 0; i < n; i++) {
+      MlnPackValue(&bytes[i * size], values[i], size);
+    }
+    snprintf(packed, sizeof(packed), "%s_packed", name);
+    MlnWritePacked(to, packed, bytes, size * n);
+    MlnWriteUnpack(to, macro, packed, size, 0, size, bias);
+    free(bytes);
+  } else {
+    MlnWriteArray(to, type, name, values, n);
+    if (bias != 0) {
+      fprintf(to->out, "#define %s(s) (%s[s] - %ld)\n", macro, name, bias);
+    } else {
+      fprintf(to->out, "#define %s(s) %s[s]\n", macro, name);
+    }
+    (*to->line_no)++;
   }
 }
 
@@ -737,59 +1265,712 @@ static int MlnAxSetCompare(const void *a, const void *b) {
 }
 
 /*
- * Generate C source code for the parser.
+ * The column of the action table of a terminal: the pairs of state and
+ * action for the states in which it has an action, by state.
  */
-void MlnReportTable(Melon *melon, int mhflag) {
-  char *name;
-  char line[kLineSize];
-  FILE *in, *out;
-  int line_no;
-  int i, j, n;
-  int min_tkn_offset, max_tkn_offset;
-  int min_ntkn_offset, max_ntkn_offset;
-  MlnAxSet *ax;
-  MlnActionTable *at;
-  MlnRule *rule;
+typedef struct MlnColumn {
+  int sym;           /* The terminal */
+  int n;             /* Number of pairs */
+  const long *pairs; /* The pairs */
+} MlnColumn;
+
+static int MlnColumnEqual(const MlnColumn *a, const MlnColumn *b) {
+  return a->n == b->n &&
+         memcmp(a->pairs, b->pairs, sizeof(long) * 2 * a->n) == 0;
+}
 
-  in = MlnTplOpen(melon);
-  if (in == NULL) {
-    return;
+static int MlnColumnCmp(const void *a, const void *b) {
+  const MlnColumn *p1 = a, *p2 = b;
+  int i;
+  if (p1->n != p2->n) {
+    return p1->n < p2->n ? -1 : 1;
   }
-  out = MlnFileOpen(melon, ".c", "w");
-  if (out == NULL) {
-    fclose(in);
-    return;
+  for (i = 0; i < 2 * p1->n; i++) {
+    if (p1->pairs[i] != p2->pairs[i]) {
+      return p1->pairs[i] < p2->pairs[i] ? -1 : 1;
+    }
   }
-  line_no = 1;
-  MlnTplXfer(melon->name, in, out, &line_no);
+  return p1->sym - p2->sym;
+}
 
-  /* Generate the include code, if any */
-  MlnTplPrint(out, melon, melon->include, melon->include_line, &line_no);
-  if (mhflag) {
-    name = MlnFileMakeName(melon, ".h");
-    fprintf(out, "#include \"%s\"\n", name);
-    line_no++;
-    free(name);
+/*
+ * Put the terminals with the same actions in every state into one
+ * class, since their columns of the action table are the same. Store
+ * the class of every terminal in token_class[], numbering the classes
+ * in the order of their first terminal, and return their number.
+ */
+static int MlnTokenClasses(Melon *melon, int *token_class) {
+  int nterminal = melon->nterminal;
+  int *first = calloc(nterminal + 1, sizeof(int));
+  int *group = malloc(sizeof(int) * (nterminal + 1));
+  MlnColumn *columns = malloc(sizeof(columns[0]) * (nterminal + 1));
+  long *pairs;
+  int *fill;
+  int i, j, ngroup, nclass;
+
+  MlnMemoryCheck(first);
+  MlnMemoryCheck(group);
+  MlnMemoryCheck(columns);
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap && state->ap[j].sym < nterminal; j++) {
+      if (MlnComputeAction(melon, &state->ap[j]) >= 0) {
+        first[state->ap[j].sym + 1]++;
+      }
+    }
   }
-  MlnTplXfer(melon->name, in, out, &line_no);
-
-  /* Generate #defines for all tokens */
-  if (mhflag) {
-    char *prefix;
-    int i;
-    fprintf(out, "#if INTERFACE\n");
-    line_no++;
-    if (melon->token_prefix) {
-      prefix = melon->token_prefix;
+  for (i = 0; i < nterminal; i++) {
+    first[i + 1] += first[i];
+  }
+  pairs = malloc(sizeof(long) * (2 * (size_t)first[nterminal] + 1));
+  fill = malloc(sizeof(int) * (nterminal + 1));
+  MlnMemoryCheck(pairs);
+  MlnMemoryCheck(fill);
+  memcpy(fill, first, sizeof(int) * nterminal);
+  for (i = 0; i < melon->nstate; i++) {
+    MlnState *state = melon->sorted[i];
+    for (j = 0; j < state->nap && state->ap[j].sym < nterminal; j++) {
+      long action = MlnComputeAction(melon, &state->ap[j]);
+      if (action >= 0) {
+        int k = fill[state->ap[j].sym]++;
+        pairs[2 * k] = i;
+        pairs[2 * k + 1] = action;
+      }
+    }
+  }
+
+  for (i = 0; i < nterminal; i++) {
+    columns[i].sym = i;
+    columns[i].n = first[i + 1] - first[i];
+    columns[i].pairs = &pairs[2 * first[i]];
+  }
+  qsort(columns, nterminal, sizeof(columns[0]), MlnColumnCmp);
+  ngroup = 0;
+  for (i = 0; i < nterminal; i++) {
+    if (i > 0 && !MlnColumnEqual(&columns[i - 1], &columns[i])) {
+      ngroup++;
+    }
+    group[columns[i].sym] = ngroup;
+  }
+
+  /* Number the groups by their first terminal */
+  for (i = 0; i <= ngroup; i++) {
+    fill[i] = -1;
+  }
+  nclass = 0;
+  for (i = 0; i < nterminal; i++) {
+    if (fill[group[i]] < 0) {
+      fill[group[i]] = nclass++;
+    }
+    token_class[i] = fill[group[i]];
+  }
+  free(fill);
+  free(pairs);
+  free(columns);
+  free(group);
+  free(first);
+  return nclass;
+}
+
+/*
+ * Compute the actions of every state, and pack them into an action
+ * table. The rows of the terminals are indexed by their class in
+ * token_class[]. The offsets of the states are set, and "*bias"
+ * receives the padding needed before the first entry of the table.
+ */
+static MlnActionTable *MlnBuildActionTable(Melon *melon, long *bias,
+                                           const int *token_class) {
+  int i;
+  long min_tkn_offset, min_ntkn_offset;
+  int *seen; /* The last row in which each class was entered */
+  MlnAxSet *ax;
+  MlnActionTable *at;
+
+  /* Compute the actions on all states and count them up */
+  ax = malloc(sizeof(ax[0]) * (size_t)melon->nstate * 2);
+  MlnMemoryCheck(ax);
+  seen = malloc(sizeof(int) * (melon->nterminal + 1));
+  MlnMemoryCheck(seen);
+  for (i = 0; i < melon->nterminal; i++) {
+    seen[i] = -1;
+  }
+  for (i = 0; i < melon->nstate; i++) {
+    MlnAction *ap, *end;
+    MlnState *state = melon->sorted[i];
+    state->ntkn_act = 0;
+    state->nntkn_act = 0;
+    state->dflt_act = (long)melon->nstate + melon->nrule;
+    state->tkn_off = MLN_NO_OFFSET;
+    state->ntkn_off = MLN_NO_OFFSET;
+    for (ap = state->ap, end = ap + state->nap; ap < end; ap++) {
+      if (MlnComputeAction(melon, ap) > 0) {
+        if (ap->sym < melon->nterminal) {
+          if (seen[token_class[ap->sym]] != i) {
+            seen[token_class[ap->sym]] = i;
+            state->ntkn_act++;
+          }
+        } else if (ap->sym < melon->nsymbol) {
+          state->nntkn_act++;
+        } else {
+          state->dflt_act = MlnComputeAction(melon, ap);
+        }
+      }
+    }
+    ax[i * 2].state = state;
+    ax[i * 2].is_token = 1;
+    ax[i * 2].naction = state->ntkn_act;
+    ax[i * 2 + 1].state = state;
+    ax[i * 2 + 1].is_token = 0;
+    ax[i * 2 + 1].naction = state->nntkn_act;
+  }
+  min_tkn_offset = 0;
+  min_ntkn_offset = 0;
+
+  /*
+   * Compute the action table. In order to try to keep the size of the
+   * action table to a minimum, the heuristic of placing the largest
+   * action sets first is used.
+   */
+  qsort(ax, (size_t)melon->nstate * 2, sizeof(ax[0]), MlnAxSetCompare);
+  at = MlnActionTableAlloc();
+  for (i = 0; i < melon->nstate * 2 && ax[i].naction > 0; i++) {
+    MlnAction *ap, *end;
+    MlnState *state = ax[i].state;
+    end = state->ap + state->nap;
+    if (ax[i].is_token) {
+      /* Terminals sort first, so stop at the first non-terminal. The
+       * terminals of a class have the same action, entered once. */
+      for (ap = state->ap; ap < end && ap->sym < melon->nterminal; ap++) {
+        long action = MlnComputeAction(melon, ap);
+        if (action < 0 || seen[token_class[ap->sym]] == melon->nstate + i) {
+          continue;
+        }
+        seen[token_class[ap->sym]] = melon->nstate + i;
+        MlnActionTableAddAction(at, token_class[ap->sym], action);
+      }
+      state->tkn_off = MlnActionTableInsert(at);
+      if (state->tkn_off < min_tkn_offset) {
+        min_tkn_offset = state->tkn_off;
+      }
+    } else {
+      for (ap = state->ap; ap < end && ap->sym < melon->nsymbol; ap++) {
+        long action;
+        if (ap->sym < melon->nterminal) {
+          continue;
+        }
+        action = MlnComputeAction(melon, ap);
+        if (action < 0) {
+          continue;
+        }
+        MlnActionTableAddAction(at, ap->sym, action);
+      }
+      state->ntkn_off = MlnActionTableInsert(at);
+      if (state->ntkn_off < min_ntkn_offset) {
+        min_ntkn_offset = state->ntkn_off;
+      }
+    }
+  }
+  free(seen);
+  free(ax);
+
+  /* The bias makes every offset non-negative. With --pad, the table is
+   * also padded by as much before its entries, and by YYNOCODE after,
+   * so that the offset of every state plus any lookahead is within it.
+   * The states without actions get the offset just past the entries,
+   * where no lookahead matches, so their lookups fall to yy_default[]. */
+  *bias = -(min_tkn_offset < min_ntkn_offset ? min_tkn_offset
+                                             : min_ntkn_offset);
+  return at;
+}
+
+/*
+ * Return the size of the action table of the automaton, as
+ * MlnReportTable() would generate it.
+ */
+long MlnActionTableCost(Melon *melon) {
+  long bias, n;
+  int *token_class = malloc(sizeof(int) * (melon->nterminal + 1));
+  MlnActionTable *at;
+  MlnMemoryCheck(token_class);
+  MlnTokenClasses(melon, token_class);
+  at = MlnBuildActionTable(melon, &bias, token_class);
+  n = MlnActionTableSize(at);
+  if (melon->pad_tables) {
+    n += bias + melon->nsymbol + 2;
+  }
+  MlnActionTableFree(at);
+  free(token_class);
+  return n;
+}
+
+/* The translated actions of a range of rules */
+typedef struct MlnReduceCases {
+  MlnRule **rules;     /* The rules */
+  MlnCaseBody *bodies; /* The body of the case of each rule */
+  int n;               /* Number of rules */
+} MlnReduceCases;
+
+/*
+ * Translate the actions of the rules from "rule" on, up to the rule
+ * numbered "end", and return the rule after them. The rules with the
+ * same code after translation share a case.
+ */
+static MlnRule *MlnReduceCasesInit(MlnReduceCases *rc, Melon *melon,
+                                   MlnRule *rule, int end) {
+  MlnRule *rp;
+  int i;
+
+  rc->n = 0;
+  for (rp = rule; rp != NULL && rp->index < end; rp = rp->next) {
+    rc->n++;
+  }
+  rc->bodies = malloc(sizeof(rc->bodies[0]) * (rc->n + 1));
+  rc->rules = malloc(sizeof(rc->rules[0]) * (rc->n + 1));
+  MlnMemoryCheck(rc->bodies);
+  MlnMemoryCheck(rc->rules);
+  for (i = 0; i < rc->n; i++, rule = rule->next) {
+    rc->rules[i] = rule;
+    MlnTranslateCode(rule, melon, &rc->bodies[i]);
+  }
+  melon->nmerge_action += MlnShareCaseBodies(rc->bodies, rc->n);
+  return rule;
+}
+
+/*
+ * Write the actions of the rules of %cold and %hot non-terminals as
+ * functions of their own, named after the first rule sharing them.
+ */
+static void MlnWriteRuleFunctions(FILE *out, Melon *melon,
+                                  MlnReduceCases *rc, int *line_no) {
+  const char *name = melon->name ? melon->name : "Parse";
+  int i;
+  for (i = 0; i < rc->n; i++) {
+    MlnCaseBody *body = &rc->bodies[i];
+    if (body->shared || body->heat == MLN_HEAT_NORMAL) {
+      continue;
+    }
+    fprintf(out, "%s static void yy_rule_%d(yyParser *yypParser,\n",
+            body->heat == MLN_HEAT_COLD ? "YY_COLD" : "YY_HOT",
+            rc->rules[i]->index);
+    fprintf(out, "    yyStackEntry *yymsp, YYMINORTYPE *yylhs) {\n");
+    fprintf(out, "#define yygotominor (*yylhs)\n");
+    fprintf(out, "  %sARG_FETCH;\n", name);
+    fprintf(out, "  (void)yymsp;\n  (void)yylhs;\n");
+    *line_no += 6;
+    MlnWriteCaseBody(out, melon, body, line_no);
+    fprintf(out, "#undef yygotominor\n}\n\n");
+    *line_no += 3;
+  }
+}
+
+/*
+ * Write the cases of the reduce switch, and free the actions.
+ */
+static void MlnWriteReduceCases(FILE *out, Melon *melon, MlnReduceCases *rc,
+                                int *line_no) {
+  int i, j;
+  for (i = 0; i < rc->n; i++) {
+    MlnCaseBody *body = &rc->bodies[i];
+    if (body->shared) {
+      continue;
+    }
+    for (j = i; j >= 0; j = rc->bodies[j].next) {
+      fprintf(out, "      case %d:\n", rc->rules[j]->index);
+      (*line_no)++;
+    }
+    if (body->heat == MLN_HEAT_NORMAL) {
+      MlnWriteCaseBody(out, melon, body, line_no);
+    } else {
+      fprintf(out, "        yy_rule_%d(yypParser, yymsp, &yygotominor);\n",
+              rc->rules[i]->index);
+      (*line_no)++;
+    }
+    fprintf(out, "        break;\n");
+    (*line_no)++;
+  }
+  free(rc->rules);
+  free(rc->bodies);
+}
+
+/*
+ * Write the cases of the destructor switch. The terminals share the
+ * %token_destructor, the non-terminals without a destructor of their
+ * own share the %default_destructor, and the destructors with the same
+ * code after translation share a case.
+ */
+static void MlnWriteDestructorCases(FILE *out, Melon *melon, int *line_no) {
+  MlnSymbol **members; /* The symbols of every destructor */
+  int *first;          /* Start of the symbols of each destructor */
+  MlnCaseBody *bodies;
+  int i, j, k, n, ndest;
+
+  members = malloc(sizeof(members[0]) * (melon->nsymbol + 1));
+  first = malloc(sizeof(int) * (melon->nsymbol + 3));
+  bodies = malloc(sizeof(bodies[0]) * (melon->nsymbol + 2));
+  MlnMemoryCheck(members);
+  MlnMemoryCheck(first);
+  MlnMemoryCheck(bodies);
+
+  n = 0;
+  ndest = 0;
+  if (melon->token_dest != NULL) {
+    first[ndest] = n;
+    for (i = 0; i < melon->nsymbol; i++) {
+      if (melon->symbols[i]->type == MLN_SYM_TERMINAL) {
+        members[n++] = melon->symbols[i];
+      }
+    }
+    ndest += n > first[ndest];
+  }
+  for (i = 0; i < melon->nsymbol; i++) {
+    MlnSymbol *sp = melon->symbols[i];
+    if (sp->type != MLN_SYM_TERMINAL && sp->destructor != NULL) {
+      first[ndest++] = n;
+      members[n++] = sp;
+    }
+  }
+  if (melon->var_dest != NULL) {
+    first[ndest] = n;
+    for (i = 0; i < melon->nsymbol; i++) {
+      MlnSymbol *sp = melon->symbols[i];
+      if (sp->type != MLN_SYM_TERMINAL && sp->index > 0 &&
+          sp->destructor == NULL) {
+        members[n++] = sp;
+      }
+    }
+    ndest += n > first[ndest];
+  }
+  first[ndest] = n;
+
+  for (k = 0; k < ndest; k++) {
+    MlnTranslateDestructor(members[first[k]], melon, &bodies[k]);
+  }
+  melon->nmerge_dest += MlnShareCaseBodies(bodies, ndest);
+  for (k = 0; k < ndest; k++) {
+    if (bodies[k].shared) {
+      continue;
+    }
+    for (j = k; j >= 0; j = bodies[j].next) {
+      for (i = first[j]; i < first[j + 1]; i++) {
+        fprintf(out, "    case %d:\n", members[i]->index);
+        (*line_no)++;
+      }
+    }
+    MlnWriteCaseBody(out, melon, &bodies[k], line_no);
+    fprintf(out, "      break;\n");
+    (*line_no)++;
+  }
+  free(bodies);
+  free(first);
+  free(members);
+}
+
+/*
+ * Generate the perfect hash table of the keywords: the pool of their
+ * spellings, the displacement of every bucket and the slots.
+ */
+static void MlnWriteKeywordTables(FILE *out, Melon *melon,
+                                  MlnKeywordTable *kt, int *line_no) {
+  const char *storage = MlnTableStorage(melon);
+  int i, col;
+
+  fprintf(out, "%s const char yy_keyword_pool[] =\n  \"", storage);
+  col = 0;
+  for (i = 0; i < kt->pool_len; i++) {
+    unsigned char c = (unsigned char)kt->pool[i];
+    if (col >= 64) {
+      fprintf(out, "\"\n  \"");
+      (*line_no)++;
+      col = 0;
+    }
+    if (isprint(c) && c != '\\' && c != '\"' && c != '?') {
+      fputc(c, out);
+      col++;
     } else {
-      prefix = "";
+      fprintf(out, "\\%03o", c);
+      col += 4;
+    }
+  }
+  fprintf(out, "\";\n");
+  fprintf(out, "%s const YYKEYWORDTYPE yy_keyword_disp[] = {\n", storage);
+  *line_no += 3;
+  for (i = 0; i < kt->nbucket; i++) {
+    if ((i % 10) == 0) {
+      fprintf(out, " /* %5d */ ", i);
+    }
+    fprintf(out, " %4d,", kt->disp[i]);
+    if ((i % 10) == 9 || i == kt->nbucket - 1) {
+      fprintf(out, "\n");
+      (*line_no)++;
+    }
+  }
+  fprintf(out, "};\n");
+  fprintf(out, "%s const yyKeyword yy_keyword[] = {\n", storage);
+  *line_no += 2;
+  for (i = 0; i < kt->nslot; i++) {
+    MlnSymbol *sym = kt->slot[i];
+    if (sym == NULL) {
+      fprintf(out, "  {    0,    0,    0},\n");
+    } else {
+      fprintf(out, "  {%5d, %4d, %4d}, /* %s */\n", kt->offset[i],
+              (int)strlen(sym->keyword), sym->index, sym->name);
+    }
+    (*line_no)++;
+  }
+  fprintf(out, "};\n");
+  (*line_no)++;
+}
+
+/*
+ * Generate the tables of the scanner: the class of every byte, the
+ * transitions and the token accepted in every state.
+ */
+static void MlnWriteLexerTables(FILE *out, Melon *melon, MlnLexer *lx,
+                                int *line_no) {
+  const char *storage = MlnTableStorage(melon);
+  int i, n;
+
+  fprintf(out, "%s const unsigned char yy_lex_class[] = {\n", storage);
+  (*line_no)++;
+  for (i = 0; i < 256; i++) {
+    if ((i % 16) == 0) {
+      fprintf(out, " /* %3d */ ", i);
+    }
+    fprintf(out, " %3d,", lx->byte_class[i]);
+    if ((i % 16) == 15) {
+      fprintf(out, "\n");
+      (*line_no)++;
+    }
+  }
+  fprintf(out, "};\n");
+  fprintf(out, "%s const YYLEXSTATETYPE yy_lex_next[] = {\n", storage);
+  *line_no += 2;
+  n = lx->nstate * lx->nclass;
+  for (i = 0; i < n; i++) {
+    if ((i % lx->nclass) == 0) {
+      fprintf(out, " /* %5d */", i / lx->nclass);
+    } else if ((i % lx->nclass) % 10 == 0) {
+      fprintf(out, "\n            ");
+      (*line_no)++;
+    }
+    fprintf(out, " %4d,", lx->next[i]);
+    if ((i % lx->nclass) == lx->nclass - 1) {
+      fprintf(out, "\n");
+      (*line_no)++;
+    }
+  }
+  fprintf(out, "};\n");
+  fprintf(out, "%s const YYCODETYPE yy_lex_accept[] = {\n", storage);
+  *line_no += 2;
+  for (i = 0; i < lx->nstate; i++) {
+    if ((i % 10) == 0) {
+      fprintf(out, " /* %5d */ ", i);
+    }
+    if (lx->accept[i] < 0) {
+      fprintf(out, " YYNOCODE,");
+    } else {
+      fprintf(out, " %4d,", lx->accept[i]);
+    }
+    if ((i % 10) == 9 || i == lx->nstate - 1) {
+      fprintf(out, "\n");
+      (*line_no)++;
+    }
+  }
+  fprintf(out, "};\n");
+  (*line_no)++;
+}
+
+/*
+ * Print the preprocessor "directive" with the include guard of the
+ * header named "header".
+ */
+static void MlnPrintGuard(FILE *out, const char *directive,
+                          const char *header) {
+  const char *cp;
+  fprintf(out, "%s ", directive);
+  for (cp = header; *cp != '\0'; cp++) {
+    putc(isalnum((unsigned char)*cp) ? toupper((unsigned char)*cp) : '_',
+         out);
+  }
+  fprintf(out, "_\n");
+}
+
+/*
+ * Open the file of a split parser with the given suffix, and include
+ * the shared header "header" in it.
+ */
+static FILE *MlnPartOpen(Melon *melon, const char *suffix,
+                         const char *header, int *line_no) {
+  FILE *fp = MlnFileOpenTemp(melon, suffix);
+  if (fp != NULL) {
+    fprintf(fp, "#include \"%s\"\n", header);
+    *line_no = 2;
+  }
+  return fp;
+}
+
+/*
+ * End the shared header of a split parser with the functions called
+ * from one of its files into another: the destructor, and the action
+ * code of every "nchunk" range of rules.
+ */
+static void MlnWriteSharedDecls(FILE *out, Melon *melon, int nchunk,
+                                int *line_no) {
+  const char *name = melon->name ? melon->name : "Parse";
+  int k;
+  fprintf(out, "#define yy_destructor %s_yy_destructor\n", name);
+  fprintf(out, "YY_LINKAGE void yy_destructor(YYCODETYPE yymajor, "
+               "YYMINORTYPE *yypminor);\n");
+  *line_no += 2;
+  for (k = 0; k < nchunk; k++) {
+    fprintf(out, "void %s_yy_reduce_%d(yyParser *yypParser, int yyruleno,\n",
+            name, k);
+    fprintf(out, "    yyStackEntry *yymsp, YYMINORTYPE *yylhs);\n");
+    *line_no += 2;
+  }
+}
+
+/*
+ * Write the action code of the rules to files of melon->split rules
+ * each, as the functions <name>_yy_reduce_<k>() which yy_reduce()
+ * calls. Return 0 if a file could not be opened.
+ */
+static int MlnWriteActionParts(Melon *melon, const char *header) {
+  const char *name = melon->name ? melon->name : "Parse";
+  MlnRule *rule = melon->rule;
+  MlnReduceCases rc;
+  char suffix[40];
+  FILE *out;
+  int k, end, first, line_no;
+
+  for (k = 0; rule != NULL; k++) {
+    snprintf(suffix, sizeof(suffix), "_act%d.c", k);
+    out = MlnPartOpen(melon, suffix, header, &line_no);
+    if (out == NULL) {
+      return 0;
+    }
+    end = (k + 1) * melon->split;
+    fprintf(out, "\n");
+    line_no++;
+    first = rule->index;
+    rule = MlnReduceCasesInit(&rc, melon, rule, end);
+    MlnWriteRuleFunctions(out, melon, &rc, &line_no);
+    fprintf(out, "/* The actions of the rules %d to %d */\n", first,
+            (end < melon->nrule ? end : melon->nrule) - 1);
+    fprintf(out, "void %s_yy_reduce_%d(yyParser *yypParser, int yyruleno,\n",
+            name, k);
+    fprintf(out, "    yyStackEntry *yymsp, YYMINORTYPE *yylhs) {\n");
+    fprintf(out, "#define yygotominor (*yylhs)\n");
+    fprintf(out, "  %sARG_FETCH;\n", name);
+    fprintf(out, "  switch (yyruleno) {\n");
+    line_no += 6;
+    MlnWriteReduceCases(out, melon, &rc, &line_no);
+    fprintf(out, "  }\n");
+    fprintf(out, "  %sARG_STORE; /* Suppress warning about unused "
+                 "%%extra_argument var */\n",
+            name);
+    fprintf(out, "#undef yygotominor\n}\n");
+    MlnFileCommit(melon, out);
+  }
+  return 1;
+}
+
+/*
+ * Generate C source code for the parser, or with --cxx the C++ header.
+ */
+void MlnReportTable(Melon *melon, int mhflag) {
+  char *name;
+  FILE *in, *out;
+  int line_no;
+  int i, j;
+  int max_nrhs;
+  long k, n;  /* Entries of the action table */
+  long bias;  /* Added to the offsets, so that none is negative */
+  long first; /* Padding before the first entry of the action table */
+  long empty; /* Offset of the states without actions */
+  int la_size;  /* Size of a packed lookahead */
+  int act_size; /* Size of a packed action */
+  long *actions, *lookaheads, *values;
+  int *token_class;
+  int nchunk;         /* Number of files of actions, 0 if not split */
+  char *header_path;  /* The header shared by the files, if split */
+  const char *header; /* Its name, as included by the others */
+  char *tab_buf = NULL;
+  size_t tab_len = 0;
+  int tab_line;
+  MlnTableOut to;
+  MlnReduceCases rc;
+  MlnKeywordTable kt;
+  MlnLexer lx;
+  MlnActionTable *at;
+  MlnRule *rule;
+
+  in = MlnTplOpen(melon);
+  if (in == NULL) {
+    return;
+  }
+  melon->nmerge_action = 0;
+  melon->nmerge_dest = 0;
+  /* A split parser starts with its shared header, which receives what
+   * the template has before the tables. A C++ parser is a single
+   * header, which has the tokens itself. */
+  nchunk = 0;
+  if (melon->cplusplus) {
+    mhflag = 0;
+  } else if (melon->split > 0) {
+    nchunk = (melon->nrule + melon->split - 1) / melon->split;
+  }
+  out = MlnFileOpenTemp(melon, melon->cplusplus
+                                    ? ".hpp"
+                                    : (nchunk > 0 ? "_int.h" : ".c"));
+  if (out == NULL) {
+    fclose(in);
+    return;
+  }
+  line_no = 1;
+  header_path = NULL;
+  header = NULL;
+  if (nchunk > 0) {
+    header_path = MlnFileMakeName(melon, "_int.h");
+    header = strrchr(header_path, '/');
+    header = header != NULL ? header + 1 : header_path;
+    MlnPrintGuard(out, "#ifndef", header);
+    MlnPrintGuard(out, "#define", header);
+    line_no += 2;
+  }
+  MlnTplXfer(melon->name, in, out, &line_no);
+
+  /* Generate the include code, if any */
+  MlnTplPrint(out, melon, melon->include, melon->include_line, &line_no);
+  if (mhflag) {
+    name = MlnFileMakeName(melon, ".h");
+    fprintf(out, "#include \"%s\"\n", name);
+    line_no++;
+    free(name);
+  }
+  MlnTplXfer(melon->name, in, out, &line_no);
+
+  /* Generate #defines for all tokens, or the enumerators of the tokens
+   * of a C++ parser */
+  if (mhflag || melon->cplusplus) {
+    const char *prefix = melon->token_prefix ? melon->token_prefix : "";
+    if (mhflag) {
+      fprintf(out, "#if INTERFACE\n");
+      line_no++;
     }
     for (i = 1; i < melon->nterminal; i++) {
-      fprintf(out, "#define %s%-30s %2d\n", prefix, melon->symbols[i]->name, i);
+      if (mhflag) {
+        fprintf(out, "#define %s%-30s %2d\n", prefix,
+                melon->symbols[i]->name, i);
+      } else {
+        fprintf(out, "    %s%s = %d,\n", prefix, melon->symbols[i]->name, i);
+      }
+      line_no++;
+    }
+    if (mhflag) {
+      fprintf(out, "#endif /* INTERFACE */\n");
       line_no++;
     }
-    fprintf(out, "#endif /* INTERFACE */\n");
-    line_no++;
   }
   MlnTplXfer(melon->name, in, out, &line_no);
 
@@ -800,7 +1981,15 @@ void MlnReportTable(Melon *melon, int mhflag) {
   fprintf(out, "#define YYNOCODE %d\n", melon->nsymbol + 1);
   line_no++;
   fprintf(out, "#define YYACTIONTYPE %s\n",
-          MlnMinimumSizeType(0, melon->nstate + melon->nrule + 5));
+          MlnMinimumSizeType(0, (long long)melon->nstate + melon->nrule + 5));
+  line_no++;
+  max_nrhs = 0;
+  for (rule = melon->rule; rule != NULL; rule = rule->next) {
+    if (rule->nrhs > max_nrhs) {
+      max_nrhs = rule->nrhs;
+    }
+  }
+  fprintf(out, "#define YYNRHSTYPE %s\n", MlnMinimumSizeType(0, max_nrhs));
   line_no++;
   MlnPrintStackUnion(out, melon, &line_no, mhflag);
 
@@ -832,19 +2021,33 @@ void MlnReportTable(Melon *melon, int mhflag) {
     while (i >= 1 && (isalnum(melon->arg[i - 1]) || melon->arg[i - 1] == '_')) {
       i--;
     }
+  }
+  if (melon->cplusplus) {
+    /* The parser class keeps the %extra_argument as a member, of the
+     * type it is instantiated with, by default the declared one */
+    if (melon->arg && melon->arg[0] != '\0') {
+      for (j = i; j >= 1 && isspace(melon->arg[j - 1]); j--) {
+      }
+      fprintf(out, "#define %sARG_TYPE %.*s\n", name, j, melon->arg);
+      fprintf(out, "#define %sARG_NAME %s\n", name, &melon->arg[i]);
+      line_no += 2;
+    }
+  } else if (melon->arg && melon->arg[0] != '\0') {
     fprintf(out, "#define %sARG_SDECL %s;\n", name, melon->arg);
     fprintf(out, "#define %sARG_PDECL ,%s\n", name, melon->arg);
     fprintf(out, "#define %sARG_FETCH %s = yypParser->%s\n", name, melon->arg,
             &melon->arg[i]);
     fprintf(out, "#define %sARG_STORE yypParser->%s = %s\n", name,
             &melon->arg[i], &melon->arg[i]);
-    line_no += 4;
+    fprintf(out, "#define %sARG_PARAM ,%s\n", name, &melon->arg[i]);
+    line_no += 5;
   } else {
     fprintf(out, "#define %sARG_SDECL\n", name);
     fprintf(out, "#define %sARG_PDECL\n", name);
     fprintf(out, "#define %sARG_FETCH\n", name);
     fprintf(out, "#define %sARG_STORE\n", name);
-    line_no += 4;
+    fprintf(out, "#define %sARG_PARAM\n", name);
+    line_no += 5;
   }
   if (mhflag) {
     fprintf(out, "#endif /* INTERFACE */\n");
@@ -862,6 +2065,29 @@ void MlnReportTable(Melon *melon, int mhflag) {
     fprintf(out, "#define YYFALLBACK 1\n");
     line_no++;
   }
+  if (MlnKeywordTableInit(&kt, melon) > 0) {
+    fprintf(out, "#define YYNKEYWORD %d\n", kt.nkeyword);
+    fprintf(out, "#define YYKEYWORDTYPE %s\n",
+            MlnMinimumSizeType(0, kt.pool_len > kt.nslot ? kt.pool_len
+                                                         : kt.nslot));
+    fprintf(out, "#define YYKEYWORDSEED 0x%08Xu\n", kt.seed);
+    fprintf(out, "#define YYNKEYWORDBUCKET %d\n", kt.nbucket);
+    fprintf(out, "#define YYKEYWORDMASK %d\n", kt.nslot - 1);
+    line_no += 5;
+  }
+  melon->nlex_state = MlnLexerBuild(&lx, melon);
+  melon->nlex_class = lx.nclass;
+  if (lx.nstate > 0) {
+    fprintf(out, "#define YYNLEXSTATE %d\n", lx.nstate);
+    fprintf(out, "#define YYNLEXCLASS %d\n", lx.nclass);
+    fprintf(out, "#define YYLEXSTATETYPE %s\n",
+            MlnMinimumSizeType(0, lx.nstate));
+    line_no += 3;
+  }
+  if (nchunk > 0) {
+    fprintf(out, "#define YY_LINKAGE\n");
+    line_no++;
+  }
   MlnTplXfer(melon->name, in, out, &line_no);
 
   /* Generate the action table and its associates:
@@ -874,223 +2100,206 @@ void MlnReportTable(Melon *melon, int mhflag) {
    *  yy_reduce_ofst[]  For each state, the offset into yy_action for
    *                    shifting non-terminals after a reduce.
    *  yy_default[]      Default action for each state.
+   *  yy_token_class[]  The class of every terminal, which indexes the
+   *                    rows of the terminals. Other symbols are their
+   *                    own class. Omitted if every terminal is.
    */
 
-  /* Compute the actions on all states and count them up */
-  ax = malloc(sizeof(ax[0]) * melon->nstate * 2);
-  if (ax == NULL) {
-    fprintf(stderr, "malloc failed\n");
-    exit(1);
-  }
-  for (i = 0; i < melon->nstate; i++) {
-    MlnAction *ap;
-    MlnState *state = melon->sorted[i];
-    state->ntkn_act = 0;
-    state->nntkn_act = 0;
-    state->dflt_act = melon->nstate + melon->nrule;
-    state->tkn_off = MLN_NO_OFFSET;
-    state->ntkn_off = MLN_NO_OFFSET;
-    for (ap = state->ap; ap != NULL; ap = ap->next) {
-      if (MlnComputeAction(melon, ap) > 0) {
-        if (ap->sym->index < melon->nterminal) {
-          state->ntkn_act++;
-        } else if (ap->sym->index < melon->nsymbol) {
-          state->nntkn_act++;
-        } else {
-          state->dflt_act = MlnComputeAction(melon, ap);
-        }
+  values = malloc(sizeof(long) * ((size_t)melon->nstate + melon->nsymbol + 2));
+  token_class = malloc(sizeof(int) * (melon->nsymbol + 1));
+  MlnMemoryCheck(values);
+  MlnMemoryCheck(token_class);
+  melon->ntoken_class = MlnTokenClasses(melon, token_class);
+  at = MlnBuildActionTable(melon, &bias, token_class);
+  first = melon->pad_tables ? bias : 0;
+  empty = first + MlnActionTableSize(at);
+  n = melon->pad_tables ? empty + melon->nsymbol + 2 : empty;
+  melon->table_size = n;
+  actions = malloc(sizeof(long) * n);
+  lookaheads = malloc(sizeof(long) * n);
+  MlnMemoryCheck(actions);
+  MlnMemoryCheck(lookaheads);
+  for (k = 0; k < n; k++) {
+    long la = -1, action = -1;
+    if (k >= first && k < empty) {
+      la = MlnActionTableLookahead(at, k - first);
+      action = MlnActionTableAction(at, k - first);
+    }
+    lookaheads[k] = la < 0 ? melon->nsymbol : la;
+    actions[k] = action < 0 ? (long)melon->nsymbol + melon->nrule + 2 : action;
+  }
+  MlnActionTableFree(at);
+  la_size = MlnMinimumSize(melon->nsymbol + 5);
+  act_size = MlnMinimumSize((long long)melon->nstate + melon->nrule + 5);
+
+  to.out = out;
+  to.line_no = &line_no;
+  to.storage = MlnTableStorage(melon);
+  if (nchunk > 0) {
+    to.def = open_memstream(&tab_buf, &tab_len);
+    MlnMemoryCheck(to.def);
+    to.def_line = &tab_line;
+    tab_line = 2;
+    to.prefix = melon->name ? melon->name : "Parse";
+  } else {
+    to.def = out;
+    to.def_line = &line_no;
+    to.prefix = NULL;
+  }
+
+  if (melon->pack_tables) {
+    /* Output the tables as string literals of little-endian values,
+     * which compile much faster than lists of numbers. Entries of the
+     * interleaved table hold the lookahead, then the action. */
+    int stride = melon->interleave ? la_size + act_size : la_size;
+    unsigned char *bytes = calloc((size_t)(la_size + act_size) * n + 1, 1);
+    MlnMemoryCheck(bytes);
+    fprintf(out, "#define YY_TABLES_PACKED 1\n");
+    line_no++;
+    for (k = 0; k < n; k++) {
+      MlnPackValue(&bytes[k * stride], lookaheads[k], la_size);
+      if (melon->interleave) {
+        MlnPackValue(&bytes[k * stride + la_size], actions[k], act_size);
       }
     }
-    ax[i * 2].state = state;
-    ax[i * 2].is_token = 1;
-    ax[i * 2].naction = state->ntkn_act;
-    ax[i * 2 + 1].state = state;
-    ax[i * 2 + 1].is_token = 0;
-    ax[i * 2 + 1].naction = state->nntkn_act;
-  }
-  min_tkn_offset = 0;
-  max_tkn_offset = 0;
-  min_ntkn_offset = 0;
-  max_ntkn_offset = 0;
-
-  /*
-   * Compute the action table. In order to try to keep the size of the
-   * action table to a minimum, the heuristic of placing the largest
-   * action sets first is used.
-   */
-  qsort(ax, melon->nstate * 2, sizeof(ax[0]), MlnAxSetCompare);
-  at = MlnActionTableAlloc();
-  for (i = 0; i < melon->nstate * 2 && ax[i].naction > 0; i++) {
-    MlnAction *ap;
-    MlnState *state = ax[i].state;
-    if (ax[i].is_token) {
-      for (ap = state->ap; ap != NULL; ap = ap->next) {
-        int action;
-        if (ap->sym->index >= melon->nterminal) {
-          continue;
-        }
-        action = MlnComputeAction(melon, ap);
-        if (action < 0) {
-          continue;
-        }
-        MlnActionTableAddAction(at, ap->sym->index, action);
-      }
-      state->tkn_off = MlnActionTableInsert(at);
-      if (state->tkn_off < min_tkn_offset) {
-        min_tkn_offset = state->tkn_off;
-      }
-      if (state->tkn_off > max_tkn_offset) {
-        max_tkn_offset = state->tkn_off;
-      }
+    if (melon->interleave) {
+      MlnWritePacked(&to, "yy_acttab_packed", bytes, stride * n);
+      MlnWriteUnpack(&to, "YY_LOOKAHEAD", "yy_acttab_packed", stride, 0,
+                     la_size, 0);
+      MlnWriteUnpack(&to, "YY_ACTION", "yy_acttab_packed", stride, la_size,
+                     act_size, 0);
     } else {
-      for (ap = state->ap; ap != NULL; ap = ap->next) {
-        int action;
-        if (ap->sym->index < melon->nterminal) {
-          continue;
-        }
-        if (ap->sym->index == melon->nsymbol) {
-          continue;
-        }
-        action = MlnComputeAction(melon, ap);
-        if (action < 0) {
-          continue;
-        }
-        MlnActionTableAddAction(at, ap->sym->index, action);
+      MlnWritePacked(&to, "yy_lookahead_packed", bytes, la_size * n);
+      MlnWriteUnpack(&to, "YY_LOOKAHEAD", "yy_lookahead_packed", la_size, 0,
+                     la_size, 0);
+      for (k = 0; k < n; k++) {
+        MlnPackValue(&bytes[k * act_size], actions[k], act_size);
       }
-      state->ntkn_off = MlnActionTableInsert(at);
-      if (state->ntkn_off < min_ntkn_offset) {
-        min_ntkn_offset = state->ntkn_off;
+      MlnWritePacked(&to, "yy_action_packed", bytes, act_size * n);
+      MlnWriteUnpack(&to, "YY_ACTION", "yy_action_packed", act_size, 0,
+                     act_size, 0);
+    }
+    free(bytes);
+  } else if (melon->interleave) {
+    /* Output the yy_acttab table, the yy_action and yy_lookahead
+     * tables interleaved, so that a lookup touches one entry */
+    fprintf(out, "#define YY_ACTTAB_INTERLEAVED 1\n");
+    fprintf(out, "typedef struct yyActionEntry {\n");
+    fprintf(out, "  YYCODETYPE lookahead;\n");
+    fprintf(out, "  YYACTIONTYPE action;\n");
+    fprintf(out, "} yyActionEntry;\n");
+    line_no += 5;
+    MlnTableBegin(&to, "const yyActionEntry", "yy_acttab");
+    fprintf(to.def, " {\n");
+    (*to.def_line)++;
+    for (k = 0, j = 0; k < n; k++) {
+      if (j == 0) {
+        fprintf(to.def, " /* %5ld */ ", k);
       }
-      if (state->ntkn_off > max_ntkn_offset) {
-        max_ntkn_offset = state->ntkn_off;
+      fprintf(to.def, " {%4ld,%5ld},", lookaheads[k], actions[k]);
+      if (j == 4 || k == n - 1) {
+        fprintf(to.def, "\n");
+        (*to.def_line)++;
+        j = 0;
+      } else {
+        j++;
       }
     }
+    fprintf(to.def, "};\n");
+    (*to.def_line)++;
+    fprintf(out, "#define YY_LOOKAHEAD(i) yy_acttab[i].lookahead\n");
+    fprintf(out, "#define YY_ACTION(i) yy_acttab[i].action\n");
+    line_no += 2;
+  } else {
+    MlnWriteArray(&to, "YYACTIONTYPE", "yy_action", actions, n);
+    MlnWriteArray(&to, "YYCODETYPE", "yy_lookahead", lookaheads, n);
+    fprintf(out, "#define YY_ACTION(i) yy_action[i]\n");
+    fprintf(out, "#define YY_LOOKAHEAD(i) yy_lookahead[i]\n");
+    line_no += 2;
+  }
+  free(lookaheads);
+  free(actions);
+  if (melon->pad_tables) {
+    fprintf(out, "#define YY_IN_ACTTAB(i) 1\n");
+  } else if (n <= 0x7FFFFFFF) {
+    fprintf(out, "#define YY_IN_ACTTAB(i) ((unsigned)(i) < %ldu)\n", n);
+  } else {
+    fprintf(out, "#define YY_IN_ACTTAB(i) ((unsigned long long)(i) < %ldull)\n",
+            n);
   }
-  free(ax);
-
-  /* Output the yy_action table */
-  fprintf(out, "static YYACTIONTYPE yy_action[] = {\n");
-  line_no++;
-  n = MlnActionTableSize(at);
-  for (i = 0, j = 0; i < n; i++) {
-    int action = MlnActionTableAction(at, i);
-    if (action < 0) {
-      action = melon->nsymbol + melon->nrule + 2;
-    }
-    if (j == 0) {
-      fprintf(out, " /* %5d */ ", i);
-    }
-    fprintf(out, " %4d,", action);
-    if (j == 9 || i == n - 1) {
-      fprintf(out, "\n");
-      line_no++;
-      j = 0;
-    } else {
-      j++;
-    }
-  }
-  fprintf(out, "};\n");
   line_no++;
 
-  /* Output the yy_lookahead table */
-  fprintf(out, "static YYCODETYPE yy_lookahead[] = {\n");
-  line_no++;
-  for (i = 0, j = 0; i < n; i++) {
-    int la = MlnActionTableLookahead(at, i);
-    if (la < 0) {
-      la = melon->nsymbol;
-    }
-    if (j == 0) {
-      fprintf(out, " /* %5d */ ", i);
-    }
-    fprintf(out, " %4d,", la);
-    if (j == 9 || i == n - 1) {
-      fprintf(out, "\n");
-      line_no++;
-      j = 0;
-    } else {
-      j++;
+  /* Output the yy_token_class[], yy_shift_ofst[], yy_reduce_ofst[] and
+   * yy_default[] tables */
+  if (melon->ntoken_class < melon->nterminal) {
+    for (i = 0; i <= melon->nsymbol; i++) {
+      values[i] = i < melon->nterminal ? token_class[i] : i;
     }
+    MlnWriteStateTable(&to, melon, "YYCODETYPE", "yy_token_class",
+                       "YY_TOKEN_CLASS", values, melon->nsymbol + 1,
+                       melon->nsymbol + 5, 0);
+  } else {
+    /* No two terminals share a class, so every symbol is its own */
+    fprintf(out, "#define YY_TOKEN_CLASS(s) (s)\n");
+    line_no++;
   }
-  fprintf(out, "};\n");
-  line_no++;
-
-  /* Output the yy_shift_ofst[] table */
-  fprintf(out, "#define YY_SHIFT_USE_DFLT (%d)\n", min_tkn_offset - 1);
-  line_no++;
-  fprintf(out, "static %s yy_shift_ofst[] = {\n",
-          MlnMinimumSizeType(min_tkn_offset - 1, max_tkn_offset));
-  line_no++;
-  n = melon->nstate;
-  for (i = 0, j = 0; i < n; i++) {
+  /* The offsets are stored biased, so that none is negative. Without
+   * the padding, the macros reading them take the bias off again. */
+  bias -= first;
+  for (i = 0; i < melon->nstate; i++) {
     MlnState *state = melon->sorted[i];
-    int ofst = state->tkn_off;
-    if (ofst == MLN_NO_OFFSET) {
-      ofst = min_tkn_offset - 1;
-    }
-    if (j == 0) {
-      fprintf(out, " /* %5d */ ", i);
-    }
-    fprintf(out, " %4d,", ofst);
-    if (j == 9 || i == n - 1) {
-      fprintf(out, "\n");
-      line_no++;
-      j = 0;
-    } else {
-      j++;
-    }
+    values[i] = (state->tkn_off == MLN_NO_OFFSET ? empty
+                                                 : state->tkn_off + first) +
+                bias;
   }
-  fprintf(out, "};\n");
-  line_no++;
-
-  /* Output the yy_reduce_ofst[] table */
-  fprintf(out, "#define YY_REDUCE_USE_DFLT (%d)\n", min_ntkn_offset - 1);
+  fprintf(out, "#define YY_SHIFT_USE_DFLT (%ld)\n", empty);
   line_no++;
-  fprintf(out, "static %s yy_reduce_ofst[] = {\n",
-          MlnMinimumSizeType(min_ntkn_offset - 1, max_ntkn_offset));
-  line_no++;
-  n = melon->nstate;
-  for (i = 0, j = 0; i < n; i++) {
+  MlnWriteStateTable(&to, melon, MlnMinimumSizeType(0, empty + bias),
+                     "yy_shift_ofst", "YY_SHIFT_OFST", values, melon->nstate,
+                     empty + bias, bias);
+  for (i = 0; i < melon->nstate; i++) {
     MlnState *state = melon->sorted[i];
-    int ofst = state->ntkn_off;
-    if (ofst == MLN_NO_OFFSET) {
-      ofst = min_ntkn_offset - 1;
-    }
-    if (j == 0) {
-      fprintf(out, " /* %5d */ ", i);
-    }
-    fprintf(out, " %4d,", ofst);
-    if (j == 9 || i == n - 1) {
-      fprintf(out, "\n");
-      line_no++;
-      j = 0;
-    } else {
-      j++;
-    }
+    values[i] = (state->ntkn_off == MLN_NO_OFFSET ? empty
+                                                  : state->ntkn_off + first) +
+                bias;
   }
-  fprintf(out, "};\n");
+  fprintf(out, "#define YY_REDUCE_USE_DFLT (%ld)\n", empty);
   line_no++;
-
-  /* Output the default action table */
-  fprintf(out, "static YYACTIONTYPE yy_default[] = {\n");
-  line_no++;
-  n = melon->nstate;
-  for (i = 0, j = 0; i < n; i++) {
-    MlnState *state = melon->sorted[i];
-    if (j == 0) {
-      fprintf(out, " /* %5d */ ", i);
-    }
-    fprintf(out, " %4d,", state->dflt_act);
-    if (j == 9 || i == n - 1) {
-      fprintf(out, "\n");
-      line_no++;
-      j = 0;
-    } else {
-      j++;
+  MlnWriteStateTable(&to, melon, MlnMinimumSizeType(0, empty + bias),
+                     "yy_reduce_ofst", "YY_REDUCE_OFST", values,
+                     melon->nstate, empty + bias, bias);
+  for (i = 0; i < melon->nstate; i++) {
+    values[i] = melon->sorted[i]->dflt_act;
+  }
+  MlnWriteStateTable(&to, melon, "YYACTIONTYPE", "yy_default", "YY_DEFAULT",
+                     values, melon->nstate,
+                     (long)melon->nstate + melon->nrule + 5, 0);
+  free(token_class);
+  free(values);
+
+  /* The tables of a split parser have their own file, so are its
+   * actions, and the rest of the template makes the driver */
+  if (nchunk > 0) {
+    MlnWriteSharedDecls(out, melon, nchunk, &line_no);
+    fprintf(out, "#endif\n");
+    MlnFileCommit(melon, out);
+    fclose(to.def);
+    out = MlnPartOpen(melon, "_tab.c", header, &line_no);
+    if (out != NULL) {
+      fwrite(tab_buf, 1, tab_len, out);
+      MlnFileCommit(melon, out);
+    }
+    free(tab_buf);
+    if (out == NULL || !MlnWriteActionParts(melon, header) ||
+        (out = MlnPartOpen(melon, ".c", header, &line_no)) == NULL) {
+      MlnKeywordTableFree(&kt);
+      MlnLexerFree(&lx);
+      free(header_path);
+      fclose(in);
+      return;
     }
+    free(header_path);
   }
-  fprintf(out, "};\n");
-  line_no++;
   MlnTplXfer(melon->name, in, out, &line_no);
 
   /* Generate the table of fallback tokens */
@@ -1108,10 +2317,18 @@ void MlnReportTable(Melon *melon, int mhflag) {
   }
   MlnTplXfer(melon->name, in, out, &line_no);
 
+  /* Generate the tables of the keywords */
+  if (kt.nkeyword > 0) {
+    MlnWriteKeywordTables(out, melon, &kt, &line_no);
+  }
+  MlnKeywordTableFree(&kt);
+  MlnTplXfer(melon->name, in, out, &line_no);
+
   /* Generate a table containing the symbolic name of every symbol */
   for (i = 0; i < melon->nsymbol; i++) {
-    sprintf(line, "\"%s\",", melon->symbols[i]->name);
-    fprintf(out, "  %-15s", line);
+    int len = (int)strlen(melon->symbols[i]->name);
+    fprintf(out, "  \"%s\",%*s", melon->symbols[i]->name,
+            len < 12 ? 12 - len : 0, "");
     if ((i & 3) == 3) {
       fprintf(out, "\n");
       line_no++;
@@ -1142,54 +2359,7 @@ void MlnReportTable(Melon *melon, int mhflag) {
    * the stack while processing errors or while destroying the parser.
    * (In other words, generate the %destructor actions)
    */
-  if (melon->token_dest != NULL) {
-    for (i = 0; i < melon->nsymbol; i++) {
-      MlnSymbol *sp = melon->symbols[i];
-      if (sp == NULL || sp->type != MLN_SYM_TERMINAL) {
-        continue;
-      }
-      fprintf(out, "    case %d:\n", sp->index);
-      line_no++;
-    }
-    for (i = 0;
-         i < melon->nsymbol && melon->symbols[i]->type != MLN_SYM_TERMINAL;
-         i++) {
-    }
-    if (i < melon->nsymbol) {
-      MlnEmitDestructorCode(out, melon->symbols[i], melon, &line_no);
-      fprintf(out, "      break;\n");
-      line_no++;
-    }
-  }
-  for (i = 0; i < melon->nsymbol; i++) {
-    MlnSymbol *sp = melon->symbols[i];
-    if (sp == NULL || sp->type == MLN_SYM_TERMINAL || sp->destructor == NULL) {
-      continue;
-    }
-    fprintf(out, "    case %d:\n", sp->index);
-    line_no++;
-    MlnEmitDestructorCode(out, sp, melon, &line_no);
-    fprintf(out, "      break;\n");
-    line_no++;
-  }
-  if (melon->var_dest != NULL) {
-    MlnSymbol *dflt_sp = NULL;
-    for (i = 0; i < melon->nsymbol; i++) {
-      MlnSymbol *sp = melon->symbols[i];
-      if (sp == NULL || sp->type == MLN_SYM_TERMINAL || sp->index <= 0 ||
-          sp->destructor != NULL) {
-        continue;
-      }
-      fprintf(out, "    case %d:\n", sp->index);
-      line_no++;
-      dflt_sp = sp;
-    }
-    if (dflt_sp != NULL) {
-      MlnEmitDestructorCode(out, dflt_sp, melon, &line_no);
-      fprintf(out, "      break;\n");
-      line_no++;
-    }
-  }
+  MlnWriteDestructorCases(out, melon, &line_no);
   MlnTplXfer(melon->name, in, out, &line_no);
 
   /* Generate code which executes whenever the parser stack overflows */
@@ -1207,13 +2377,33 @@ void MlnReportTable(Melon *melon, int mhflag) {
   }
   MlnTplXfer(melon->name, in, out, &line_no);
 
-  /* Generate code which execution during each REDUCE action */
-  for (rule = melon->rule; rule != NULL; rule = rule->next) {
-    fprintf(out, "      case %d:\n", rule->index);
-    line_no++;
-    MlnEmitCode(out, rule, melon, &line_no);
+  /* Generate the functions of the actions of the %cold and %hot rules,
+   * which the files of a split parser have for themselves */
+  if (nchunk == 0) {
+    MlnReduceCasesInit(&rc, melon, melon->rule, melon->nrule);
+    MlnWriteRuleFunctions(out, melon, &rc, &line_no);
+  }
+  MlnTplXfer(melon->name, in, out, &line_no);
+
+  /* Generate code which execution during each REDUCE action. A split
+   * parser calls the function of the range of the rule instead. */
+  if (nchunk > 0) {
+    fprintf(out, "      default:\n");
+    fprintf(out, "        switch (yyruleno / %d) {\n", melon->split);
+    line_no += 2;
+    for (i = 0; i < nchunk; i++) {
+      fprintf(out, "        case %d:\n", i);
+      fprintf(out, "          %s_yy_reduce_%d(yypParser, yyruleno, yymsp, "
+                   "&yygotominor);\n",
+              melon->name ? melon->name : "Parse", i);
+      fprintf(out, "          break;\n");
+      line_no += 3;
+    }
+    fprintf(out, "        }\n");
     fprintf(out, "        break;\n");
-    line_no++;
+    line_no += 2;
+  } else {
+    MlnWriteReduceCases(out, melon, &rc, &line_no);
   }
   MlnTplXfer(melon->name, in, out, &line_no);
 
@@ -1229,28 +2419,55 @@ void MlnReportTable(Melon *melon, int mhflag) {
   MlnTplPrint(out, melon, melon->accept, melon->accept_line, &line_no);
   MlnTplXfer(melon->name, in, out, &line_no);
 
+  /* Generate the tables of the scanner */
+  if (lx.nstate > 0) {
+    MlnWriteLexerTables(out, melon, &lx, &line_no);
+  }
+  MlnLexerFree(&lx);
+  MlnTplXfer(melon->name, in, out, &line_no);
+
   /* Append any addition code the user desires */
   MlnTplPrint(out, melon, melon->extra_code, melon->extra_code_line, &line_no);
 
-  fclose(out);
+  MlnFileCommit(melon, out);
   fclose(in);
 }
 
 /*
- * Generate a header file for the parser.
+ * Generate a header file for the parser: the number of every token,
+ * and the prototypes of the keyword recognizer and of the scanner if
+ * the grammar has them.
  */
 void MlnReportHeader(Melon *melon) {
   FILE *out, *in;
   const char *prefix;
   char line[kLineSize];
   char pattern[kLineSize];
-  int i;
+  char keyword[kLineSize];
+  char scan[kLineSize];
+  int i, unchanged;
 
   if (melon->token_prefix) {
     prefix = melon->token_prefix;
   } else {
     prefix = "";
   }
+  keyword[0] = '\0';
+  for (i = 1; i < melon->nterminal; i++) {
+    if (melon->symbols[i]->keyword != NULL) {
+      snprintf(keyword, kLineSize, "int %sKeyword(const char *z, int n);\n",
+               melon->name ? melon->name : "Parse");
+      break;
+    }
+  }
+  scan[0] = '\0';
+  if (melon->regex != NULL) {
+    snprintf(scan, kLineSize,
+             "int %sScan(void *yyp, const char *z, int n%s%s);\n",
+             melon->name ? melon->name : "Parse",
+             melon->arg && melon->arg[0] != '\0' ? ", " : "",
+             melon->arg ? melon->arg : "");
+  }
 
   in = MlnFileOpen(melon, ".h", "r");
   if (in) {
@@ -1260,11 +2477,23 @@ void MlnReportHeader(Melon *melon) {
       if (strcmp(line, pattern)) {
         break;
       }
-      fclose(in);
-      if (i == melon->nterminal) {
-        /* No change in the file. Don't rewrite it. */
-        return;
-      }
+    }
+    unchanged = i == melon->nterminal;
+    if (unchanged && keyword[0] != '\0') {
+      unchanged =
+          fgets(line, kLineSize, in) != NULL && strcmp(line, keyword) == 0;
+    }
+    if (unchanged && scan[0] != '\0') {
+      unchanged =
+          fgets(line, kLineSize, in) != NULL && strcmp(line, scan) == 0;
+    }
+    if (unchanged) {
+      unchanged = fgets(line, kLineSize, in) == NULL;
+    }
+    fclose(in);
+    if (unchanged) {
+      /* No change in the file. Don't rewrite it. */
+      return;
     }
   }
 
@@ -1273,7 +2502,9 @@ void MlnReportHeader(Melon *melon) {
     for (i = 1; i < melon->nterminal; i++) {
       fprintf(out, "#define %s%-30s %2d\n", prefix, melon->symbols[i]->name, i);
     }
-    fclose(out);
+    fputs(keyword, out);
+    fputs(scan, out);
+    MlnFileClose(melon, out);
   }
 }
 
@@ -1286,41 +2517,31 @@ void MlnReportHeader(Melon *melon) {
  */
 void MlnCompressTables(Melon *melon) {
   int i;
+  int *count; /* Number of reduce actions on each rule in one state */
+
+  count = calloc(melon->nrule > 0 ? melon->nrule : 1, sizeof(count[0]));
+  MlnMemoryCheck(count);
   for (i = 0; i < melon->nstate; i++) {
     MlnState *state = melon->sorted[i];
+    MlnAction *ap, *end = state->ap + state->nap;
     int nbest = 0;
-    MlnRule *rbest = NULL;
-    MlnAction *ap;
+    int rbest = -1;
 
-    for (ap = state->ap; ap != NULL; ap = ap->next) {
-      MlnRule *rp;
-      MlnAction *ap2;
-      int n = 1;
-      if (ap->type != MLN_REDUCE) {
-        continue;
+    for (ap = state->ap; ap < end; ap++) {
+      if (ap->type == MLN_REDUCE) {
+        count[ap->x.rule]++;
       }
-      rp = ap->x.rule;
-      if (rp == rbest) {
+    }
+    /* The first rule in array order with the highest count wins */
+    for (ap = state->ap; ap < end; ap++) {
+      if (ap->type != MLN_REDUCE) {
         continue;
       }
-
-      for (ap2 = ap->next; ap2 != NULL; ap2 = ap2->next) {
-        MlnRule *rp2;
-        if (ap2->type != MLN_REDUCE) {
-          continue;
-        }
-        rp2 = ap2->x.rule;
-        if (rp2 == rbest) {
-          continue;
-        }
-        if (rp2 == rp) {
-          n++;
-        }
-      }
-      if (n > nbest) {
-        nbest = n;
-        rbest = rp;
+      if (count[ap->x.rule] > nbest) {
+        nbest = count[ap->x.rule];
+        rbest = ap->x.rule;
       }
+      count[ap->x.rule] = 0;
     }
 
     /* Do not make default if the number of rules to default
@@ -1330,18 +2551,19 @@ void MlnCompressTables(Melon *melon) {
     }
 
     /* Compress matching REDUCE actions into a single default */
-    for (ap = state->ap; ap != NULL; ap = ap->next) {
+    for (ap = state->ap; ap < end; ap++) {
       if (ap->type == MLN_REDUCE && ap->x.rule == rbest) {
         break;
       }
     }
-    assert(ap);
-    ap->sym = MlnSymbolNew("{default}");
-    for (ap = ap->next; ap != NULL; ap = ap->next) {
+    assert(ap < end);
+    ap->sym = melon->nsymbol; /* The "{default}" symbol */
+    for (ap = ap + 1; ap < end; ap++) {
       if (ap->type == MLN_REDUCE && ap->x.rule == rbest) {
         ap->type = NOT_USED;
       }
     }
-    state->ap = MlnActionSort(state->ap);
+    MlnActionSort(state);
   }
+  free(count);
 }
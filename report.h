@@ -8,8 +8,11 @@
 
 #include "struct.h"
 
+char *MlnFileMakeName(Melon *melon, const char *suffix);
+char *MlnTplName(Melon *melon);
 void MlnReprint(Melon *melon);
 void MlnReportOutput(Melon *melon);
+long MlnActionTableCost(Melon *melon);
 void MlnReportTable(Melon *melon, int mhflag);
 void MlnReportHeader(Melon *melon);
 void MlnCompressTables(Melon *melon);
@@ -5,24 +5,23 @@
 
 #include "set.h"
 
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
-static int size = 0;
+#include "struct.h"
 
 /*
  * Set the set size.
  */
-void MlnSetSize(int n) { size = n + 1; }
+void MlnSetSize(Melon *melon, int n) { melon->set_pool.size = n + 1; }
 
 /*
  * Allocate a new set.
  */
-void *MlnSetNew() {
-  void *s = calloc(1, size);
-  if (s == NULL) {
-    extern void memory_error();
-    memory_error();
-  }
+void *MlnSetNew(Melon *melon) {
+  void *s = calloc(1, melon->set_pool.size);
+  MlnMemoryCheck(s);
   return s;
 }
 
@@ -45,11 +44,11 @@ int MlnSetAdd(void *set, int n) {
 /*
  * Add every element of sb to sa.  Return MLN_TRUE if sa changes.
  */
-int MlnSetUnion(void *sa, void *sb) {
+int MlnSetUnion(Melon *melon, void *sa, void *sb) {
   char *s1 = sa, *s2 = sb;
   int i;
   MlnBoolean ret = MLN_FALSE;
-  for (i = 0; i < size; i++) {
+  for (i = 0; i < melon->set_pool.size; i++) {
     if (s2[i] == 0) {
       continue;
     }
@@ -60,3 +59,263 @@ int MlnSetUnion(void *sa, void *sb) {
   }
   return ret;
 }
+
+/*
+ * An interned set. There is a single entry for every distinct content,
+ * shared by reference counting, so that equal sets are equal pointers.
+ */
+typedef struct MlnSetEntry {
+  struct MlnSetEntry *next;  /* Next entry in the same hash bucket */
+  struct MlnSetEntry **from; /* Link to this entry, NULL if not in table */
+  unsigned hash;             /* Hash of the content */
+  unsigned serial;           /* Number of the entry, never reused */
+  int ref;                   /* Number of references to the entry */
+  char set[1];               /* The content, "size" bytes */
+} MlnSetEntry;
+
+#define MlnSetEntryOf(s)                                                     \
+  ((MlnSetEntry *)((char *)(s) - offsetof(MlnSetEntry, set)))
+
+/* A cached union: the set of the entries numbered a and b is result */
+typedef struct MlnSetUnionSlot {
+  unsigned a, b;
+  char *result; /* Holds a reference, NULL if the slot is empty */
+} MlnSetUnionSlot;
+
+static const int kUnionCacheSize = 4096; /* A power of two */
+
+static unsigned MlnSetHash(const MlnSetPool *pool, const char *s) {
+  unsigned h = 2166136261U;
+  int i;
+  for (i = 0; i < pool->size; i++) {
+    h = (h ^ (unsigned char)s[i]) * 16777619U;
+  }
+  return h;
+}
+
+/* Put the entry at the head of its bucket */
+static void MlnSetLink(MlnSetPool *pool, MlnSetEntry *e) {
+  MlnSetEntry **head = &pool->buckets[e->hash & (pool->nbucket - 1)];
+  e->next = *head;
+  if (e->next != NULL) {
+    e->next->from = &e->next;
+  }
+  e->from = head;
+  *head = e;
+}
+
+/*
+ * Rebuild the table with "n" buckets, from the entries of the old one.
+ */
+static void MlnSetRehash(MlnSetPool *pool, int n) {
+  MlnSetEntry **old = pool->buckets;
+  int i, nold = pool->nbucket;
+  pool->buckets = calloc(n, sizeof(MlnSetEntry *));
+  MlnMemoryCheck(pool->buckets);
+  pool->nbucket = n;
+  for (i = 0; i < nold; i++) {
+    MlnSetEntry *e, *next;
+    for (e = old[i]; e != NULL; e = next) {
+      next = e->next;
+      MlnSetLink(pool, e);
+    }
+  }
+  free(old);
+}
+
+/*
+ * Return a new reference to the interned set with the content "s",
+ * which is not consumed.
+ */
+static char *MlnSetInternCopy(MlnSetPool *pool, const char *s) {
+  unsigned hash = MlnSetHash(pool, s);
+  MlnSetEntry *e;
+
+  if (pool->nbucket > 0) {
+    e = pool->buckets[hash & (pool->nbucket - 1)];
+    for (; e != NULL; e = e->next) {
+      if (e->hash == hash && memcmp(e->set, s, pool->size) == 0) {
+        e->ref++;
+        return e->set;
+      }
+    }
+  }
+  if (pool->nentry >= pool->nbucket) {
+    MlnSetRehash(pool, pool->nbucket > 0 ? pool->nbucket * 2 : 1024);
+  }
+  e = malloc(offsetof(MlnSetEntry, set) + pool->size);
+  MlnMemoryCheck(e);
+  memcpy(e->set, s, pool->size);
+  e->hash = hash;
+  e->serial = ++pool->serial;
+  e->ref = 1;
+  MlnSetLink(pool, e);
+  pool->nentry++;
+  return e->set;
+}
+
+/*
+ * Return a reference to the interned set with the content of "set",
+ * which is freed.
+ */
+char *MlnSetIntern(Melon *melon, char *set) {
+  char *s = MlnSetInternCopy(&melon->set_pool, set);
+  MlnSetFree(set);
+  melon->set_pool.nintern++;
+  return s;
+}
+
+/*
+ * Return a reference to the interned union of the interned sets "sa"
+ * and "sb". It is "sa" itself if "sb" adds nothing.
+ */
+char *MlnSetInternUnion(Melon *melon, char *sa, char *sb) {
+  MlnSetPool *pool = &melon->set_pool;
+  MlnSetEntry *a = MlnSetEntryOf(sa), *b = MlnSetEntryOf(sb);
+  MlnSetUnionSlot *slot;
+  int i;
+
+  if (sa == sb) {
+    a->ref++;
+    return sa;
+  }
+  if (pool->union_cache == NULL) {
+    pool->union_cache = calloc(kUnionCacheSize, sizeof(MlnSetUnionSlot));
+    pool->union_tmp = malloc(pool->size);
+    MlnMemoryCheck(pool->union_cache);
+    MlnMemoryCheck(pool->union_tmp);
+  }
+  pool->nunion++;
+  slot = &pool->union_cache[(a->serial * 0x9e3779b1U ^ b->serial) &
+                            (kUnionCacheSize - 1)];
+  if (slot->result != NULL && slot->a == a->serial && slot->b == b->serial) {
+    pool->nunion_hit++;
+    MlnSetEntryOf(slot->result)->ref++;
+    return slot->result;
+  }
+  for (i = 0; i < pool->size; i++) {
+    pool->union_tmp[i] = sa[i] | sb[i];
+  }
+  if (slot->result != NULL) {
+    MlnSetRelease(melon, slot->result);
+  }
+  slot->a = a->serial;
+  slot->b = b->serial;
+  slot->result = MlnSetInternCopy(pool, pool->union_tmp);
+  MlnSetEntryOf(slot->result)->ref++;
+  return slot->result;
+}
+
+/*
+ * Return a new reference to the interned set "set".
+ */
+char *MlnSetRetain(char *set) {
+  MlnSetEntryOf(set)->ref++;
+  return set;
+}
+
+/*
+ * Drop a reference to an interned set, and free it with the last one.
+ */
+void MlnSetRelease(Melon *melon, char *set) {
+  MlnSetEntry *e = MlnSetEntryOf(set);
+  if (--e->ref > 0) {
+    return;
+  }
+  if (e->from != NULL) {
+    *e->from = e->next;
+    if (e->next != NULL) {
+      e->next->from = e->from;
+    }
+    melon->set_pool.nentry--;
+  }
+  free(e);
+}
+
+/*
+ * Return the number of the interned set "set", from 1 to the serial of
+ * the pool. Distinct sets have distinct numbers.
+ */
+unsigned MlnSetSerial(char *set) { return MlnSetEntryOf(set)->serial; }
+
+/*
+ * Empty the cache of unions, releasing the sets it holds.
+ */
+void MlnSetInternFlush(Melon *melon) {
+  MlnSetPool *pool = &melon->set_pool;
+  int i;
+  if (pool->union_cache == NULL) {
+    return;
+  }
+  for (i = 0; i < kUnionCacheSize; i++) {
+    if (pool->union_cache[i].result != NULL) {
+      MlnSetRelease(melon, pool->union_cache[i].result);
+    }
+  }
+  free(pool->union_cache);
+  free(pool->union_tmp);
+  pool->union_cache = NULL;
+  pool->union_tmp = NULL;
+}
+
+/*
+ * Call "fn" on every interned set. It may change the content of the
+ * sets, as long as they stay distinct.
+ */
+void MlnSetInternMap(Melon *melon, void (*fn)(char *set, void *arg),
+                     void *arg) {
+  MlnSetPool *pool = &melon->set_pool;
+  MlnSetEntry **old = pool->buckets;
+  int i, nold = pool->nbucket;
+
+  MlnSetInternFlush(melon);
+  pool->buckets = NULL;
+  pool->nbucket = 0;
+  MlnSetRehash(pool, nold > 0 ? nold : 1024);
+  for (i = 0; i < nold; i++) {
+    MlnSetEntry *e, *next;
+    for (e = old[i]; e != NULL; e = next) {
+      next = e->next;
+      fn(e->set, arg);
+      e->hash = MlnSetHash(pool, e->set);
+      MlnSetLink(pool, e);
+    }
+  }
+  free(old);
+}
+
+/*
+ * Forget all interned sets. Those still referenced stay valid, and are
+ * freed by their last release. The union cache goes with them, so the
+ * numbering of the entries and the counters start over.
+ */
+void MlnSetInternReset(Melon *melon) {
+  MlnSetPool *pool = &melon->set_pool;
+  int i;
+  MlnSetInternFlush(melon);
+  for (i = 0; i < pool->nbucket; i++) {
+    MlnSetEntry *e, *next;
+    for (e = pool->buckets[i]; e != NULL; e = next) {
+      next = e->next;
+      e->next = NULL;
+      e->from = NULL;
+    }
+  }
+  free(pool->buckets);
+  pool->buckets = NULL;
+  pool->nbucket = pool->nentry = 0;
+  pool->serial = 0;
+  pool->nintern = pool->nunion = pool->nunion_hit = 0;
+}
+
+/*
+ * Print how much the interning of follow sets shared.
+ */
+void MlnSetStatsPrint(Melon *melon, FILE *out) {
+  const MlnSetPool *pool = &melon->set_pool;
+  fprintf(out,
+          "                   follow sets: %ld interned, %d distinct "
+          "(%ld bytes), %ld unions, %ld cached\n",
+          pool->nintern, pool->nentry, (long)pool->nentry * pool->size,
+          pool->nunion, pool->nunion_hit);
+}
@@ -6,14 +6,28 @@
 #ifndef MELON_SET_H_
 #define MELON_SET_H_
 
+#include <stdio.h>
+
 #include "struct.h"
 
-void MlnSetSize(int n);     /* All sets will be of size n */
-void *MlnSetNew();          /* A new set for element 0..N */
-void MlnSetFree(void *set); /* Deallocate a set */
+void MlnSetSize(Melon *melon, int n); /* All sets will be of size n */
+void *MlnSetNew(Melon *melon);        /* A new set for element 0..N */
+void MlnSetFree(void *set);           /* Deallocate a set */
+
+int MlnSetAdd(void *set, int n); /* Add element to a set */
+int MlnSetUnion(Melon *melon, void *sa, void *sb); /* A <- A U B */
 
-int MlnSetAdd(void *set, int n);     /* Add element to a set */
-int MlnSetUnion(void *sa, void *sb); /* A <- A U B, thru element N */
+/* Interned sets: one shared, reference counted copy of every content */
+char *MlnSetIntern(Melon *melon, char *set); /* Intern, freeing set */
+char *MlnSetInternUnion(Melon *melon, char *sa, char *sb); /* sa U sb */
+char *MlnSetRetain(char *set);                /* Add a reference */
+void MlnSetRelease(Melon *melon, char *set);  /* Drop a reference */
+unsigned MlnSetSerial(char *set);             /* Number of the set */
+void MlnSetInternFlush(Melon *melon);         /* Empty the union cache */
+void MlnSetInternMap(Melon *melon, void (*fn)(char *set, void *arg),
+                     void *arg);
+void MlnSetInternReset(Melon *melon); /* Forget all sets */
+void MlnSetStatsPrint(Melon *melon, FILE *out);
 
 #define MlnSetFind(X, Y) (((char *)X)[Y]) /* True if Y is in set X */
 
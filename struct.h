@@ -6,14 +6,18 @@
 #ifndef MELON_STRUCT_H_
 #define MELON_STRUCT_H_
 
-#ifdef TEST
-#define MLN_MAX_RHS 5
-#else
-#define MLN_MAX_RHS 1024
-#endif
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * The state of a generation is kept in its Melon. Only where the
+ * diagnostics go, and where a fatal error jumps, are per thread.
+ */
+#define MLN_THREAD_LOCAL _Thread_local
 
 struct MlnState;
 struct MlnConfig;
+struct MlnSinks;
 
 typedef enum { MLN_FALSE = 0, MLN_TRUE = 1 } MlnBoolean;
 
@@ -24,6 +28,13 @@ typedef enum MlnAssocType {
   MLN_ASSOC_UNK,
 } MlnAssocType;
 
+/* How often the rules of a non-terminal are expected to be reduced */
+typedef enum MlnHeat {
+  MLN_HEAT_NORMAL,
+  MLN_HEAT_HOT,  /* Named by %hot */
+  MLN_HEAT_COLD, /* Named by %cold */
+} MlnHeat;
+
 typedef enum MlnActionState {
   MLN_SHIFT,
   MLN_ACCEPT,
@@ -48,8 +59,12 @@ typedef struct MlnSymbol {
   } type;               /* Symbols are all either terminals or non-terminals */
   struct MlnRule *rule; /* Linked list of rules of this (if an NT) */
   struct MlnSymbol *fallback; /* Fallback token while the token doesn't parse */
+  int token_order;            /* Position in %token, 0 if not pinned */
   int prec;                   /* Precedence if defined (-1 otherwise) */
   MlnAssocType assoc;         /* Associativity if precedence is defined */
+  MlnHeat heat;               /* %hot or %cold, for the rules of an NT */
+  char *keyword;              /* Spelling given by %keyword, or NULL */
+  int keyword_line;           /* Line number of the %keyword spelling */
   void *first_set;            /* First-set for all rules of this symbol */
   MlnBoolean lambda;          /* True if NT and can generate an empty string */
   char *destructor;           /* Code which executes whenever this symbol is
@@ -82,49 +97,71 @@ typedef struct MlnRule {
   struct MlnRule *next;     /* Next rule in the global list */
 } MlnRule;
 
+/*
+ * A pattern of the scanner, given by %token_regex or %skip_regex.
+ */
+typedef struct MlnRegex {
+  MlnSymbol *sym;        /* Token of the matches, NULL to skip them */
+  char *pattern;         /* The regular expression */
+  int line;              /* Line number of the pattern */
+  struct MlnRegex *next; /* Next pattern, in the order of the grammar */
+} MlnRegex;
+
 /*
  * A followset propagation link indicates that the contents of one
  * configuration followset should be propagated to another whenever
  * the first changes.
  */
 typedef struct MlnPLink {
-  struct MlnConfig *config; /* The configuration to which linked */
-  struct MlnPLink *next;    /* The next propagate link */
+  int config; /* Index of the configuration to which linked */
+  int next;   /* Index of the next propagate link */
 } MlnPLink;
 
+/* The end of a list of configurations or of propagation links */
+#define MLN_NO_INDEX (-1)
+
 /* A configuration is a production rule of the grammar together with
  * a mark (dot) showing how much of that rule has been processed so far.
  * Configuration also contain a follow-set which is a list of terminal
  * symbols which are allowed to immediately follow the end of the rule.
  * Every configuration is recorded as an instance of the following.
+ * Configurations refer to each other, and to their propagation links,
+ * by 32-bit indices.
  */
 typedef struct MlnConfig {
-  MlnRule *rule;       /* The rule upon which the configuration is based */
-  int dot;             /* The parse point */
-  char *fws;           /* Follow-set for this configuration only */
-  MlnPLink *fpl;       /* Follow-set forward propagation links */
-  MlnPLink *bpl;       /* Follow-set backward propagation links */
-  struct MlnState *st; /* Pointer to state which contains this */
-  enum {
-    MLN_COMPLETE,
-    MLN_INCOMPLETE
-  } status;               /* Used during followset and shift computations */
-  struct MlnConfig *next; /* Next configuration in the state */
-  struct MlnConfig *bp;   /* The next basis configuration */
+  MlnRule *rule; /* The rule upon which the configuration is based */
+  char *fws;     /* Interned follow-set, shared with others */
+  int dot;       /* The parse point */
+  int index;     /* Its own index, then the one of the compact copy */
+  int fpl;       /* Follow-set forward propagation links */
+  int bpl;       /* Follow-set backward propagation links */
+  int next;      /* Next configuration in the state */
+  int bp;        /* The next basis configuration */
 } MlnConfig;
 
 /*
- * Every shift or reduce operation is stored as one of the following
+ * Once follow sets are known, the configurations of every state are
+ * moved into one array in this compact form. A state then refers to
+ * its closure by an index range into that array.
+ */
+typedef struct MlnCompactConfig {
+  MlnRule *rule; /* The rule upon which the configuration is based */
+  char *fws;     /* Interned follow-set, shared with others */
+  int dot;       /* The parse point */
+  int is_basis;  /* True if this is a basis configuration */
+} MlnCompactConfig;
+
+/*
+ * Every shift or reduce operation is stored as one of the following.
+ * Actions live in a per-state array, so every field is a 32-bit value.
  */
 typedef struct MlnAction {
-  MlnSymbol *sym; /* The look-ahead symbol */
-  MlnActionState type;
+  int sym;             /* Index of the look-ahead symbol */
+  MlnActionState type; /* What to do on the look-ahead */
   union {
-    struct MlnState *state; /* The new state, if a shift */
-    struct MlnRule *rule;   /* The rule, if a reduce */
+    int state; /* Index of the new state, if a shift */
+    int rule;  /* Index of the rule, if a reduce */
   } x;
-  struct MlnAction *next;    /* Next action for this state */
-  struct MlnAction *collide; /* Next action with the same hash */
 } MlnAction;
 
 /*
@@ -134,17 +171,93 @@ typedef struct MlnAction {
 typedef struct MlnState {
   MlnConfig *bp;  /* The basis configurations for this state */
   MlnConfig *cfp; /* All configurations in this set */
+  int cfg_first;  /* Index of the first compact configuration */
+  int ncfg;       /* Number of compact configurations */
+  unsigned hash;  /* Hash of the basis, computed at creation */
   int index;      /* Sequential number for this state */
-  MlnAction *ap;  /* Array of actions for this state */
+  MlnAction *ap;  /* Array of actions, sorted by look-ahead symbol */
+  int nap;        /* Number of entries in ap[] */
+  int nap_alloc;  /* Number of slots allocated for ap[] */
   int ntkn_act;   /* Number of actions on terminals */
   int nntkn_act;  /* Number of actions on non-terminals */
-  int tkn_off;    /* yy_action[] offset for terminals */
-  int ntkn_off;   /* yy_action[] offset for non-terminals */
-  int dflt_act;   /* Default action */
+  long tkn_off;   /* yy_action[] offset for terminals */
+  long ntkn_off;  /* yy_action[] offset for non-terminals */
+  long dflt_act;  /* Default action */
 } MlnState;
 
 #define MLN_NO_OFFSET (-0x7FFFFFFF)
 
+/*
+ * Counters describing how well the state and configuration hash
+ * tables behave. They are printed by MlnHashStatsPrint().
+ */
+typedef struct MlnHashStats {
+  long lookups;    /* Number of find and insert operations */
+  long probes;     /* Total number of nodes visited by those operations */
+  long max_probe;  /* Longest chain walked by a single operation */
+  long collisions; /* Nodes with an equal hash but a different key */
+} MlnHashStats;
+
+/*
+ * The hash tables of table.c.
+ */
+typedef struct MlnTables {
+  struct X1 *x1a; /* Strings */
+  struct X2 *x2a; /* Symbols, by name */
+  struct X3 *x3a; /* States, by basis */
+  struct X4 *x4a; /* Configurations, by rule and dot */
+  MlnHashStats state_stats;
+  MlnHashStats config_stats;
+} MlnTables;
+
+/*
+ * The configurations of configlist.c. They are carved out of blocks,
+ * which never move, so all can be freed at once. The index of a
+ * configuration is the number of its block, then its position in the
+ * block.
+ */
+typedef struct MlnConfigPool {
+  MlnConfig **blocks;
+  int nblock;
+  int block_alloc;
+  int free_list;    /* List of free configurations */
+  int current;      /* Top of list of configurations */
+  int *current_end; /* Last on list of configs */
+  int basis;        /* Top of list of basis configs */
+  int *basis_end;   /* End of list of basis configs */
+  struct MlnClosureInfo *closure; /* Data of MlnConfigListClosure() */
+  struct MlnConfigKey *sort_keys; /* Buffers of the sort, reused from */
+  struct MlnConfigKey *sort_tmp;  /* one list to the next */
+  int sort_alloc;
+} MlnConfigPool;
+
+/*
+ * The propagation links of plink.c. They live in one array and are
+ * addressed by their index, so all can be freed at once.
+ */
+typedef struct MlnPLinkPool {
+  MlnPLink *plinks;
+  int alloc;
+  int count;
+  int free_list; /* List of free links */
+} MlnPLinkPool;
+
+/*
+ * The interned sets of set.c.
+ */
+typedef struct MlnSetPool {
+  int size;                       /* Bytes of every set */
+  struct MlnSetEntry **buckets;   /* Interned sets */
+  int nbucket;                    /* A power of two */
+  int nentry;                     /* Entries in the table */
+  unsigned serial;                /* Of the last new entry */
+  struct MlnSetUnionSlot *union_cache;
+  char *union_tmp;                /* Scratch set of unions */
+  long nintern;                   /* Sets given to MlnSetIntern() */
+  long nunion;                    /* Unions of distinct sets */
+  long nunion_hit;                /* Unions found in the cache */
+} MlnSetPool;
+
 /*
  * The state vector for the entire parser generator is recorded as
  * follows.
@@ -167,6 +280,10 @@ typedef struct MlnState {
  *    %default_destructor var_dest
  *    %token_prefix       token_prefix
  *    %fallback           has_fallback
+ *    %token              (MlnSymbol.token_order)
+ *    %keyword            (MlnSymbol.keyword)
+ *    %token_regex        regex
+ *    %skip_regex         regex
  */
 typedef struct Melon {
   MlnState **sorted;   /* Table of states sorted by state number */
@@ -177,6 +294,10 @@ typedef struct Melon {
   int nsymbol;         /* Number of terminal and non-terminal symbols */
   int nterminal;       /* Number of terminal symbols */
   MlnSymbol *err_sym;  /* The error symbol */
+  MlnCompactConfig *configs; /* Configurations of all states */
+  int nconfig;               /* Number of entries in configs[] */
+  int *link_first; /* Start of the propagation links of each config */
+  int *links;      /* Configs reached by the propagation links */
   int error_cnt;       /* Number of errors */
 
   char *name;          /* Name of the generated parser */
@@ -203,13 +324,48 @@ typedef struct Melon {
   int var_dest_line;  /* Line number for default non-terminal destructor code */
   char *token_prefix; /* A prefix added to token names in the *.h file */
   int has_fallback;   /* True if any %fallback is seen in the grammer */
+  MlnRegex *regex;    /* Patterns of the scanner, in order */
 
   char *filename;    /* Name of the input file */
   char *output_file; /* Name of the current output file */
   int nconflict;     /* Number of parsing conflicts */
-  int table_size;    /* Size of the parse tables */
+  long table_size;   /* Size of the parse tables */
+  int ntoken_class;  /* Number of classes of terminals in the tables */
+  int nlex_state;    /* Number of states of the scanner, 0 if none */
+  int nlex_class;    /* Number of classes of bytes of the scanner */
   int basis_flag;    /* Print only basis configurations */
-  char *argv0;       /* Name of the program */
+  int interleave;    /* Interleave the lookahead and action tables */
+  int pad_tables;    /* Pad the action table for unchecked lookups */
+  int pack_tables;   /* Output the tables as string literals */
+  int cplusplus;     /* Output a header-only C++ parser class */
+  int prune;         /* Remove useless symbols, rules and states */
+  int renumber;      /* Renumber symbols to shrink the action table */
+  int split;         /* Rules per file of actions, 0 for one file */
+  int nprune_symbol; /* Number of nonterminals removed */
+  int nprune_rule;   /* Number of rules removed */
+  int nunreduced;    /* Of those, rules removed as never reduced */
+  int nprune_state;  /* Number of states removed */
+  int nmerge_action; /* Reduce actions sharing the code of another */
+  int nmerge_dest;   /* Destructors sharing the code of another */
+  char *argv0;       /* Name of the program, NULL in the library */
+  char **defines;    /* Macros for %ifdef, as given to -D */
+  int ndefine;       /* Number of defines */
+
+  const struct MlnSinks *sinks; /* Receive the outputs, NULL for files */
+  const char *tpl_buf;          /* Template text, NULL to search a file */
+  size_t tpl_len;               /* Length of tpl_buf */
+  FILE *sink_file;              /* Stream of the output, while open */
+  char *sink_buf;               /* Output being collected for the sinks */
+  size_t sink_len;              /* Length of sink_buf */
+  const char *sink_suffix;      /* Suffix of that output */
+
+  MlnTables tables;          /* Hash tables of the grammar */
+  MlnConfigPool config_pool; /* Configurations of the automaton */
+  MlnPLinkPool plink_pool;   /* Follow set propagation links */
+  MlnSetPool set_pool;       /* Interned follow sets */
+  int *shift_mark;           /* Scratch of MlnBuildShifts(), by symbol */
+  int *shift_pos;
+  int shift_stamp;
 } Melon;
 
 #define MlnMemoryCheck(x)                                                      \
@@ -6,9 +6,14 @@
 #include "table.h"
 
 #include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "configlist.h"
+#include "set.h"
+
 /*
  * Generic hash function (a popular one from Bernstein)
  */
@@ -40,7 +45,6 @@ typedef struct X1Node {
   struct X1Node **from; /* Previous link */
 } X1Node;
 
-static X1 *x1a = NULL;
 static const int kStrTableSize = 1024;
 
 /*
@@ -48,11 +52,11 @@ static const int kStrTableSize = 1024;
  * keep strings in a table so that the same string is not in more than
  * one place.
  */
-char *MlnStrSafe(const char *s) {
-  char *z = MlnStrSafeFind(s);
+char *MlnStrSafe(Melon *melon, const char *s) {
+  char *z = MlnStrSafeFind(melon, s);
   if (z == NULL && (z = malloc(strlen(s) + 1)) != NULL) {
     strcpy(z, s);
-    MlnStrSafeInsert(z);
+    MlnStrSafeInsert(melon, z);
   }
   MlnMemoryCheck(z);
   return z;
@@ -61,36 +65,46 @@ char *MlnStrSafe(const char *s) {
 /*
  * Allocate a new associative array
  */
-void MlnStrSafeInit() {
-  if (x1a != NULL) {
-    return;
+void MlnStrSafeInit(Melon *melon) {
+  X1 *x1a = malloc(sizeof(X1));
+  int i;
+
+  MlnMemoryCheck(x1a);
+  x1a->size = kStrTableSize;
+  x1a->count = 0;
+  x1a->tbl = malloc((sizeof(X1Node) + sizeof(X1Node *)) * kStrTableSize);
+  MlnMemoryCheck(x1a->tbl);
+  x1a->ht = (X1Node **)&(x1a->tbl[kStrTableSize]);
+  for (i = 0; i < kStrTableSize; i++) {
+    x1a->ht[i] = NULL;
   }
+  melon->tables.x1a = x1a;
+}
 
-  x1a = (X1 *)malloc(sizeof(X1));
+/*
+ * Release every string and the table itself, so that the table can be
+ * initialized again.
+ */
+void MlnStrSafeReset(Melon *melon) {
+  X1 *x1a = melon->tables.x1a;
+  int i;
   if (x1a == NULL) {
     return;
   }
-
-  x1a->size = kStrTableSize;
-  x1a->count = 0;
-  x1a->tbl = malloc((sizeof(X1Node) + sizeof(X1Node *)) * kStrTableSize);
-  if (x1a->tbl == NULL) {
-    free(x1a);
-    x1a = NULL;
-  } else {
-    int i = 0;
-    x1a->ht = (X1Node **)&(x1a->tbl[kStrTableSize]);
-    for (i = 0; i < kStrTableSize; i++) {
-      x1a->ht[i] = NULL;
-    }
+  for (i = 0; i < x1a->count; i++) {
+    free(x1a->tbl[i].data);
   }
+  free(x1a->tbl);
+  free(x1a);
+  melon->tables.x1a = NULL;
 }
 
 /*
  * Insert a new record into the array. Return MLN_TRUE if successful.
  * Prior data with the same key is NOT overwritten.
  */
-int MlnStrSafeInsert(char *data) {
+int MlnStrSafeInsert(Melon *melon, char *data) {
+  X1 *x1a = melon->tables.x1a;
   X1Node *node;
   unsigned h;
   unsigned index;
@@ -119,9 +133,7 @@ int MlnStrSafeInsert(char *data) {
     array.size = size = x1a->size * 2;
     array.count = x1a->count;
     array.tbl = malloc((sizeof(X1Node) + sizeof(X1Node *)) * size);
-    if (array.tbl == NULL) {
-      return MLN_FALSE; /* Fail due to malloc failure */
-    }
+    MlnMemoryCheck(array.tbl);
     array.ht = (X1Node **)&(array.tbl[size]);
     for (i = 0; i < size; i++) {
       array.ht[i] = NULL;
@@ -161,7 +173,8 @@ int MlnStrSafeInsert(char *data) {
  * Return a pointer to data assigned to the given key. Return NULL
  * if no such key.
  */
-char *MlnStrSafeFind(const char *key) {
+char *MlnStrSafeFind(Melon *melon, const char *key) {
+  X1 *x1a = melon->tables.x1a;
   unsigned h;
   X1Node *node;
 
@@ -206,37 +219,40 @@ typedef struct X2Node {
   struct X2Node **from; /* Previous link */
 } X2Node;
 
-static X2 *x2a;
 static const int kSymTableSize = 128;
 
 /*
  * Return a pointer to the (terminal or non-terminal) symbol "x".
  * Create a new symbol if this is the first time "x" has been seen.
  */
-MlnSymbol *MlnSymbolNew(const char *x) {
+MlnSymbol *MlnSymbolNew(Melon *melon, const char *x) {
   MlnSymbol *sym;
 
-  sym = MlnSymbolFind(x);
+  sym = MlnSymbolFind(melon, x);
   if (sym != NULL) {
     return sym;
   }
 
   sym = malloc(sizeof(MlnSymbol));
   MlnMemoryCheck(sym);
-  sym->name = MlnStrSafe(x);
+  sym->name = MlnStrSafe(melon, x);
   sym->index = 0;
   sym->type = isupper(*x) ? MLN_SYM_TERMINAL : MLN_SYM_NON_TERMINAL;
   sym->rule = NULL;
   sym->fallback = NULL;
+  sym->token_order = 0;
   sym->prec = -1;
   sym->assoc = MLN_ASSOC_UNK;
+  sym->heat = MLN_HEAT_NORMAL;
+  sym->keyword = NULL;
+  sym->keyword_line = 0;
   sym->first_set = NULL;
   sym->lambda = MLN_FALSE;
   sym->destructor = NULL;
   sym->destructor_line = 0;
   sym->data_type = NULL;
   sym->data_type_num = 0;
-  MlnSymbolInsert(sym, sym->name);
+  MlnSymbolInsert(melon, sym, sym->name);
 
   return sym;
 }
@@ -245,50 +261,76 @@ MlnSymbol *MlnSymbolNew(const char *x) {
  *
  * Symbols that begin with upper case letters (terminals or tokens)
  * must sort before symbols that begin with lower case letters
- * (non-terminals). Other than that, the order does not matter.
+ * (non-terminals). The tokens named by %token follow "$" in the
+ * order given, so that their numbers are fixed. Other than that, the
+ * order does not matter.
  *
  * We find experimentally that leaving the symbols is their original
  * order (the order they appeared in the grammar file) gives the smallest
  * parser tables in CutDB.
  */
 int MlnSymbolCmp(MlnSymbol **a, MlnSymbol **b) {
-  int i1 = (**a).index + 10000000 * ((**a).name[0] > 'Z');
-  int i2 = (**b).index + 10000000 * ((**b).name[0] > 'Z');
-  return i1 - i2;
+  int t1 = (**a).name[0] > 'Z';
+  int t2 = (**b).name[0] > 'Z';
+  int p1, p2;
+  if (t1 != t2) {
+    return t1 - t2;
+  }
+  /* "$" is always symbol 0, created before any other */
+  p1 = (**a).index == 0 ? 0 : (**a).token_order ? (**a).token_order : INT_MAX;
+  p2 = (**b).index == 0 ? 0 : (**b).token_order ? (**b).token_order : INT_MAX;
+  if (p1 != p2) {
+    return (p1 > p2) - (p1 < p2);
+  }
+  return ((**a).index > (**b).index) - ((**a).index < (**b).index);
 }
 
 /*
  * Allocate a new associative array
  */
-void MlnSymbolInit() {
-  if (x2a != NULL) {
-    return;
+void MlnSymbolInit(Melon *melon) {
+  X2 *x2a = malloc(sizeof(X2));
+  int i;
+
+  MlnMemoryCheck(x2a);
+  x2a->size = kSymTableSize;
+  x2a->count = 0;
+  x2a->tbl = malloc((sizeof(X2Node) + sizeof(X2Node *)) * kSymTableSize);
+  MlnMemoryCheck(x2a->tbl);
+  x2a->ht = (X2Node **)&(x2a->tbl[kSymTableSize]);
+  for (i = 0; i < kSymTableSize; i++) {
+    x2a->ht[i] = NULL;
   }
+  melon->tables.x2a = x2a;
+}
 
-  x2a = malloc(sizeof(X2));
+/*
+ * Release every symbol and the table itself, so that the table can be
+ * initialized again. Symbol names belong to the string table.
+ */
+void MlnSymbolReset(Melon *melon) {
+  X2 *x2a = melon->tables.x2a;
+  int i;
   if (x2a == NULL) {
     return;
   }
-
-  x2a->size = kSymTableSize;
-  x2a->count = 0;
-  x2a->tbl = malloc((sizeof(X2Node) + sizeof(X2Node *)) * kSymTableSize);
-  if (x2a->tbl == NULL) {
-    free(x2a);
-    x2a = NULL;
-  } else {
-    int i;
-    x2a->ht = (X2Node **)&(x2a->tbl[kSymTableSize]);
-    for (i = 0; i < kSymTableSize; i++) {
-      x2a->ht[i] = NULL;
+  for (i = 0; i < x2a->count; i++) {
+    MlnSymbol *sym = x2a->tbl[i].data;
+    if (sym->first_set != NULL) {
+      MlnSetFree(sym->first_set);
     }
+    free(sym);
   }
+  free(x2a->tbl);
+  free(x2a);
+  melon->tables.x2a = NULL;
 }
 
 /* Insert a new record into the array. Return MLN_TRUE if successful.
  * Prior data with the same key is NOT overwritten.
  */
-int MlnSymbolInsert(MlnSymbol *data, char *key) {
+int MlnSymbolInsert(Melon *melon, MlnSymbol *data, char *key) {
+  X2 *x2a = melon->tables.x2a;
   X2Node *node;
   unsigned h;
   unsigned index;
@@ -315,9 +357,7 @@ int MlnSymbolInsert(MlnSymbol *data, char *key) {
     array.size = size = x2a->size * 2;
     array.count = x2a->count;
     array.tbl = malloc((sizeof(X2Node) + sizeof(X2Node *)) * size);
-    if (array.tbl == NULL) {
-      return MLN_FALSE; /* Fail due to malloc failure */
-    }
+    MlnMemoryCheck(array.tbl);
     array.ht = (X2Node **)&(array.tbl[size]);
     for (i = 0; i < size; i++) {
       array.ht[i] = NULL;
@@ -336,7 +376,7 @@ int MlnSymbolInsert(MlnSymbol *data, char *key) {
       new->from = &(array.ht[index]);
       array.ht[index] = new;
     }
-    free(x2a);
+    free(x2a->tbl);
     *x2a = array;
   }
 
@@ -355,7 +395,8 @@ int MlnSymbolInsert(MlnSymbol *data, char *key) {
   return MLN_TRUE;
 }
 
-MlnSymbol *MlnSymbolFind(const char *key) {
+MlnSymbol *MlnSymbolFind(Melon *melon, const char *key) {
+  X2 *x2a = melon->tables.x2a;
   unsigned h;
   X2Node *node;
 
@@ -376,14 +417,17 @@ MlnSymbol *MlnSymbolFind(const char *key) {
 /*
  * Return the size of the array.
  */
-int MlnSymbolCount() { return x2a ? x2a->count : 0; }
+int MlnSymbolCount(Melon *melon) {
+  return melon->tables.x2a ? melon->tables.x2a->count : 0;
+}
 
 /*
  * Return an array of pointers to all data in the table.
- * The array is obtained from malloc. Return NULL if memory allocation
- * problems, or if the array is empty.
+ * The array is obtained from malloc. Return NULL if the table does not
+ * exist.
  */
-MlnSymbol **MlnSymbolArrayOf() {
+MlnSymbol **MlnSymbolArrayOf(Melon *melon) {
+  X2 *x2a = melon->tables.x2a;
   MlnSymbol **array;
   int i, size;
   if (x2a == NULL) {
@@ -391,10 +435,9 @@ MlnSymbol **MlnSymbolArrayOf() {
   }
   size = x2a->count;
   array = malloc(sizeof(MlnSymbol *) * size);
-  if (array) {
-    for (i = 0; i < size; i++) {
-      array[i] = x2a->tbl[i].data;
-    }
+  MlnMemoryCheck(array);
+  for (i = 0; i < size; i++) {
+    array[i] = x2a->tbl[i].data;
   }
   return array;
 }
@@ -420,27 +463,110 @@ typedef struct X3 {
 typedef struct X3Node {
   MlnState *data;       /* The data */
   MlnConfig *key;       /* The key */
+  unsigned hash;        /* Cached hash of the key */
   struct X3Node *next;  /* Next entry with the same hash */
   struct X3Node **from; /* Previous link */
 } X3Node;
 
-static X3 *x3a;
 static const int kStateTableSize = 128;
 
-/* Hash a state */
-static unsigned state_hash(MlnConfig *c) {
-  unsigned h = 0;
-  while (c) {
-    h = h * 571 + c->rule->index * 37 + c->dot;
-    c = c->bp;
+/* Account for one hash table operation that visited "probe" nodes. */
+static void MlnHashStatsAdd(MlnHashStats *stats, long probe) {
+  stats->lookups++;
+  stats->probes += probe;
+  if (probe > stats->max_probe) {
+    stats->max_probe = probe;
   }
+}
+
+/*
+ * Finalization step of MurmurHash3. Every input bit affects every
+ * output bit, so small structured keys spread over the whole table.
+ */
+static unsigned MlnHashMix(unsigned h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
   return h;
 }
 
+/* Hash a configuration given its rule and dot. */
+unsigned MlnConfigHash(MlnRule *rule, int dot) {
+  return MlnHashMix((unsigned)rule->index * 0x9e3779b1U + (unsigned)dot);
+}
+
+/*
+ * Hash a state given its list of basis configurations. The hash does
+ * not depend on the order of the list, so it can be computed before
+ * the basis is sorted.
+ */
+unsigned MlnStateHash(Melon *melon, MlnConfig *c) {
+  unsigned h = 0;
+  unsigned n = 0;
+  for (; c != NULL; c = MlnConfigAt(melon, c->bp)) {
+    h += MlnConfigHash(c->rule, c->dot);
+    n++;
+  }
+  return MlnHashMix(h ^ n * 0x9e3779b1U);
+}
+
+/*
+ * Return the configuration of the sorted basis "basis" with the rule
+ * and dot of "config", or NULL if there is none.
+ */
+MlnConfig *MlnBasisFind(Melon *melon, MlnConfig *basis, MlnConfig *config) {
+  for (; basis != NULL; basis = MlnConfigAt(melon, basis->bp)) {
+    int rc = basis->rule->index - config->rule->index;
+    if (rc == 0) {
+      rc = basis->dot - config->dot;
+    }
+    if (rc >= 0) {
+      return rc == 0 ? basis : NULL;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Return true if the basis "config", in any order, has the same
+ * configurations as the sorted basis "basis". The successors of a
+ * state are collected from its sorted closure, so both are most often
+ * in the same order and pair up in one walk. The configurations out
+ * of order are searched in "basis"; a basis holds each configuration
+ * once, so the lengths decide the rest.
+ */
+static int MlnBasisSame(Melon *melon, MlnConfig *basis, MlnConfig *config) {
+  MlnConfig *a, *b, *rest;
+  int n = 0, m = 0;
+
+  for (a = basis, b = config; a != NULL && b != NULL;
+       a = MlnConfigAt(melon, a->bp), b = MlnConfigAt(melon, b->bp)) {
+    if (a->rule != b->rule || a->dot != b->dot) {
+      break;
+    }
+  }
+  if (a == NULL || b == NULL) {
+    return a == b;
+  }
+
+  for (rest = a; a != NULL; a = MlnConfigAt(melon, a->bp)) {
+    n++;
+  }
+  for (; b != NULL; b = MlnConfigAt(melon, b->bp)) {
+    if (++m > n || MlnBasisFind(melon, rest, b) == NULL) {
+      return 0;
+    }
+  }
+  return m == n;
+}
+
 /* Compare two states. */
-int MlnStateCmp(MlnConfig *a, MlnConfig *b) {
+static int MlnStateCmp(Melon *melon, MlnConfig *a, MlnConfig *b) {
   int rc;
-  for (rc = 0; rc == 0 && a && b; a = a->bp, b = b->bp) {
+  for (rc = 0; rc == 0 && a && b;
+       a = MlnConfigAt(melon, a->bp), b = MlnConfigAt(melon, b->bp)) {
     rc = a->rule->index - b->rule->index;
     if (rc == 0) {
       rc = a->dot - b->dot;
@@ -465,55 +591,70 @@ MlnState *MlnStateNew() {
 }
 
 /* Allocate a new associative array. */
-void MlnStateInit() {
-  if (x3a != NULL) {
-    return;
-  }
-
-  x3a = malloc(sizeof(X3));
-  if (x3a == NULL) {
-    return;
-  }
+void MlnStateInit(Melon *melon) {
+  X3 *x3a = malloc(sizeof(X3));
+  int i;
 
+  MlnMemoryCheck(x3a);
   x3a->size = kStateTableSize;
   x3a->count = 0;
   x3a->tbl = malloc((sizeof(X3Node) + sizeof(X3Node *)) * kStateTableSize);
-  if (x3a->tbl == NULL) {
-    free(x3a);
-    x3a = NULL;
-  } else {
-    int i = 0;
-    x3a->ht = (X3Node **)&(x3a->tbl[kStateTableSize]);
-    for (i = 0; i < kStateTableSize; i++) {
-      x3a->ht[i] = NULL;
-    }
+  MlnMemoryCheck(x3a->tbl);
+  x3a->ht = (X3Node **)&(x3a->tbl[kStateTableSize]);
+  for (i = 0; i < kStateTableSize; i++) {
+    x3a->ht[i] = NULL;
   }
+  melon->tables.x3a = x3a;
+}
+
+/*
+ * Release the table, so that it can be initialized again. The states
+ * themselves are owned by the caller, through melon->sorted.
+ */
+void MlnStateReset(Melon *melon) {
+  X3 *x3a = melon->tables.x3a;
+  if (x3a == NULL) {
+    return;
+  }
+  free(x3a->tbl);
+  free(x3a);
+  melon->tables.x3a = NULL;
+  memset(&melon->tables.state_stats, 0, sizeof(MlnHashStats));
 }
 
 /*
  * Insert a new record into the array. Return MLN_TRUE if successful.
  * Prior data with the same key is NOT overwritten.
  */
-int MlnStateInsert(MlnState *state, MlnConfig *config) {
+int MlnStateInsert(Melon *melon, MlnState *state, MlnConfig *config) {
+  X3 *x3a = melon->tables.x3a;
+  MlnHashStats *stats = &melon->tables.state_stats;
   X3Node *node;
   unsigned h;
   unsigned index;
+  long probe = 0;
 
   if (x3a == NULL) {
     return MLN_FALSE;
   }
 
-  h = state_hash(config);
+  h = state->hash;
   index = h & (x3a->size - 1);
   node = x3a->ht[index];
   while (node) {
-    if (MlnStateCmp(node->key, config) == 0) {
-      /* An existing entry with the same key is found.
-       * Fail because overwrite is not allows. */
-      return MLN_FALSE;
+    probe++;
+    if (node->hash == h) {
+      if (MlnStateCmp(melon, node->key, config) == 0) {
+        /* An existing entry with the same key is found.
+         * Fail because overwrite is not allows. */
+        MlnHashStatsAdd(stats, probe);
+        return MLN_FALSE;
+      }
+      stats->collisions++;
     }
     node = node->next;
   }
+  MlnHashStatsAdd(stats, probe);
 
   if (x3a->count >= x3a->size) {
     /* Need to make the hash table bigger */
@@ -522,9 +663,7 @@ int MlnStateInsert(MlnState *state, MlnConfig *config) {
     array.size = size = x3a->size * 2;
     array.count = x3a->count;
     array.tbl = malloc((sizeof(X3Node) + sizeof(X3Node *)) * size);
-    if (array.tbl == NULL) {
-      return MLN_FALSE; /* Fail due to malloc failure */
-    }
+    MlnMemoryCheck(array.tbl);
     array.ht = (X3Node **)&(array.tbl[size]);
     for (i = 0; i < size; i++) {
       array.ht[i] = NULL;
@@ -532,13 +671,14 @@ int MlnStateInsert(MlnState *state, MlnConfig *config) {
     for (i = 0; i < x3a->count; i++) {
       X3Node *old, *new;
       old = &(x3a->tbl[i]);
-      index = state_hash(old->key) & (size - 1);
+      index = old->hash & (size - 1);
       new = &(array.tbl[i]);
       if (array.ht[index]) {
         array.ht[index]->from = &(new->next);
       }
       new->next = array.ht[index];
       new->key = old->key;
+      new->hash = old->hash;
       new->data = old->data;
       new->from = &(array.ht[index]);
       array.ht[index] = new;
@@ -551,6 +691,7 @@ int MlnStateInsert(MlnState *state, MlnConfig *config) {
   index = h & (x3a->size - 1);
   node = &(x3a->tbl[x3a->count++]);
   node->key = config;
+  node->hash = h;
   node->data = state;
   if (x3a->ht[index]) {
     x3a->ht[index]->from = &(node->next);
@@ -564,34 +705,42 @@ int MlnStateInsert(MlnState *state, MlnConfig *config) {
 
 /*
  * Return a pointer to data assigned to the given key. Return NULL
- * if no such key.
+ * if no such key. "hash" must be MlnStateHash(config). The basis
+ * "config" needs not be sorted.
  */
-MlnState *MlnStateFind(MlnConfig *config) {
-  unsigned h;
+MlnState *MlnStateFind(Melon *melon, MlnConfig *config, unsigned hash) {
+  X3 *x3a = melon->tables.x3a;
+  MlnHashStats *stats = &melon->tables.state_stats;
   X3Node *node;
+  long probe = 0;
 
   if (x3a == NULL) {
     return NULL;
   }
 
-  h = state_hash(config) & (x3a->size - 1);
-  node = x3a->ht[h];
+  node = x3a->ht[hash & (x3a->size - 1)];
   while (node) {
-    if (MlnStateCmp(node->key, config) == 0) {
-      break;
+    probe++;
+    if (node->hash == hash) {
+      if (MlnBasisSame(melon, node->key, config)) {
+        break;
+      }
+      stats->collisions++;
     }
     node = node->next;
   }
+  MlnHashStatsAdd(stats, probe);
 
   return node ? node->data : NULL;
 }
 
 /*
  * Return an array of pointers to all data in the table.
- * The array is obtained from malloc. Return NULL if memory allocation
- * problems, or if the array is empty.
+ * The array is obtained from malloc. Return NULL if the table does not
+ * exist.
  */
-MlnState **MlnStateArrayOf() {
+MlnState **MlnStateArrayOf(Melon *melon) {
+  X3 *x3a = melon->tables.x3a;
   MlnState **array;
   int i, size;
 
@@ -600,14 +749,35 @@ MlnState **MlnStateArrayOf() {
   }
   size = x3a->count;
   array = malloc(sizeof(MlnState *) * size);
-  if (array) {
-    for (i = 0; i < size; i++) {
-      array[i] = x3a->tbl[i].data;
-    }
+  MlnMemoryCheck(array);
+  for (i = 0; i < size; i++) {
+    array[i] = x3a->tbl[i].data;
   }
   return array;
 }
 
+/*
+ * Free the states of the table, with their actions. Only for a build
+ * abandoned before MlnStateArrayOf() handed them over to the caller.
+ */
+void MlnStateFreeAll(Melon *melon) {
+  X3 *x3a = melon->tables.x3a;
+  int i;
+
+  if (x3a == NULL) {
+    return;
+  }
+  for (i = 0; i < x3a->count; i++) {
+    MlnState *state = x3a->tbl[i].data;
+    free(state->ap);
+    free(state);
+  }
+  for (i = 0; i < x3a->size; i++) {
+    x3a->ht[i] = NULL;
+  }
+  x3a->count = 0;
+}
+
 /*
  * Used for MlnConfig hash table.
  */
@@ -624,18 +794,13 @@ typedef struct X4 {
  */
 typedef struct X4Node {
   MlnConfig *data;      /* The data */
+  unsigned hash;        /* Cached hash of the data */
   struct X4Node *next;  /* Next entry with the same hash */
   struct X4Node **from; /* Previous link */
 } X4Node;
 
-static X4 *x4a = NULL;
 static const int kConfigTableSize = 64;
 
-/* Hash a configuration */
-static unsigned config_hash(MlnConfig *c) {
-  return c->rule->index * 37 + c->dot;
-}
-
 /* Compare two configurations */
 int MlnConfigCmp(MlnConfig *a, MlnConfig *b) {
   int x = a->rule->index - b->rule->index;
@@ -646,55 +811,69 @@ int MlnConfigCmp(MlnConfig *a, MlnConfig *b) {
 }
 
 /* Allocate a new associative array */
-void MlnConfigTableInit() {
-  if (x4a != NULL) {
-    return;
-  }
-
-  x4a = malloc(sizeof(X4));
-  if (x4a == NULL) {
-    return;
-  }
+void MlnConfigTableInit(Melon *melon) {
+  X4 *x4a = malloc(sizeof(X4));
+  int i;
 
+  MlnMemoryCheck(x4a);
   x4a->size = kConfigTableSize;
   x4a->count = 0;
   x4a->tbl = malloc((sizeof(X4Node) + sizeof(X4Node *)) * kConfigTableSize);
-  if (x4a->tbl == NULL) {
-    free(x4a);
-    x4a = NULL;
-  } else {
-    int i;
-    x4a->ht = (X4Node **)&(x4a->tbl[kConfigTableSize]);
-    for (i = 0; i < kConfigTableSize; i++) {
-      x4a->ht[i] = NULL;
-    }
+  MlnMemoryCheck(x4a->tbl);
+  x4a->ht = (X4Node **)&(x4a->tbl[kConfigTableSize]);
+  for (i = 0; i < kConfigTableSize; i++) {
+    x4a->ht[i] = NULL;
+  }
+  melon->tables.x4a = x4a;
+}
+
+/*
+ * Release the table, so that it can be initialized again.
+ */
+void MlnConfigTableReset(Melon *melon) {
+  X4 *x4a = melon->tables.x4a;
+  if (x4a == NULL) {
+    return;
   }
+  free(x4a->tbl);
+  free(x4a);
+  melon->tables.x4a = NULL;
+  memset(&melon->tables.config_stats, 0, sizeof(MlnHashStats));
 }
 
 /*
  * Insert a new record into the array. Return MLN_TRUE if successful.
  * Prior data with the same key is NOT overwritten.
  */
-int MlnConfigTableInsert(MlnConfig *config) {
+int MlnConfigTableInsert(Melon *melon, MlnConfig *config) {
+  X4 *x4a = melon->tables.x4a;
+  MlnHashStats *stats = &melon->tables.config_stats;
   X4Node *node;
   unsigned h;
   unsigned index;
+  long probe = 0;
 
   if (x4a == NULL) {
     return MLN_FALSE;
   }
 
-  h = config_hash(config);
+  h = MlnConfigHash(config->rule, config->dot);
   index = h & (x4a->size - 1);
   node = x4a->ht[index];
   while (node) {
-    if (MlnConfigCmp(node->data, config) == 0) {
-      /* An existing entry with the same key is found.
-       * Fail because overwrite is not allowed. */
-      return MLN_FALSE;
+    probe++;
+    if (node->hash == h) {
+      if (MlnConfigCmp(node->data, config) == 0) {
+        /* An existing entry with the same key is found.
+         * Fail because overwrite is not allowed. */
+        MlnHashStatsAdd(stats, probe);
+        return MLN_FALSE;
+      }
+      stats->collisions++;
     }
     node = node->next;
   }
+  MlnHashStatsAdd(stats, probe);
 
   if (x4a->count >= x4a->size) {
     /* Need to make the hash table bigger */
@@ -703,9 +882,7 @@ int MlnConfigTableInsert(MlnConfig *config) {
     array.size = size = x4a->size * 2;
     array.count = x4a->count;
     array.tbl = malloc((sizeof(X4Node) + sizeof(X4Node *)) * size);
-    if (array.tbl == NULL) {
-      return MLN_FALSE; /* Fail due to malloc failure */
-    }
+    MlnMemoryCheck(array.tbl);
     array.ht = (X4Node **)&(array.tbl[size]);
     for (i = 0; i < size; i++) {
       array.ht[i] = NULL;
@@ -713,13 +890,14 @@ int MlnConfigTableInsert(MlnConfig *config) {
     for (i = 0; i < x4a->count; i++) {
       X4Node *old, *new;
       old = &(x4a->tbl[i]);
-      index = config_hash(old->data) & (size - 1);
+      index = old->hash & (size - 1);
       new = &(array.tbl[i]);
       if (array.ht[index]) {
         array.ht[index]->from = &(new->next);
       }
       new->next = array.ht[index];
       new->data = old->data;
+      new->hash = old->hash;
       new->from = &(array.ht[index]);
       array.ht[index] = new;
     }
@@ -731,6 +909,7 @@ int MlnConfigTableInsert(MlnConfig *config) {
   index = h & (x4a->size - 1);
   node = &(x4a->tbl[x4a->count++]);
   node->data = config;
+  node->hash = h;
   if (x4a->ht[index]) {
     x4a->ht[index]->from = &(node->next);
   }
@@ -743,24 +922,32 @@ int MlnConfigTableInsert(MlnConfig *config) {
 
 /*
  * Return a pointer to data assigned to the given key. Return NULL
- * if no such key.
+ * if no such key. Only the rule and the dot of the key are read.
  */
-MlnConfig *MlnConfigTableFind(MlnConfig *config) {
+MlnConfig *MlnConfigTableFind(Melon *melon, MlnConfig *config) {
+  X4 *x4a = melon->tables.x4a;
+  MlnHashStats *stats = &melon->tables.config_stats;
   unsigned h;
   X4Node *node;
+  long probe = 0;
 
   if (x4a == NULL) {
     return NULL;
   }
 
-  h = config_hash(config) & (x4a->size - 1);
-  node = x4a->ht[h];
+  h = MlnConfigHash(config->rule, config->dot);
+  node = x4a->ht[h & (x4a->size - 1)];
   while (node) {
-    if (MlnConfigCmp(node->data, config) == 0) {
-      break;
+    probe++;
+    if (node->hash == h) {
+      if (MlnConfigCmp(node->data, config) == 0) {
+        break;
+      }
+      stats->collisions++;
     }
     node = node->next;
   }
+  MlnHashStatsAdd(stats, probe);
 
   return node ? node->data : NULL;
 }
@@ -769,7 +956,8 @@ MlnConfig *MlnConfigTableFind(MlnConfig *config) {
  * Remove all data from the table. Pass each data to the function "clear"
  * as it is removed. ("clear" may be null to avoid this step.)
  */
-void MlnConfigTableClear(int (*clear)(MlnConfig *)) {
+void MlnConfigTableClear(Melon *melon, int (*clear)(MlnConfig *)) {
+  X4 *x4a = melon->tables.x4a;
   int i;
   if (x4a == NULL || x4a->count == 0) {
     return;
@@ -784,3 +972,22 @@ void MlnConfigTableClear(int (*clear)(MlnConfig *)) {
   }
   x4a->count = 0;
 }
+
+/*
+ * Print the counters collected by the state and configuration tables.
+ */
+void MlnHashStatsPrint(Melon *melon, FILE *out) {
+  const MlnHashStats *stats[2] = {&melon->tables.state_stats,
+                                  &melon->tables.config_stats};
+  const char *names[2] = {"state", "config"};
+  int i;
+  for (i = 0; i < 2; i++) {
+    fprintf(out,
+            "                   %s hash: %ld lookups, %.2f avg probe, "
+            "%ld max probe, %ld collisions\n",
+            names[i], stats[i]->lookups,
+            stats[i]->lookups ? (double)stats[i]->probes / stats[i]->lookups
+                              : 0.0,
+            stats[i]->max_probe, stats[i]->collisions);
+  }
+}
@@ -6,39 +6,53 @@
 #ifndef MELON_TABLE_H_
 #define MELON_TABLE_H_
 
+#include <stdio.h>
+
 #include "struct.h"
 
 /* Routines for handling a strings */
 
-char *MlnStrSafe(const char *s);
-void MlnStrSafeInit();
-int MlnStrSafeInsert(char *data);
-char *MlnStrSafeFind(const char *key);
+char *MlnStrSafe(Melon *melon, const char *s);
+void MlnStrSafeInit(Melon *melon);
+void MlnStrSafeReset(Melon *melon);
+int MlnStrSafeInsert(Melon *melon, char *data);
+char *MlnStrSafeFind(Melon *melon, const char *key);
 
 /* Routines for handling symbols of grammar */
 
-MlnSymbol *MlnSymbolNew(const char *x);
+MlnSymbol *MlnSymbolNew(Melon *melon, const char *x);
 int MlnSymbolCmp(MlnSymbol **a, MlnSymbol **b);
-void MlnSymbolInit();
-int MlnSymbolInsert(MlnSymbol *data, char *key);
-MlnSymbol *MlnSymbolFind(const char *key);
-int MlnSymbolCount();
-MlnSymbol **MlnSymbolArrayOf();
+void MlnSymbolInit(Melon *melon);
+void MlnSymbolReset(Melon *melon);
+int MlnSymbolInsert(Melon *melon, MlnSymbol *data, char *key);
+MlnSymbol *MlnSymbolFind(Melon *melon, const char *key);
+int MlnSymbolCount(Melon *melon);
+MlnSymbol **MlnSymbolArrayOf(Melon *melon);
 
 /* Routines for manage the state table */
 
 MlnState *MlnStateNew();
-void MlnStateInit();
-int MlnStateInsert(MlnState *state, MlnConfig *config);
-MlnState *MlnStateFind(MlnConfig *config);
-MlnState **MlnStateArrayOf();
+void MlnStateInit(Melon *melon);
+void MlnStateReset(Melon *melon);
+unsigned MlnStateHash(Melon *melon, MlnConfig *config);
+int MlnStateInsert(Melon *melon, MlnState *state, MlnConfig *config);
+MlnState *MlnStateFind(Melon *melon, MlnConfig *config, unsigned hash);
+MlnState **MlnStateArrayOf(Melon *melon);
+void MlnStateFreeAll(Melon *melon);
+MlnConfig *MlnBasisFind(Melon *melon, MlnConfig *basis, MlnConfig *config);
 
 /* Routines used for efficiency in MlnConfigListAdd */
 
+unsigned MlnConfigHash(MlnRule *rule, int dot);
 int MlnConfigCmp(MlnConfig *a, MlnConfig *b);
-void MlnConfigTableInit();
-int MlnConfigTableInsert(MlnConfig *config);
-MlnConfig *MlnConfigTableFind(MlnConfig *config);
-void MlnConfigTableClear(int (*clear)(MlnConfig *));
+void MlnConfigTableInit(Melon *melon);
+void MlnConfigTableReset(Melon *melon);
+int MlnConfigTableInsert(Melon *melon, MlnConfig *config);
+MlnConfig *MlnConfigTableFind(Melon *melon, MlnConfig *config);
+void MlnConfigTableClear(Melon *melon, int (*clear)(MlnConfig *));
+
+/* Hash table statistics, printed with the -s option */
+
+void MlnHashStatsPrint(Melon *melon, FILE *out);
 
 #endif
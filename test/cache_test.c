@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "generate.h"
+#include "libmelon.h"
+#include "set.h"
+#include "test/melon_test.h"
+
+static char kCacheName[] = "cache_test.y";
+static const char *kCacheFile = "cache_test.mlc";
+
+static const char *kCacheGrammar =
+    "%left PLUS.\n"
+    "%left TIMES.\n"
+    "prog ::= expr.\n"
+    "expr ::= expr PLUS expr. { add(); }\n"
+    "expr ::= expr TIMES expr.\n"
+    "expr ::= NUM.\n";
+
+/* The action code differs, the automaton is the same */
+static const char *kCacheCodeEdit =
+    "%left PLUS.\n"
+    "%left TIMES.\n"
+    "prog ::= expr.\n"
+    "expr ::= expr PLUS expr. { sum(); }\n"
+    "expr ::= expr TIMES expr.\n"
+    "expr ::= NUM.\n";
+
+/* PLUS now binds tighter than TIMES */
+static const char *kCachePrecEdit =
+    "%left TIMES.\n"
+    "%left PLUS.\n"
+    "prog ::= expr.\n"
+    "expr ::= expr PLUS expr. { add(); }\n"
+    "expr ::= expr TIMES expr.\n"
+    "expr ::= NUM.\n";
+
+/* Keep the ".c" output, ignore the others */
+static void CacheSink(void *arg, const char *suffix, const char *data,
+                      size_t len) {
+  char **text = arg;
+  if (strcmp(suffix, ".c") != 0) {
+    return;
+  }
+  free(*text);
+  *text = malloc(len + 1);
+  memcpy(*text, data, len);
+  (*text)[len] = '\0';
+}
+
+/*
+ * Return the template "mlt_parser.c" of the source tree, and its
+ * length in "len".
+ */
+static char *CacheTemplate(size_t *len) {
+  FILE *fp = fopen("mlt_parser.c", "rb");
+  char *text;
+
+  CU_CHECK(fp != NULL);
+  if (fp == NULL) {
+    return NULL;
+  }
+  fseek(fp, 0, SEEK_END);
+  *len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  text = malloc(*len + 1);
+  CU_ASSERT_EQ(*len, fread(text, 1, *len, fp));
+  fclose(fp);
+  return text;
+}
+
+/*
+ * Generate the parser of "text" with the cache file, as "-k" does, and
+ * return its ".c" output. "hit" is set when the automaton was loaded
+ * from the cache.
+ */
+static char *CacheGenerate(const char *text, int compress, int *hit) {
+  MlnSinks sinks = {CacheSink, NULL, NULL};
+  MlnGenOptions opts;
+  Melon *melon;
+  char *out = NULL;
+  char *tpl;
+  size_t tpl_len = 0;
+
+  memset(&opts, 0, sizeof(opts));
+  opts.compress = compress;
+  opts.use_cache = 1;
+  opts.quiet = 1;
+  tpl = CacheTemplate(&tpl_len);
+  melon = calloc(1, sizeof(Melon));
+  *hit = 0;
+  if (MlnLoadGrammar(melon, &opts, NULL, kCacheName, text, strlen(text)) ==
+      0) {
+    /* Look the cache up first, so that the hit can be told */
+    MlnSetSize(melon, melon->nterminal);
+    *hit = MlnCacheLoad(melon, compress);
+    sinks.arg = &out;
+    melon->sinks = &sinks;
+    melon->tpl_buf = tpl;
+    melon->tpl_len = tpl_len;
+    MlnGenerateParser(melon, &opts);
+    CU_ASSERT_EQ(0, melon->error_cnt + melon->nconflict);
+  }
+  MlnFreeAutomaton(melon);
+  MlnFreeGrammar(melon);
+  free(melon);
+  free(tpl);
+  return out;
+}
+
+CU_TEST(cache_test_reuse) {
+  char *first, *second;
+  int hit;
+
+  remove(kCacheFile);
+  first = CacheGenerate(kCacheGrammar, 0, &hit);
+  CU_ASSERT_EQ(0, hit);
+  CU_CHECK(first != NULL);
+
+  /* The automaton of the cache gives the same parser */
+  second = CacheGenerate(kCacheGrammar, 0, &hit);
+  CU_ASSERT_EQ(1, hit);
+  CU_CHECK(second != NULL);
+  if (first != NULL && second != NULL) {
+    CU_ASSERT_STRING_EQ(first, second);
+  }
+  free(second);
+
+  /* So does an edit of the action code alone */
+  second = CacheGenerate(kCacheCodeEdit, 0, &hit);
+  CU_ASSERT_EQ(1, hit);
+  CU_CHECK(second != NULL && strstr(second, "sum();") != NULL);
+  free(second);
+
+  free(first);
+  remove(kCacheFile);
+}
+
+CU_TEST(cache_test_reject) {
+  char *text;
+  int hit;
+
+  remove(kCacheFile);
+  text = CacheGenerate(kCacheGrammar, 0, &hit);
+  CU_ASSERT_EQ(0, hit);
+  free(text);
+
+  /* A change of precedence changes the automaton */
+  text = CacheGenerate(kCachePrecEdit, 0, &hit);
+  CU_ASSERT_EQ(0, hit);
+  free(text);
+
+  /* So does "-c", whose action tables are not compressed */
+  text = CacheGenerate(kCachePrecEdit, 1, &hit);
+  CU_ASSERT_EQ(0, hit);
+  free(text);
+  text = CacheGenerate(kCachePrecEdit, 1, &hit);
+  CU_ASSERT_EQ(1, hit);
+  free(text);
+  remove(kCacheFile);
+}
+
+void MlnInitCacheTest() {
+  CU_RUN_TEST(cache_test_reuse);
+  CU_RUN_TEST(cache_test_reject);
+}
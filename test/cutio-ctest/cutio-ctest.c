@@ -0,0 +1 @@
+int cu_fail, cu_run;
@@ -0,0 +1,16 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+extern int cu_fail, cu_run;
+#define CU_TEST(n) static void n(void)
+#define CU_CHECK(c) do{ if(!(c)){cu_fail++;printf("%s:%d: CHECK %s\n",__FILE__,__LINE__,#c);} }while(0)
+#define CU_ASSERT_EQ(a,b) do{ long long _a=(a),_b=(b); if(_a!=_b){cu_fail++;printf("%s:%d: %lld != %lld\n",__FILE__,__LINE__,_a,_b);} }while(0)
+#define CU_ASSERT_DOUBLE_EQ(a,b) CU_CHECK(fabs((a)-(b))<1e-9)
+#define CU_ASSERT_STRING_EQ(a,b) CU_CHECK(strcmp((a),(b))==0)
+#define CU_FAIL(m) do{cu_fail++;printf("FAIL %s\n",m);}while(0)
+#define CU_RUN_TEST(n) do{cu_run++;n();}while(0)
+#define CU_TEST_SUITE(n) void n(void)
+#define CU_SUITE_CONFIGURE(a,b) (void)0
+#define CU_RUN_SUIT(n) n()
+#define CU_REPORT() printf("%d tests, %d failures\n",cu_run,cu_fail)
+#define CU_EXIT_CODE (cu_fail!=0)
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#include <string.h>
+
+#include "keyword.h"
+#include "test/melon_test.h"
+
+static MlnSymbol symbols[8];
+static MlnSymbol *sorted[8];
+
+/*
+ * Make "melon" a grammar whose terminals after "$" have the given
+ * %keyword spellings, NULL for a terminal without one.
+ */
+static void KeywordGrammar(Melon *melon, const char **spellings, int n) {
+  int i;
+  memset(melon, 0, sizeof(*melon));
+  memset(symbols, 0, sizeof(symbols));
+  melon->filename = "keyword_test.y";
+  melon->symbols = sorted;
+  melon->nterminal = n + 1;
+  for (i = 0; i <= n; i++) {
+    symbols[i].index = i;
+    symbols[i].name = "TOKEN";
+    symbols[i].keyword = i > 0 ? (char *)spellings[i - 1] : NULL;
+    symbols[i].keyword_line = i;
+    sorted[i] = &symbols[i];
+  }
+}
+
+/*
+ * Look up the "n" bytes at "z" as the ParseKeyword() of the template.
+ */
+static int KeywordFind(const MlnKeywordTable *kt, const char *z, int n) {
+  unsigned h = MlnKeywordHash(kt->seed, z, n);
+  int slot = (h ^ kt->disp[(h >> 16) % kt->nbucket]) & (kt->nslot - 1);
+  MlnSymbol *sp = kt->slot[slot];
+  if (sp == NULL || (int)strlen(sp->keyword) != n ||
+      memcmp(kt->pool + kt->offset[slot], z, n) != 0) {
+    return 0;
+  }
+  return sp->index;
+}
+
+CU_TEST(keyword_test_find) {
+  const char *spellings[] = {"if", NULL, "else", "int", "in", "while"};
+  const char *others[] = {"", "i", "ifx", "nt", "els", "whilst", "IF"};
+  MlnKeywordTable kt;
+  Melon melon;
+  int i;
+
+  KeywordGrammar(&melon, spellings, 6);
+  CU_ASSERT_EQ(5, MlnKeywordTableInit(&kt, &melon));
+  CU_ASSERT_EQ(0, melon.error_cnt);
+  CU_CHECK(kt.nslot >= kt.nkeyword);
+  CU_CHECK((kt.nslot & (kt.nslot - 1)) == 0);
+  for (i = 0; i < 6; i++) {
+    if (spellings[i] != NULL) {
+      CU_ASSERT_EQ(i + 1,
+                   KeywordFind(&kt, spellings[i], (int)strlen(spellings[i])));
+    }
+  }
+  for (i = 0; i < (int)(sizeof(others) / sizeof(others[0])); i++) {
+    CU_ASSERT_EQ(0, KeywordFind(&kt, others[i], (int)strlen(others[i])));
+  }
+
+  /* "in" is stored within "int" */
+  CU_CHECK(kt.pool_len < (int)strlen("ifelseintinwhile"));
+  MlnKeywordTableFree(&kt);
+}
+
+CU_TEST(keyword_test_none) {
+  const char *spellings[] = {NULL, NULL};
+  MlnKeywordTable kt;
+  Melon melon;
+
+  KeywordGrammar(&melon, spellings, 2);
+  CU_ASSERT_EQ(0, MlnKeywordTableInit(&kt, &melon));
+  CU_ASSERT_EQ(0, melon.error_cnt);
+  CU_CHECK(kt.slot == NULL);
+}
+
+CU_TEST(keyword_test_duplicate) {
+  const char *spellings[] = {"do", "for", "do"};
+  MlnKeywordTable kt;
+  Melon melon;
+
+  KeywordGrammar(&melon, spellings, 3);
+  CU_ASSERT_EQ(0, MlnKeywordTableInit(&kt, &melon));
+  CU_ASSERT_EQ(1, melon.error_cnt);
+  CU_CHECK(kt.slot == NULL);
+}
+
+void MlnInitKeywordTest() {
+  CU_RUN_TEST(keyword_test_find);
+  CU_RUN_TEST(keyword_test_none);
+  CU_RUN_TEST(keyword_test_duplicate);
+}
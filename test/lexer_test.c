@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#include <string.h>
+
+#include "lexer.h"
+#include "test/melon_test.h"
+
+static MlnSymbol symbols[8];
+static MlnRegex regex[8];
+
+/*
+ * Make "melon" a grammar with the given patterns, in order. The token
+ * of the pattern k is the terminal k + 1, or none for a skip pattern
+ * if tokens[k] is 0.
+ */
+static void LexerGrammar(Melon *melon, const char **patterns,
+                         const int *tokens, int n) {
+  int i;
+  memset(melon, 0, sizeof(*melon));
+  memset(symbols, 0, sizeof(symbols));
+  memset(regex, 0, sizeof(regex));
+  melon->filename = "lexer_test.y";
+  for (i = 0; i < n; i++) {
+    symbols[i].index = i + 1;
+    symbols[i].name = "TOKEN";
+    regex[i].sym = tokens[i] ? &symbols[i] : NULL;
+    regex[i].pattern = (char *)patterns[i];
+    regex[i].line = i + 1;
+    regex[i].next = i + 1 < n ? &regex[i + 1] : NULL;
+  }
+  melon->regex = n > 0 ? &regex[0] : NULL;
+}
+
+/*
+ * Return the token of the longest match at the start of "z", 0 if
+ * none, and its length in "*len", as the scanner of the template.
+ */
+static int LexerScan(const MlnLexer *lx, const char *z, int *len) {
+  int s = 1, token = 0, i;
+  *len = 0;
+  for (i = 0; z[i] != '\0'; i++) {
+    s = lx->next[s * lx->nclass + lx->byte_class[(unsigned char)z[i]]];
+    if (s == 0) {
+      break;
+    }
+    if (lx->accept[s] != 0) {
+      token = lx->accept[s];
+      *len = i + 1;
+    }
+  }
+  return token;
+}
+
+CU_TEST(lexer_test_longest) {
+  const char *patterns[] = {"[0-9]+", "[0-9]+\\.[0-9]+", "[ \\t]+"};
+  const int tokens[] = {1, 1, 0};
+  MlnLexer lx;
+  Melon melon;
+  int len;
+
+  LexerGrammar(&melon, patterns, tokens, 3);
+  CU_CHECK(MlnLexerBuild(&lx, &melon) > 0);
+  CU_ASSERT_EQ(2, LexerScan(&lx, "12.5x", &len));
+  CU_ASSERT_EQ(4, len);
+  CU_ASSERT_EQ(1, LexerScan(&lx, "12.x", &len));
+  CU_ASSERT_EQ(2, len);
+  CU_ASSERT_EQ(-1, LexerScan(&lx, " \t1", &len));
+  CU_ASSERT_EQ(2, len);
+  CU_ASSERT_EQ(0, LexerScan(&lx, "x", &len));
+  CU_ASSERT_EQ(0, len);
+  MlnLexerFree(&lx);
+}
+
+CU_TEST(lexer_test_priority) {
+  const char *patterns[] = {"if", "[a-z]+"};
+  const char *reversed[] = {"[a-z]+", "if"};
+  const int tokens[] = {1, 1};
+  MlnLexer lx;
+  Melon melon;
+  int len;
+
+  /* The first of the patterns matching as long wins */
+  LexerGrammar(&melon, patterns, tokens, 2);
+  CU_CHECK(MlnLexerBuild(&lx, &melon) > 0);
+  CU_ASSERT_EQ(1, LexerScan(&lx, "if(", &len));
+  CU_ASSERT_EQ(2, len);
+  CU_ASSERT_EQ(2, LexerScan(&lx, "iffy", &len));
+  CU_ASSERT_EQ(4, len);
+  MlnLexerFree(&lx);
+
+  LexerGrammar(&melon, reversed, tokens, 2);
+  CU_CHECK(MlnLexerBuild(&lx, &melon) > 0);
+  CU_ASSERT_EQ(1, LexerScan(&lx, "if(", &len));
+  CU_ASSERT_EQ(2, len);
+  MlnLexerFree(&lx);
+}
+
+CU_TEST(lexer_test_errors) {
+  const char *empty[] = {"[a-z]+", "x*"};
+  const char *bad[] = {"(ab", "ab)", "[a-z"};
+  const int tokens[] = {1, 1, 1};
+  MlnLexer lx;
+  Melon melon;
+
+  LexerGrammar(&melon, empty, tokens, 2);
+  CU_ASSERT_EQ(0, MlnLexerBuild(&lx, &melon));
+  CU_ASSERT_EQ(1, melon.error_cnt);
+  CU_CHECK(lx.next == NULL);
+
+  LexerGrammar(&melon, bad, tokens, 3);
+  CU_ASSERT_EQ(0, MlnLexerBuild(&lx, &melon));
+  CU_ASSERT_EQ(3, melon.error_cnt);
+  CU_CHECK(lx.next == NULL);
+
+  LexerGrammar(&melon, empty, tokens, 0);
+  CU_ASSERT_EQ(0, MlnLexerBuild(&lx, &melon));
+  CU_ASSERT_EQ(0, melon.error_cnt);
+}
+
+CU_TEST(lexer_test_minimal) {
+  const char *number[] = {"[0-9]+"};
+  const char *suffix[] = {"ab|cb"};
+  const char *same[] = {"(a|b)(a|b)*", "[ab]+"};
+  const int tokens[] = {1, 1};
+  MlnLexer lx;
+  Melon melon;
+  int len;
+
+  /* The dead state, the start, and the accepting state */
+  LexerGrammar(&melon, number, tokens, 1);
+  CU_ASSERT_EQ(3, MlnLexerBuild(&lx, &melon));
+  MlnLexerFree(&lx);
+
+  /* The states after "a" and after "c" are merged */
+  LexerGrammar(&melon, suffix, tokens, 1);
+  CU_ASSERT_EQ(4, MlnLexerBuild(&lx, &melon));
+  MlnLexerFree(&lx);
+
+  /* The second pattern never wins */
+  LexerGrammar(&melon, same, tokens, 2);
+  CU_ASSERT_EQ(3, MlnLexerBuild(&lx, &melon));
+  CU_ASSERT_EQ(1, LexerScan(&lx, "abba", &len));
+  CU_ASSERT_EQ(4, len);
+  MlnLexerFree(&lx);
+}
+
+void MlnInitLexerTest() {
+  CU_RUN_TEST(lexer_test_longest);
+  CU_RUN_TEST(lexer_test_priority);
+  CU_RUN_TEST(lexer_test_errors);
+  CU_RUN_TEST(lexer_test_minimal);
+}
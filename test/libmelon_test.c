@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libmelon.h"
+#include "test/melon_test.h"
+
+#define MAX_OUTPUT 8
+
+/* The outputs of a generation, by suffix, and its diagnostics */
+typedef struct Outputs {
+  int n;
+  char suffix[MAX_OUTPUT][16];
+  char *text[MAX_OUTPUT];
+  char diag[256];
+  const char *abort_on; /* Run out of memory in the sink of this output */
+} Outputs;
+
+static void OutputsSink(void *arg, const char *suffix, const char *data,
+                        size_t len) {
+  Outputs *out = arg;
+  if (out->abort_on != NULL && strcmp(suffix, out->abort_on) == 0) {
+    extern void memory_error();
+    memory_error();
+  }
+  if (out->n >= MAX_OUTPUT) {
+    CU_FAIL("too many outputs");
+    return;
+  }
+  snprintf(out->suffix[out->n], sizeof(out->suffix[0]), "%s", suffix);
+  out->text[out->n] = malloc(len + 1);
+  memcpy(out->text[out->n], data, len);
+  out->text[out->n][len] = '\0';
+  out->n++;
+}
+
+static void OutputsDiagnostic(void *arg, const char *data, size_t len) {
+  Outputs *out = arg;
+  snprintf(out->diag, sizeof(out->diag), "%.*s", (int)len, data);
+}
+
+static const char *OutputsFind(const Outputs *out, const char *suffix) {
+  int i;
+  for (i = 0; i < out->n; i++) {
+    if (strcmp(out->suffix[i], suffix) == 0) {
+      return out->text[i];
+    }
+  }
+  return NULL;
+}
+
+static void OutputsFree(Outputs *out) {
+  int i;
+  for (i = 0; i < out->n; i++) {
+    free(out->text[i]);
+  }
+  out->n = 0;
+}
+
+/*
+ * Set the template of "ctx" from the file "name" of the source tree.
+ */
+static void SetTemplate(MlnContext *ctx, const char *name) {
+  FILE *fp = fopen(name, "rb");
+  char *text;
+  long len;
+
+  CU_CHECK(fp != NULL);
+  if (fp == NULL) {
+    return;
+  }
+  fseek(fp, 0, SEEK_END);
+  len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  text = malloc(len + 1);
+  CU_ASSERT_EQ(len, fread(text, 1, len, fp));
+  fclose(fp);
+  MlnContextSetTemplate(ctx, text, len);
+  free(text);
+}
+
+/*
+ * Generate the grammar "text" named "name" into "out", and return the
+ * result of MlnGenerate().
+ */
+static int Generate(Outputs *out, const char *name, int flags,
+                    const char *text) {
+  MlnSinks sinks = {OutputsSink, OutputsDiagnostic, NULL};
+  MlnContext *ctx = MlnContextNew(name, flags);
+  int rc;
+
+  sinks.arg = out;
+  out->n = 0;
+  out->diag[0] = '\0';
+  SetTemplate(ctx, (flags & MLN_GEN_CPLUSPLUS) ? "mlt_parser.hpp"
+                                                : "mlt_parser.c");
+  rc = MlnGenerate(ctx, text, strlen(text), &sinks);
+  MlnContextFree(ctx);
+  return rc;
+}
+
+/*
+ * Return the number of the #line directives of "text" naming the file
+ * "name", after checking that each gives the number of the next line.
+ */
+static int CheckLineDirectives(const char *text, const char *name) {
+  const char *p;
+  int line_no, n, count = 0;
+  char file[64];
+
+  for (p = text, line_no = 1; *p != '\0'; line_no++) {
+    if (sscanf(p, "#line %d \"%63[^\"]\"", &n, file) == 2 &&
+        strcmp(file, name) == 0) {
+      CU_ASSERT_EQ(line_no + 1, n);
+      count++;
+    }
+    p = strchr(p, '\n');
+    if (p == NULL) {
+      break;
+    }
+    p++;
+  }
+  return count;
+}
+
+static const char *kExprGrammar =
+    "%left PLUS.\n"
+    "%left TIMES.\n"
+    "prog ::= expr.\n"
+    "expr ::= expr PLUS expr.\n"
+    "expr ::= expr TIMES expr.\n"
+    "expr ::= NUM.\n";
+
+CU_TEST(libmelon_test_outputs) {
+  Outputs out;
+
+  memset(&out, 0, sizeof(out));
+  CU_ASSERT_EQ(0, Generate(&out, "expr.y", 0, kExprGrammar));
+  CU_CHECK(OutputsFind(&out, ".c") != NULL);
+  CU_CHECK(OutputsFind(&out, ".h") != NULL);
+  CU_CHECK(OutputsFind(&out, ".out") != NULL);
+  CU_ASSERT_STRING_EQ("", out.diag);
+  OutputsFree(&out);
+
+  CU_ASSERT_EQ(0, Generate(&out, "expr.y", MLN_GEN_NO_REPORT, kExprGrammar));
+  CU_ASSERT_EQ(2, out.n);
+  CU_CHECK(OutputsFind(&out, ".out") == NULL);
+  OutputsFree(&out);
+
+  /* An error goes to the diagnostic sink, and nothing is output */
+  CU_ASSERT_EQ(1, Generate(&out, "bad.y", 0, "expr ::= expr PLUS.\n%bad.\n"));
+  CU_ASSERT_EQ(0, out.n);
+  CU_CHECK(strstr(out.diag, "bad.y:2:") != NULL);
+  OutputsFree(&out);
+}
+
+CU_TEST(libmelon_test_abort) {
+  Outputs out;
+
+  /* The automaton, the output being written and the diagnostics are
+   * released, and the next generation is unaffected */
+  memset(&out, 0, sizeof(out));
+  out.abort_on = ".c";
+  CU_ASSERT_EQ(MLN_GEN_ABORTED, Generate(&out, "expr.y", 0, kExprGrammar));
+  CU_CHECK(OutputsFind(&out, ".c") == NULL);
+  CU_CHECK(strstr(out.diag, "Out of memory") != NULL);
+  OutputsFree(&out);
+
+  out.abort_on = NULL;
+  CU_ASSERT_EQ(0, Generate(&out, "expr.y", 0, kExprGrammar));
+  CU_CHECK(OutputsFind(&out, ".c") != NULL);
+  CU_ASSERT_STRING_EQ("", out.diag);
+  OutputsFree(&out);
+}
+
+static const char *kKeywordGrammar =
+    "%keyword IF \"if\" ELSE \"else\".\n"
+    "%token_regex NUM \"[0-9]+\".\n"
+    "%skip_regex \"[ ]+\".\n"
+    "prog ::= stmt. { prog_count++; }\n"
+    "stmt ::= IF NUM ELSE NUM. { stmt_count++; }\n"
+    "stmt ::= NUM.\n";
+
+CU_TEST(libmelon_test_line_directives) {
+  Outputs out;
+
+  memset(&out, 0, sizeof(out));
+  CU_ASSERT_EQ(0, Generate(&out, "ex.y", MLN_GEN_NO_REPORT, kKeywordGrammar));
+  CU_CHECK(OutputsFind(&out, ".c") != NULL);
+  if (OutputsFind(&out, ".c") != NULL) {
+    CU_CHECK(CheckLineDirectives(OutputsFind(&out, ".c"), "ex.c") > 0);
+  }
+  OutputsFree(&out);
+
+  CU_ASSERT_EQ(0, Generate(&out, "ex.y", MLN_GEN_NO_REPORT | MLN_GEN_CPLUSPLUS,
+                           kKeywordGrammar));
+  CU_CHECK(OutputsFind(&out, ".hpp") != NULL);
+  if (OutputsFind(&out, ".hpp") != NULL) {
+    CU_CHECK(CheckLineDirectives(OutputsFind(&out, ".hpp"), "ex.hpp") > 0);
+  }
+  OutputsFree(&out);
+}
+
+/*
+ * Return the code of the token "name" defined in the header "text", or
+ * -1 if it is not.
+ */
+static int TokenCode(const char *text, const char *name) {
+  char def[64];
+  int code;
+
+  for (; text != NULL; text = strchr(text, '\n')) {
+    text += *text == '\n';
+    if (sscanf(text, "#define %63s %d", def, &code) == 2 &&
+        strcmp(def, name) == 0) {
+      return code;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Read the values of the array "name" of the parser "text" into
+ * values[], skipping the comments, and return their number.
+ */
+static int ArrayValues(const char *text, const char *name, int *values,
+                       int max) {
+  char head[64];
+  const char *p;
+  char *end;
+  int n = 0;
+
+  snprintf(head, sizeof(head), "%s[] = {", name);
+  p = strstr(text, head);
+  if (p == NULL) {
+    return 0;
+  }
+  for (p += strlen(head); *p != '\0' && *p != '}' && n < max;) {
+    if (p[0] == '/' && p[1] == '*') {
+      p = strstr(p, "*/");
+      if (p == NULL) {
+        break;
+      }
+      p += 2;
+    } else if (*p >= '0' && *p <= '9') {
+      values[n++] = (int)strtol(p, &end, 10);
+      p = end;
+    } else {
+      p++;
+    }
+  }
+  return n;
+}
+
+/* KW1 and KW2 are never shifted, so their columns are both empty */
+static const char *kFallbackGrammar =
+    "%fallback ID KW1.\n"
+    "%fallback NUM KW2.\n"
+    "prog ::= list.\n"
+    "list ::= list item.\n"
+    "list ::= item.\n"
+    "item ::= ID EQ NUM.\n";
+
+CU_TEST(libmelon_test_token_class_fallback) {
+  Outputs out;
+  const char *c, *h;
+  int token_class[32], fallback[32];
+  int id, kw1, num, kw2;
+
+  memset(&out, 0, sizeof(out));
+  CU_ASSERT_EQ(0, Generate(&out, "fb.y", MLN_GEN_NO_REPORT, kFallbackGrammar));
+  c = OutputsFind(&out, ".c");
+  h = OutputsFind(&out, ".h");
+  CU_CHECK(c != NULL && h != NULL);
+  if (c == NULL || h == NULL) {
+    OutputsFree(&out);
+    return;
+  }
+  id = TokenCode(h, "ID");
+  kw1 = TokenCode(h, "KW1");
+  num = TokenCode(h, "NUM");
+  kw2 = TokenCode(h, "KW2");
+  CU_CHECK(id > 0 && kw1 > 0 && num > 0 && kw2 > 0);
+
+  /* The two tokens share a class, which yy_token_class[] gives */
+  CU_CHECK(ArrayValues(c, "yy_token_class", token_class, 32) > kw2);
+  CU_ASSERT_EQ(token_class[kw1], token_class[kw2]);
+  CU_CHECK(token_class[id] != token_class[kw1]);
+  CU_CHECK(token_class[num] != token_class[kw1]);
+  CU_CHECK(token_class[id] != token_class[num]);
+
+  /* And each falls back to its own target, by its own code */
+  CU_CHECK(ArrayValues(c, "yyFallback", fallback, 32) > kw2);
+  CU_ASSERT_EQ(id, fallback[kw1]);
+  CU_ASSERT_EQ(num, fallback[kw2]);
+  OutputsFree(&out);
+}
+
+void MlnInitLibmelonTest() {
+  CU_RUN_TEST(libmelon_test_outputs);
+  CU_RUN_TEST(libmelon_test_abort);
+  CU_RUN_TEST(libmelon_test_line_directives);
+  CU_RUN_TEST(libmelon_test_token_class_fallback);
+}
@@ -5,6 +5,10 @@
 
 #include "test/melon_test.h"
 
-void memory_error() { CU_FAIL("memory error"); }
-
-void MlnInitTest() { MlnInitOptionTest(); }
+void MlnInitTest() {
+  MlnInitOptionTest();
+  MlnInitKeywordTest();
+  MlnInitLexerTest();
+  MlnInitLibmelonTest();
+  MlnInitCacheTest();
+}
@@ -12,5 +12,9 @@
 void MlnInitTest();
 
 void MlnInitOptionTest();
+void MlnInitKeywordTest();
+void MlnInitLexerTest();
+void MlnInitLibmelonTest();
+void MlnInitCacheTest();
 
 #endif
@@ -188,10 +188,72 @@ CU_TEST(option_test_error) {
   fclose(file);
 }
 
+CU_TEST(option_test_prefix) {
+  int flag = 0;
+  int j = 0;
+  char *s = NULL;
+  char argv0[] = "melon_test";
+  char argv1[] = "-j4";
+  char argv2[] = "-Dmelon";
+  char argv3[] = "-jobs";
+  char argv4[] = "filename";
+  char *argv[] = {argv0, argv1, argv2, argv3, argv4, NULL};
+
+  MlnOption options[] = {
+      {MLN_OPT_INT, "j", (char *)&j, "integer"},
+      {MLN_OPT_STR, "D", (char *)&s, "string"},
+      {MLN_OPT_FLAG, "jobs", (char *)&flag, "flag"},
+      {MLN_OPT_FLAG, NULL, NULL, NULL},
+  };
+  CU_ASSERT_EQ(0, MlnOptInit(argv, options, stderr));
+  CU_ASSERT_EQ(4, j);
+  CU_ASSERT_STRING_EQ("melon", s);
+  CU_ASSERT_EQ(1, flag);
+  CU_ASSERT_EQ(1, MlnOptNArgs());
+}
+
+CU_TEST(option_test_separate) {
+  int j = 0;
+  int flag = 0;
+  char argv0[] = "melon_test";
+  char argv1[] = "-j";
+  char argv2[] = "2";
+  char argv3[] = "a.y";
+  char argv4[] = "-s";
+  char argv5[] = "b.y";
+  char *argv[] = {argv0, argv1, argv2, argv3, argv4, argv5, NULL};
+  char *missing[] = {argv0, argv3, argv1, NULL};
+  char *bad[] = {argv0, argv1, argv3, NULL};
+  char *filename = "text.txt";
+  FILE *file;
+
+  MlnOption options[] = {
+      {MLN_OPT_INT, "j", (char *)&j, "integer"},
+      {MLN_OPT_FLAG, "s", (char *)&flag, "flag"},
+      {MLN_OPT_FLAG, NULL, NULL, NULL},
+  };
+  CU_ASSERT_EQ(0, MlnOptInit(argv, options, stderr));
+  CU_ASSERT_EQ(2, j);
+  CU_ASSERT_EQ(1, flag);
+  CU_ASSERT_EQ(2, MlnOptNArgs());
+  CU_ASSERT_STRING_EQ("a.y", MlnOptArg(0));
+  CU_ASSERT_STRING_EQ("b.y", MlnOptArg(1));
+
+  /* Without its argument, or with one which is not a number */
+  file = fopen(filename, "w+");
+  CU_CHECK(file != NULL);
+  remove(filename);
+  CU_ASSERT_EQ(-1, MlnOptInit(missing, options, file));
+  CU_ASSERT_EQ(-1, MlnOptInit(bad, options, file));
+  fclose(file);
+}
+
 void MlnInitOptionTest() {
   CU_RUN_TEST(option_test_flag);
   CU_RUN_TEST(option_test_switch);
   CU_RUN_TEST(option_test_function);
   CU_RUN_TEST(option_test_print);
   CU_RUN_TEST(option_test_error);
+  CU_RUN_TEST(option_test_prefix);
+  CU_RUN_TEST(option_test_separate);
 }
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ *
+ * Wait for changes of a few files with inotify. The directories of
+ * the files are watched rather than the files themselves, so that
+ * editors which rename a new file over the old one are noticed too.
+ */
+
+#include "watch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "struct.h"
+
+typedef struct MlnWatchFile {
+  int wd;           /* Watch descriptor of the directory */
+  const char *base; /* Name of the file within the directory */
+} MlnWatchFile;
+
+static int watch_fd = -1;
+static MlnWatchFile *files = NULL;
+static int nfile = 0;
+
+/* Events closer together than this are reported as one change */
+static const int kWatchSettleMs = 50;
+
+/*
+ * Start watching the given files. At most 32 files can be watched.
+ * Return 0 on success, and -1 if the files can't be watched.
+ */
+int MlnWatchInit(const char **paths, int npath) {
+#ifdef __linux__
+  int i;
+
+  if (npath > 32) {
+    return -1;
+  }
+  watch_fd = inotify_init();
+  if (watch_fd < 0) {
+    return -1;
+  }
+  files = malloc(sizeof(files[0]) * (npath > 0 ? npath : 1));
+  MlnMemoryCheck(files);
+  nfile = npath;
+  for (i = 0; i < npath; i++) {
+    const char *cp = strrchr(paths[i], '/');
+    char *dir;
+    if (cp == NULL) {
+      dir = malloc(2);
+      MlnMemoryCheck(dir);
+      strcpy(dir, ".");
+      files[i].base = paths[i];
+    } else {
+      int len = cp == paths[i] ? 1 : (int)(cp - paths[i]);
+      dir = malloc(len + 1);
+      MlnMemoryCheck(dir);
+      sprintf(dir, "%.*s", len, paths[i]);
+      files[i].base = &cp[1];
+    }
+    files[i].wd =
+        inotify_add_watch(watch_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    free(dir);
+    if (files[i].wd < 0) {
+      MlnWatchClose();
+      return -1;
+    }
+  }
+  return 0;
+#else
+  (void)paths;
+  (void)npath;
+  return -1;
+#endif
+}
+
+/*
+ * Block until at least one of the watched files changes. Return a
+ * bit mask with bit i set if the i-th file changed, or -1 on error.
+ */
+int MlnWatchWait() {
+#ifdef __linux__
+  char buf[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  struct pollfd pfd;
+  int changed = 0;
+  int timeout = -1;
+
+  pfd.fd = watch_fd;
+  pfd.events = POLLIN;
+  for (;;) {
+    ssize_t len;
+    char *cp;
+    int rc = poll(&pfd, 1, timeout);
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (rc == 0) {
+      return changed; /* No more events for a while */
+    }
+
+    len = read(watch_fd, buf, sizeof(buf));
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    for (cp = buf; cp < buf + len;) {
+      struct inotify_event *ev = (struct inotify_event *)cp;
+      int i;
+      for (i = 0; i < nfile; i++) {
+        if (ev->len > 0 && ev->wd == files[i].wd &&
+            strcmp(ev->name, files[i].base) == 0) {
+          changed |= 1 << i;
+        }
+      }
+      cp += sizeof(struct inotify_event) + ev->len;
+    }
+    if (changed != 0) {
+      timeout = kWatchSettleMs;
+    }
+  }
+#else
+  return -1;
+#endif
+}
+
+/*
+ * Stop watching.
+ */
+void MlnWatchClose() {
+#ifdef __linux__
+  if (watch_fd >= 0) {
+    close(watch_fd);
+  }
+#endif
+  watch_fd = -1;
+  free(files);
+  files = NULL;
+  nfile = 0;
+}
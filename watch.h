@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2024 furzoom.com, All rights reserved.
+ * Author: mn, mn@furzoom.com
+ */
+
+#ifndef MELON_WATCH_H_
+#define MELON_WATCH_H_
+
+int MlnWatchInit(const char **paths, int npath);
+int MlnWatchWait();
+void MlnWatchClose();
+
+#endif